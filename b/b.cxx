@@ -9,6 +9,7 @@
 #endif
 
 #include <sstream>
+#include <iomanip>   // setw()
 #include <iostream>  // cout, cerr
 #include <exception> // terminate(), set_terminate(), terminate_handler
 
@@ -30,12 +31,17 @@
 #include <libbuild2/module.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/profile.hxx>
+#include <libbuild2/snapshot.hxx>
+#include <libbuild2/timeline.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/watch.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/buildspec.hxx>
 #include <libbuild2/operation.hxx>
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/file-cache.hxx>
+#include <libbuild2/regex-cache.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite.hxx>
 
@@ -358,6 +364,16 @@ main (int argc, char* argv[])
   // Statistics.
   //
   size_t phase_switch_contention (0);
+  unique_ptr<profile> prof; // NULL if not profiling.
+
+  // Build timeline (see --trace-file).
+  //
+  unique_ptr<timeline> tline; // NULL if not recording.
+
+  // Build state snapshot (see --snapshot).
+  //
+  unique_ptr<build_snapshot> snap; // NULL if not recording.
+  string snap_key;
 
   try
   {
@@ -457,7 +473,27 @@ main (int argc, char* argv[])
           cmdl.max_stack,
           cmdl.mtime_check,
           cmdl.config_sub,
-          cmdl.config_guess);
+          cmdl.config_guess,
+          cmdl.guess_cache,
+          cmdl.mtime_prefetch);
+
+    // If the snapshot saved by a previous invocation is still valid, then
+    // there is nothing to do. Note that we do it as early as possible (but
+    // after init() which sets the working directory) since skipping the rest
+    // is the whole point.
+    //
+    if (ops.snapshot_specified ())
+    {
+      snap_key = build_snapshot::key (argc, argv);
+
+      if (build_snapshot::verify (ops.snapshot (), snap_key, cmdl.jobs))
+      {
+        if (verb != 0)
+          info << "no changes since snapshot " << ops.snapshot ();
+
+        return 0;
+      }
+    }
 
     // Load builtin modules.
     //
@@ -592,16 +628,46 @@ main (int argc, char* argv[])
     }
 #endif
 
+    // Start profiling as early as possible so that the initial load phase
+    // includes everything up to the first phase switch.
+    //
+    if (ops.stat () || ops.stat_json ())
+      prof.reset (new profile ());
+
+    // Likewise, start recording the timeline. Note that this must be done
+    // before starting up the scheduler (see timeline for details).
+    //
+    if (ops.trace_file_specified ())
+    {
+      tline.reset (new timeline ());
+      timeline::instance = tline.get ();
+    }
+
     // Start up the scheduler and allocate lock shards.
     //
     sched.startup (cmdl.jobs,
                    jobserver.active ? &jobserver.path : nullptr,
                    1 /* init_active */,
                    cmdl.max_jobs,
-                   cmdl.jobs * ops.queue_depth ());
+                   cmdl.jobs * ops.queue_depth (),
+                   0 /* orig_max_active */,
+                   ops.work_stealing ());
 
     global_mutexes mutexes (sched.shard_size ());
-    file_cache fcache (cmdl.fcache_compress);
+
+    // Note that we don't save the snapshot for anything other than a
+    // "complete" update (see below).
+    //
+    if (ops.snapshot_specified () &&
+        !ops.load_only ()         &&
+        !ops.match_only ()        &&
+        !ops.dry_run ())
+    {
+      snap.reset (new build_snapshot (sched.shard_size ()));
+      build_snapshot::instance = snap.get ();
+    }
+
+    file_cache fcache (cmdl.fcache_compress, cmdl.fcache_async);
 
     // Trace some overall environment information.
     //
@@ -623,13 +689,17 @@ main (int argc, char* argv[])
     unique_ptr<context> pctx;
     auto new_context = [&ops, &cmdl,
                         &sched, &mutexes, &fcache,
-                        &phase_switch_contention,
+                        &phase_switch_contention, &prof, &snap,
                         &pctx]
     {
       if (pctx != nullptr)
       {
         phase_switch_contention += (pctx->phase_mutex.contention +
                                     pctx->phase_mutex.contention_load);
+
+        if (snap != nullptr)
+          snap->record_targets (*pctx);
+
         pctx = nullptr; // Free first to reuse memory.
       }
 
@@ -653,6 +723,8 @@ main (int argc, char* argv[])
 
       if (ops.trace_execute_specified ())
         pctx->trace_execute = &ops.trace_execute ();
+
+      pctx->profile = prof.get ();
     };
 
     new_context ();
@@ -679,6 +751,33 @@ main (int argc, char* argv[])
     if (bspec.empty ())
       bspec.push_back (metaopspec ()); // Default meta-operation.
 
+    // Watching is only supported for the perform meta-operation (we need to
+    // know which action's targets to watch).
+    //
+    if (ops.watch ())
+    {
+      for (const metaopspec& ms: bspec)
+      {
+        bool r (true);
+
+        if (!ms.name.empty ())
+          r = ms.name == "perform";
+        else
+        {
+          for (const opspec& os: ms)
+          {
+            meta_operation_id m (pctx->meta_operation_table.find (os.name));
+
+            if (m != 0 && m != perform_id)
+              r = false;
+          }
+        }
+
+        if (!r)
+          fail << "--watch requires perform meta-operation";
+      }
+    }
+
     // The reserve values were picked experimentally. They allow building a
     // sample application that depends on Qt and Boost without causing a
     // rehash.
@@ -893,7 +992,39 @@ main (int argc, char* argv[])
       js.begin_array ();
 #endif
 
-    for (auto mit (bspec.begin ()); mit != bspec.end (); )
+    // In the watch mode keep re-running the buildspec after waiting for
+    // changes (see --watch). If only source files have changed, then reuse
+    // the build context of the previous run (see wait_for_changes() for
+    // details). Otherwise, including if the previous run has failed, start
+    // from scratch. Note that changes made during a run are detected by
+    // comparing modification times to the start of the run.
+    //
+    timestamp start (system_clock::now ());
+    bool reload (false); // Reload after the current run.
+    bool rerun (false);  // Re-running on the previous run's context.
+
+    auto watch = [&bspec, &pctx, &lifted, &skip, &dirty,
+                  &start, &reload, &rerun] (buildspec::iterator& mit)
+    {
+      bool r (wait_for_changes (*pctx, start, reload || bspec.size () != 1));
+
+      start = system_clock::now ();
+      reload = false;
+
+      lifted = nullptr;
+      skip = 0;
+
+      dirty = r;
+      rerun = !r;
+
+      mit = bspec.begin ();
+      return true;
+    };
+
+    for (auto mit (bspec.begin ());
+         mit != bspec.end () || (ops.watch () && watch (mit));
+         )
+    try
     {
       vector_view<opspec> opspecs;
 
@@ -1042,6 +1173,12 @@ main (int argc, char* argv[])
         // then we may end up loading a project (via import) before this
         // happends.
         //
+        // Note that while bootstrap is part of the load phase, we profile it
+        // separately.
+        //
+        if (prof != nullptr)
+          prof->switch_phase (profile::phase::bootstrap);
+
         for (targetspec& ts: os)
         {
           name& tn (ts.name);
@@ -1454,7 +1591,21 @@ main (int argc, char* argv[])
                 fail (l) << "unexpected parameters for meta-operation "
                          << mif->name;
 
-              ctx.current_meta_operation (*mif);
+              // If we are re-running on the previous run's context, then make
+              // sure the operation counts continue from where they left off
+              // (the same hack as in dist). Otherwise the targets will appear
+              // as already matched and executed.
+              //
+              if (rerun)
+              {
+                size_t on (ctx.current_on);
+                ctx.current_meta_operation (*mif);
+                ctx.current_on = on;
+                rerun = false;
+              }
+              else
+                ctx.current_meta_operation (*mif);
+
               dirty = true;
             }
 
@@ -1646,6 +1797,9 @@ main (int argc, char* argv[])
           ts.buildfile = move (*bf);
         } // target
 
+        if (prof != nullptr)
+          prof->switch_phase (profile::phase::load);
+
         // If this operation has been lifted, break out.
         //
         if (lifted == &os)
@@ -1657,6 +1811,13 @@ main (int argc, char* argv[])
         if (load_only && (mid != perform_id || oid != update_id))
           fail << "--load-only requires perform(update) action";
 
+        // Only save the snapshot if all we have done is perform(update)
+        // (see --snapshot). Note that this also stops the recording.
+        //
+        if (mid != perform_id || oid != update_id ||
+            pre_oid != 0      || post_oid != 0)
+          build_snapshot::instance = nullptr;
+
         // Setup the first operation before loading buildfiles. This is relied
         // upon by the update-during-load machinery.
         //
@@ -1936,6 +2097,16 @@ main (int argc, char* argv[])
       if (lifted == nullptr && skip == 0)
         ++mit;
     } // meta-operation
+    catch (const failed&)
+    {
+      // Diagnostics has already been issued.
+      //
+      if (!ops.watch ())
+        throw;
+
+      reload = true;
+      mit = bspec.end ();
+    }
 
 #ifndef BUILD2_BOOTSTRAP
     if (ops.structured_result_specified () &&
@@ -1948,6 +2119,16 @@ main (int argc, char* argv[])
 
     phase_switch_contention += (pctx->phase_mutex.contention +
                                 pctx->phase_mutex.contention_load);
+
+    // Save the snapshot if everything went well.
+    //
+    if (snap != nullptr && build_snapshot::instance != nullptr)
+    {
+      build_snapshot::instance = nullptr;
+
+      snap->record_targets (*pctx);
+      snap->write (ops.snapshot (), snap_key, cmdl.jobs);
+    }
   }
   catch (const failed&)
   {
@@ -1960,6 +2141,27 @@ main (int argc, char* argv[])
   //
   scheduler::stat st (sched.shutdown ());
 
+  // Write the timeline now that there are no more helper threads that could
+  // be recording events.
+  //
+  build_snapshot::instance = nullptr;
+
+  if (tline != nullptr)
+  {
+    timeline::instance = nullptr;
+
+    try
+    {
+      tline->write (ops.trace_file ());
+    }
+    catch (const io_error& e)
+    {
+      error << "unable to write trace file " << ops.trace_file () << ": "
+            << e;
+      r = 1;
+    }
+  }
+
   if (jobserver.active)
     jobserver.cancel (); // Removed by shutdown().
 
@@ -2014,9 +2216,102 @@ main (int argc, char* argv[])
   //
   assert (st.task_queue_remain == 0);
 
-  if (ops.stat ())
+  if (ops.stat () || ops.stat_json ())
   {
-    text << '\n'
+    // Note that here the build is quiescent and we can query the profile.
+    // It may also be absent if we have failed before creating it.
+    //
+    vector<profile::entry> pes;
+    if (prof != nullptr)
+      pes = prof->entries ();
+
+    auto phase_times = [&prof] (profile::phase p)
+    {
+      return prof != nullptr ? prof->phase_times (p) : profile::times ();
+    };
+
+    auto ms = [] (duration d)
+    {
+      return chrono::duration_cast<chrono::milliseconds> (d).count ();
+    };
+
+    regex_cache_stat rs (regex_cache_statistics ());
+
+#ifndef BUILD2_BOOTSTRAP
+    if (ops.stat_json ())
+    {
+      auto ns = [] (duration d) -> uint64_t
+      {
+        return chrono::duration_cast<chrono::nanoseconds> (d).count ();
+      };
+
+      json_stream_serializer js (cout);
+
+      js.begin_object ();
+
+      js.member_name ("scheduler");
+      js.begin_object ();
+      js.member ("thread_max_active",     st.thread_max_active);
+      js.member ("thread_max_total",      st.thread_max_total);
+      js.member ("thread_helpers",        st.thread_helpers);
+      js.member ("thread_max_waiting",    st.thread_max_waiting);
+      js.member ("task_queue_depth",      st.task_queue_depth);
+      js.member ("task_queue_full",       st.task_queue_full);
+      js.member ("task_queue_stolen",     st.task_queue_stolen);
+      js.member ("wait_queue_slots",      st.wait_queue_slots);
+      js.member ("wait_queue_collisions", st.wait_queue_collisions);
+      js.member ("startup_time_ns",       ns (st.startup_time));
+      js.member ("shutdown_time_ns",      ns (st.shutdown_time));
+      js.end_object ();
+
+      js.member ("phase_switch_contention", phase_switch_contention);
+
+      js.member_name ("regex_cache");
+      js.begin_object ();
+      js.member ("hits",   rs.hits);
+      js.member ("misses", rs.misses);
+      js.end_object ();
+
+      js.member_name ("phases");
+      js.begin_array ();
+      for (size_t i (0); i != profile::phase_count; ++i)
+      {
+        profile::phase p (static_cast<profile::phase> (i));
+        profile::times t (phase_times (p));
+
+        js.begin_object ();
+        js.member ("phase",   to_string (p), false /* check */);
+        js.member ("count",   t.count);
+        js.member ("wall_ns", ns (t.wall));
+        js.member ("cpu_ns",  ns (t.cpu));
+        js.end_object ();
+      }
+      js.end_array ();
+
+      js.member_name ("rules");
+      js.begin_array ();
+      for (const profile::entry& e: pes)
+      {
+        js.begin_object ();
+        js.member ("step",        to_string (e.step), false /* check */);
+        js.member ("rule",        e.rule);
+        js.member ("target_type", e.type);
+        js.member ("count",       e.time.count);
+        js.member ("wall_ns",     ns (e.time.wall));
+        js.member ("cpu_ns",      ns (e.time.cpu));
+        js.end_object ();
+      }
+      js.end_array ();
+
+      js.end_object ();
+      cout << endl;
+    }
+    else
+#endif
+    {
+      diag_record dr (text);
+
+      dr << '\n'
          << "build statistics:" << "\n\n"
          << "  thread_max_active       " << st.thread_max_active     << '\n'
          << "  thread_max_total        " << st.thread_max_total      << '\n'
@@ -2025,14 +2320,60 @@ main (int argc, char* argv[])
          << '\n'
          << "  task_queue_depth        " << st.task_queue_depth      << '\n'
          << "  task_queue_full         " << st.task_queue_full       << '\n'
+         << "  task_queue_stolen       " << st.task_queue_stolen     << '\n'
          << '\n'
          << "  wait_queue_slots        " << st.wait_queue_slots      << '\n'
          << "  wait_queue_collisions   " << st.wait_queue_collisions << '\n'
          << '\n'
          << "  phase_switch_contention " << phase_switch_contention  << '\n'
          << '\n'
+         << "  regex_cache_hits        " << rs.hits                  << '\n'
+         << "  regex_cache_misses      " << rs.misses                << '\n'
+         << '\n'
          << "  scheduler_startup_time  " << st.startup_time          << '\n'
          << "  scheduler_shutdown_time " << st.shutdown_time         << '\n';
+
+      // Time profile. Note that the times are in milliseconds and the rule
+      // step times exclude nested steps (see profile for details).
+      //
+      dr << '\n'
+         << "  " << left << setw (10) << "phase"
+         << right << setw (8) << "count"
+         << setw (12) << "wall_ms"
+         << setw (12) << "cpu_ms" << '\n';
+
+      for (size_t i (0); i != profile::phase_count; ++i)
+      {
+        profile::phase p (static_cast<profile::phase> (i));
+        profile::times t (phase_times (p));
+
+        dr << "  " << left << setw (10) << to_string (p)
+           << right << setw (8) << t.count
+           << setw (12) << ms (t.wall)
+           << setw (12) << ms (t.cpu) << '\n';
+      }
+
+      if (!pes.empty ())
+      {
+        dr << '\n'
+           << "  " << left << setw (10) << "step"
+           << setw (16) << "target_type"
+           << right << setw (8) << "count"
+           << setw (12) << "wall_ms"
+           << setw (12) << "cpu_ms"
+           << "  rule" << '\n';
+
+        for (const profile::entry& e: pes)
+        {
+          dr << "  " << left << setw (10) << to_string (e.step)
+             << setw (16) << e.type
+             << right << setw (8) << e.time.count
+             << setw (12) << ms (e.time.wall)
+             << setw (12) << ms (e.time.cpu)
+             << "  " << e.rule << '\n';
+        }
+      }
+    }
   }
 
   return r;
@@ -9,6 +9,8 @@
 #include <libbuild2/file.hxx> // import()
 #include <libbuild2/search.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/profile.hxx>
+#include <libbuild2/timeline.hxx>
 #include <libbuild2/operation.hxx> // perform_{match,execute}()
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
@@ -865,6 +867,9 @@ namespace build2
                          << diag_do (a, t);
                   });
 
+                profile::frame pf (t.ctx.profile,
+                                   profile::step::match, n, t.type ());
+
                 if (!ru.match (a, t, *hint, me))
                   continue;
               }
@@ -909,6 +914,9 @@ namespace build2
                   // @@ Can't we temporarily swap things out in target?
                   //
                   match_extra me1 (me.locked, oi == 0 /* fallback */);
+                  profile::frame pf (t.ctx.profile,
+                                     profile::step::match, n1, t.type ());
+
                   if (!ru1.match (a, t, *hint, me1))
                     continue;
                 }
@@ -1038,7 +1046,13 @@ namespace build2
 
     auto* ar (f == nullptr ? nullptr : dynamic_cast<const adhoc_rule*> (&ru));
 
-    recipe re (ar != nullptr ? f (*ar, a, t, me) : ru.apply (a, t, me));
+    recipe re;
+    {
+      profile::frame pf (t.ctx.profile,
+                         profile::step::apply, m.first, t.type ());
+
+      re = ar != nullptr ? f (*ar, a, t, me) : ru.apply (a, t, me);
+    }
 
     me.free (); // Note: cur_options are still in use.
     assert (me.cur_options != 0); // Match options cannot be 0 after apply().
@@ -1235,6 +1249,8 @@ namespace build2
     target& t (*l.target);
     target::opstate& s (t[a]);
 
+    timeline::span ts ("match", t);
+
     try
     {
       // Intercept and handle matching an ad hoc group member.
@@ -2814,6 +2830,8 @@ namespace build2
     assert (s.task_count.load (memory_order_consume) == t.ctx.count_busy ()
             && s.state == target_state::unknown);
 
+    timeline::span tls ("execute", t);
+
     target_state ts;
     try
     {
@@ -2888,7 +2906,19 @@ namespace build2
           dr << info << "using directly-assigned recipe";
       }
 
-      ts = execute_recipe (a, t, s.recipe);
+      {
+        // Note: directly-assigned recipes are profiled under a special rule
+        // name.
+        //
+        static const string direct ("<recipe>");
+
+        profile::frame pf (ctx.profile,
+                           profile::step::execute,
+                           s.rule != nullptr ? s.rule->first : direct,
+                           t.type ());
+
+        ts = execute_recipe (a, t, s.recipe);
+      }
 
       if (blm)
       {
@@ -3881,6 +3911,11 @@ namespace build2
 
     // NOTE: similar to create_module_context()/update_in_module_context().
 
+    // The u-d-l context shares the profile with ours (see below) so restore
+    // our phase once done.
+    //
+    profile::phase_guard pg (ctx.profile);
+
     // Create the context unless already exists.
     //
     // Note that this context is reset before every subsequent operation in
@@ -3925,6 +3960,9 @@ namespace build2
       assert (ctx.top_context == nullptr);
       uctx.top_context = &ctx;
 
+      uctx.profile = ctx.profile;
+      uctx.mtime_prefetch = ctx.mtime_prefetch;
+
       // Establish our exemplar (necessary for variable override propagation).
       //
       uctx.exemplar_context = &ctx;
@@ -0,0 +1,59 @@
+// file      : libbuild2/arena.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/arena.hxx>
+
+using namespace std;
+
+namespace build2
+{
+  void* arena::
+  allocate (size_t n, size_t a)
+  {
+    assert (a != 0 && (a & (a - 1)) == 0 && a <= alignof (max_align_t));
+
+    mlock l (mutex_);
+
+    // Align the next pointer.
+    //
+    uintptr_t p (reinterpret_cast<uintptr_t> (next_));
+    uintptr_t o (((p + a - 1) & ~static_cast<uintptr_t> (a - 1)) - p);
+
+    if (next_ == nullptr || static_cast<size_t> (end_ - next_) < o + n)
+    {
+      // Allocate large objects in a separate block without disturbing the
+      // current one (with the new block inserted before it so that the
+      // current one remains last). Note that the block memory is aligned
+      // suitably for any fundamental type.
+      //
+      if (n > block_size_ / 4)
+      {
+        unique_ptr<char[]> b (new char[n]);
+        char* r (b.get ());
+
+        blocks_.insert (blocks_.empty () ? blocks_.end () : blocks_.end () - 1,
+                        move (b));
+        capacity_ += n;
+        return r;
+      }
+
+      blocks_.push_back (unique_ptr<char[]> (new char[block_size_]));
+      next_ = blocks_.back ().get ();
+      end_ = next_ + block_size_;
+      capacity_ += block_size_;
+      o = 0;
+    }
+
+    char* r (next_ + o);
+    next_ = r + n;
+    return r;
+  }
+
+  void arena::
+  clear ()
+  {
+    blocks_.clear ();
+    next_ = end_ = nullptr;
+    capacity_ = 0;
+  }
+}
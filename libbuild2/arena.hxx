@@ -0,0 +1,75 @@
+// file      : libbuild2/arena.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_ARENA_HXX
+#define LIBBUILD2_ARENA_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Bump pointer allocator.
+  //
+  // Memory is allocated from a list of fixed-size blocks and is only
+  // released all at once, on clear() or destruction. Allocations that are
+  // too large to fit into a block comfortably get a block of their own.
+  //
+  // This is used for objects that are allocated in large numbers and live
+  // for (almost) the duration of the owner, such as targets in a context
+  // (see target_set). Besides avoiding the per-allocation overhead, this
+  // also improves locality since objects that are created together (for
+  // example, when loading the same buildfile) end up next to each other.
+  //
+  // Note that the objects allocated in the arena must still be destroyed
+  // (in the sense of having their destructors called) but their memory
+  // must not be freed.
+  //
+  // The allocation function is MT-safe. Since allocation is just a pointer
+  // bump, the mutex is only held for a few instructions. Note, however, that
+  // a single arena shared by many threads will still serialize them so
+  // consider using several arenas (see target_set for an example).
+  //
+  class LIBBUILD2_SYMEXPORT arena
+  {
+  public:
+    static const size_t default_block_size = 64 * 1024;
+
+    explicit
+    arena (size_t block_size = default_block_size)
+        : block_size_ (block_size) {}
+
+    // Allocate n bytes aligned to a (which should not exceed the alignment
+    // of the global operator new).
+    //
+    void*
+    allocate (size_t n, size_t a = alignof (std::max_align_t));
+
+    // Release all the memory. Not MT-safe.
+    //
+    void
+    clear ();
+
+    // Total number of bytes in allocated blocks.
+    //
+    size_t
+    capacity () const {return capacity_;}
+
+    arena (const arena&) = delete;
+    arena& operator= (const arena&) = delete;
+
+  private:
+    size_t block_size_;
+
+    mutex mutex_;
+    vector<unique_ptr<char[]>> blocks_; // Protected by mutex_.
+    char* next_ = nullptr;              // Next free byte in the last block.
+    char* end_ = nullptr;               // End of the last block.
+    size_t capacity_ = 0;
+  };
+}
+
+#endif // LIBBUILD2_ARENA_HXX
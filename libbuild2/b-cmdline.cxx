@@ -448,6 +448,22 @@ namespace build2
       fail << "specified with -v, -V, or --verbose verbosity level "
            << r.verbosity << " is incompatible with --silent";
 
+    // Both are written to stdout.
+    //
+    if (ops.stat_json ()                   &&
+        ops.structured_result_specified () &&
+        ops.structured_result () == structured_result_format::json)
+      fail << "--stat-json is incompatible with --structured-result json";
+
+    if (ops.watch ())
+    {
+#ifndef __linux__
+      fail << "--watch is not supported on this platform";
+#endif
+      if (ops.snapshot_specified ())
+        fail << "--watch is incompatible with --snapshot";
+    }
+
     r.progress = (ops.progress ()    ? optional<bool> (true)  :
                   ops.no_progress () ? optional<bool> (false) : nullopt);
 
@@ -465,6 +481,12 @@ namespace build2
                       ? optional<path> (ops.config_guess ())
                       : nullopt);
 
+    r.guess_cache = (ops.guess_cache_specified ()
+                     ? optional<dir_path> (ops.guess_cache ())
+                     : nullopt);
+
+    r.mtime_prefetch = ops.mtime_prefetch ();
+
     int32_t jobs (ovr_jobs              ? *ovr_jobs   :
                   ops.jobs_specified () ? ops.jobs () :
                   ops.serial_stop ()    ? 1           : 0);
@@ -518,7 +540,15 @@ namespace build2
       if (v == "noop" || v == "none")
         r.fcache_compress = false;
       else if (v == "sync-lz4")
+      {
+        r.fcache_compress = true;
+        r.fcache_async = false;
+      }
+      else if (v == "async-lz4")
+      {
         r.fcache_compress = true;
+        r.fcache_async = true;
+      }
       else
         fail << "invalid --file-cache value '" << v << "'";
     }
@@ -28,10 +28,13 @@ namespace build2
     optional<bool> mtime_check;
     optional<path> config_sub;
     optional<path> config_guess;
+    optional<dir_path> guess_cache;
+    size_t mtime_prefetch = 0;
     size_t jobs = 0;
     size_t max_jobs = 0;
     optional<size_t> max_stack;
     bool fcache_compress = true;
+    bool fcache_async = false;
   };
 
   LIBBUILD2_SYMEXPORT b_cmdline
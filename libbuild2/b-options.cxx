@@ -336,6 +336,7 @@ namespace build2
     verbose_ (1),
     verbose_specified_ (false),
     stat_ (),
+    stat_json_ (),
     progress_ (),
     no_progress_ (),
     diag_color_ (),
@@ -346,10 +347,13 @@ namespace build2
     max_jobs_specified_ (false),
     queue_depth_ (4),
     queue_depth_specified_ (false),
+    work_stealing_ (),
     jobserver_ (),
     jobserver_specified_ (false),
     file_cache_ (),
     file_cache_specified_ (false),
+    mtime_prefetch_ (0),
+    mtime_prefetch_specified_ (false),
     max_stack_ (),
     max_stack_specified_ (false),
     serial_stop_ (),
@@ -374,6 +378,8 @@ namespace build2
     trace_match_specified_ (false),
     trace_execute_ (),
     trace_execute_specified_ (false),
+    trace_file_ (),
+    trace_file_specified_ (false),
     no_column_ (),
     no_line_ (),
     buildfile_ (),
@@ -382,6 +388,11 @@ namespace build2
     config_guess_specified_ (false),
     config_sub_ (),
     config_sub_specified_ (false),
+    guess_cache_ (),
+    guess_cache_specified_ (false),
+    snapshot_ (),
+    snapshot_specified_ (false),
+    watch_ (),
     pager_ (),
     pager_specified_ (false),
     pager_option_ (),
@@ -508,6 +519,12 @@ namespace build2
         this->stat_, a.stat_);
     }
 
+    if (a.stat_json_)
+    {
+      ::build2::build::cli::parser< bool>::merge (
+        this->stat_json_, a.stat_json_);
+    }
+
     if (a.progress_)
     {
       ::build2::build::cli::parser< bool>::merge (
@@ -553,6 +570,12 @@ namespace build2
       this->queue_depth_specified_ = true;
     }
 
+    if (a.work_stealing_)
+    {
+      ::build2::build::cli::parser< bool>::merge (
+        this->work_stealing_, a.work_stealing_);
+    }
+
     if (a.jobserver_specified_)
     {
       ::build2::build::cli::parser< string>::merge (
@@ -567,6 +590,13 @@ namespace build2
       this->file_cache_specified_ = true;
     }
 
+    if (a.mtime_prefetch_specified_)
+    {
+      ::build2::build::cli::parser< size_t>::merge (
+        this->mtime_prefetch_, a.mtime_prefetch_);
+      this->mtime_prefetch_specified_ = true;
+    }
+
     if (a.max_stack_specified_)
     {
       ::build2::build::cli::parser< size_t>::merge (
@@ -671,6 +701,13 @@ namespace build2
       this->trace_execute_specified_ = true;
     }
 
+    if (a.trace_file_specified_)
+    {
+      ::build2::build::cli::parser< path>::merge (
+        this->trace_file_, a.trace_file_);
+      this->trace_file_specified_ = true;
+    }
+
     if (a.no_column_)
     {
       ::build2::build::cli::parser< bool>::merge (
@@ -704,6 +741,26 @@ namespace build2
       this->config_sub_specified_ = true;
     }
 
+    if (a.guess_cache_specified_)
+    {
+      ::build2::build::cli::parser< dir_path>::merge (
+        this->guess_cache_, a.guess_cache_);
+      this->guess_cache_specified_ = true;
+    }
+
+    if (a.snapshot_specified_)
+    {
+      ::build2::build::cli::parser< path>::merge (
+        this->snapshot_, a.snapshot_);
+      this->snapshot_specified_ = true;
+    }
+
+    if (a.watch_)
+    {
+      ::build2::build::cli::parser< bool>::merge (
+        this->watch_, a.watch_);
+    }
+
     if (a.pager_specified_)
     {
       ::build2::build::cli::parser< string>::merge (
@@ -796,7 +853,15 @@ namespace build2
        << "                        6. Even more detailed information." << ::std::endl;
 
     os << std::endl
-       << "\033[1m--stat\033[0m                  Display build statistics." << ::std::endl;
+       << "\033[1m--stat\033[0m                  Display build statistics, including the time profile of" << ::std::endl
+       << "                        the build phases as well as of the rule match, apply," << ::std::endl
+       << "                        and execute steps per rule and target type." << ::std::endl;
+
+    os << std::endl
+       << "\033[1m--stat-json\033[0m             Display build statistics in the JSON format on \033[1mstdout\033[0m." << ::std::endl
+       << "                        Implies \033[1m--stat\033[0m. Note that this option is" << ::std::endl
+       << "                        incompatible with the \033[1mjson\033[0m \033[1m--structured-result\033[0m" << ::std::endl
+       << "                        format which is also written to \033[1mstdout\033[0m." << ::std::endl;
 
     os << std::endl
        << "\033[1m--progress\033[0m              Display build progress. If printing to a terminal the" << ::std::endl
@@ -846,6 +911,15 @@ namespace build2
        << "                        default is 4. See the build system scheduler" << ::std::endl
        << "                        implementation for details." << ::std::endl;
 
+    os << std::endl
+       << "\033[1m--work-stealing\033[0m         Use lock-free work-stealing task queues in the" << ::std::endl
+       << "                        scheduler instead of the default mutex-protected ones." << ::std::endl
+       << "                        This mode reduces contention between threads when" << ::std::endl
+       << "                        scheduling a large number of cheap tasks (for example," << ::std::endl
+       << "                        during match) on machines with many hardware threads." << ::std::endl
+       << "                        See the build system scheduler implementation for" << ::std::endl
+       << "                        details." << ::std::endl;
+
     os << std::endl
        << "\033[1m--jobserver\033[0m \033[4mtype\033[0m        The GNU make jobserver type to start. Valid values are" << ::std::endl
        << "                        \033[1mfifo\033[0m (named pipe on POSIX) or \033[1mnone\033[0m (disable the" << ::std::endl
@@ -861,10 +935,21 @@ namespace build2
     os << std::endl
        << "\033[1m--file-cache\033[0m \033[4mimpl\033[0m       File cache implementation to use for intermediate build" << ::std::endl
        << "                        results. Valid values are \033[1mnoop\033[0m (no caching or" << ::std::endl
-       << "                        compression) and \033[1msync-lz4\033[0m (no caching with synchronous" << ::std::endl
-       << "                        LZ4 on-disk compression). If this option is not" << ::std::endl
-       << "                        specified, then a suitable default implementation is" << ::std::endl
-       << "                        used (currently \033[1msync-lz4\033[0m)." << ::std::endl;
+       << "                        compression), \033[1msync-lz4\033[0m (no caching with synchronous" << ::std::endl
+       << "                        LZ4 on-disk compression), and \033[1masync-lz4\033[0m (no caching" << ::std::endl
+       << "                        with asynchronous LZ4 on-disk compression). If this" << ::std::endl
+       << "                        option is not specified, then a suitable default" << ::std::endl
+       << "                        implementation is used (currently \033[1msync-lz4\033[0m)." << ::std::endl;
+
+    os << std::endl
+       << "\033[1m--mtime-prefetch\033[0m \033[4mnum\033[0m    Use the specified number of background threads to" << ::std::endl
+       << "                        prefetch the modification times of the files that are" << ::std::endl
+       << "                        likely to be checked shortly (for example, the header" << ::std::endl
+       << "                        dependencies recorded in a translation unit's auxiliary" << ::std::endl
+       << "                        dependency database). This can significantly speed up" << ::std::endl
+       << "                        up-to-date checks on high-latency filesystems, such as" << ::std::endl
+       << "                        NFS. If this option is not specified or the zero value" << ::std::endl
+       << "                        is specified, then prefetching is disabled." << ::std::endl;
 
     os << std::endl
        << "\033[1m--max-stack\033[0m \033[4mnum\033[0m         The maximum stack size in KBytes to allow for newly" << ::std::endl
@@ -1082,6 +1167,15 @@ namespace build2
        << "                        primarily useful during troubleshooting. Repeat this" << ::std::endl
        << "                        option to trace multiple targets." << ::std::endl;
 
+    os << std::endl
+       << "\033[1m--trace-file\033[0m \033[4mpath\033[0m       Record the build timeline and write it to the specified" << ::std::endl
+       << "                        file in the Chrome trace event format. The timeline" << ::std::endl
+       << "                        includes buildfile loading, target matching and" << ::std::endl
+       << "                        execution, external processes, scheduler thread" << ::std::endl
+       << "                        suspensions, and phase switches for each thread. The" << ::std::endl
+       << "                        resulting file can be viewed, for example, with" << ::std::endl
+       << "                        \033[1mchrome://tracing\033[0m or Perfetto." << ::std::endl;
+
     os << std::endl
        << "\033[1m--no-column\033[0m             Don't print column numbers in diagnostics." << ::std::endl;
 
@@ -1112,6 +1206,57 @@ namespace build2
        << "                        canonicalization support which should be sufficient for" << ::std::endl
        << "                        commonly-used platforms." << ::std::endl;
 
+    os << std::endl
+       << "\033[1m--guess-cache\033[0m \033[4mdir\033[0m       Cache the information extracted from compilers," << ::std::endl
+       << "                        linkers, and other tools (version, target, system" << ::std::endl
+       << "                        search paths, etc) in the specified directory and reuse" << ::std::endl
+       << "                        it in subsequent invocations. The cache entries are" << ::std::endl
+       << "                        keyed by the tool path and its size, modification time," << ::std::endl
+       << "                        and inode as well as by the relevant options and" << ::std::endl
+       << "                        environment variables. The cache is safe to share" << ::std::endl
+       << "                        between concurrent invocations and to remove at any" << ::std::endl
+       << "                        time." << ::std::endl;
+
+    os << std::endl
+       << "\033[1m--snapshot\033[0m \033[4mfile\033[0m         Save the snapshot of the build state in the specified" << ::std::endl
+       << "                        file after a successful \033[1mperform(update)\033[0m and, if on" << ::std::endl
+       << "                        a subsequent invocation with the same command line," << ::std::endl
+       << "                        working directory, and environment the snapshot is" << ::std::endl
+       << "                        still valid, then skip loading, matching, and executing" << ::std::endl
+       << "                        entirely. The snapshot contains the modification times" << ::std::endl
+       << "                        of the buildfiles, target files, auxiliary dependency" << ::std::endl
+       << "                        databases, and programs used by the build as well as of" << ::std::endl
+       << "                        the project source directories (which detects added and" << ::std::endl
+       << "                        removed files). The snapshot is validated in parallel" << ::std::endl
+       << "                        and on any mismatch the build proceeds as usual. If a" << ::std::endl
+       << "                        file used by the build (other than its output) changes" << ::std::endl
+       << "                        before the snapshot is saved, then the snapshot is not" << ::std::endl
+       << "                        saved. The snapshot file should be placed outside of" << ::std::endl
+       << "                        the project source directories or in their hidden" << ::std::endl
+       << "                        subdirectories." << ::std::endl
+       << ::std::endl
+       << "                        Note that the snapshot assumes that the result of" << ::std::endl
+       << "                        loading the buildfiles only depends on the files it" << ::std::endl
+       << "                        tracks as well as the command line and environment. In" << ::std::endl
+       << "                        particular, it does not track the output of programs" << ::std::endl
+       << "                        executed during loading (for example, with" << ::std::endl
+       << "                        \033[1m$process.run()\033[0m) nor the default options files. As a" << ::std::endl
+       << "                        result, this mechanism is only suitable for trees where" << ::std::endl
+       << "                        these assumptions hold." << ::std::endl;
+
+    os << std::endl
+       << "\033[1m--watch\033[0m                 Keep running after the build, watch the project source" << ::std::endl
+       << "                        directories, buildfiles, and source files for changes," << ::std::endl
+       << "                        and rebuild on each change. If only source files have" << ::std::endl
+       << "                        changed, then the loaded build state is reused with" << ::std::endl
+       << "                        only the affected targets being invalidated. Otherwise" << ::std::endl
+       << "                        (a buildfile has changed, a file has been added or" << ::std::endl
+       << "                        removed, or the previous build has failed) the build" << ::std::endl
+       << "                        state is reloaded from scratch. Changes made during the" << ::std::endl
+       << "                        build are detected and cause an immediate rebuild. Only" << ::std::endl
+       << "                        the \033[1mperform\033[0m meta-operation is supported in this" << ::std::endl
+       << "                        mode. Currently this option is only supported on Linux." << ::std::endl;
+
     os << std::endl
        << "\033[1m--pager\033[0m \033[4mpath\033[0m            The pager program to be used to show long text." << ::std::endl
        << "                        Commonly used pager programs are \033[1mless\033[0m and \033[1mmore\033[0m. You can" << ::std::endl
@@ -1193,6 +1338,8 @@ namespace build2
         &b_options::verbose_specified_ >;
       _cli_b_options_map_["--stat"] =
       &::build2::build::cli::thunk< b_options, &b_options::stat_ >;
+      _cli_b_options_map_["--stat-json"] =
+      &::build2::build::cli::thunk< b_options, &b_options::stat_json_ >;
       _cli_b_options_map_["--progress"] =
       &::build2::build::cli::thunk< b_options, &b_options::progress_ >;
       _cli_b_options_map_["--no-progress"] =
@@ -1219,12 +1366,17 @@ namespace build2
       _cli_b_options_map_["-Q"] =
       &::build2::build::cli::thunk< b_options, size_t, &b_options::queue_depth_,
         &b_options::queue_depth_specified_ >;
+      _cli_b_options_map_["--work-stealing"] =
+      &::build2::build::cli::thunk< b_options, &b_options::work_stealing_ >;
       _cli_b_options_map_["--jobserver"] =
       &::build2::build::cli::thunk< b_options, string, &b_options::jobserver_,
         &b_options::jobserver_specified_ >;
       _cli_b_options_map_["--file-cache"] =
       &::build2::build::cli::thunk< b_options, string, &b_options::file_cache_,
         &b_options::file_cache_specified_ >;
+      _cli_b_options_map_["--mtime-prefetch"] =
+      &::build2::build::cli::thunk< b_options, size_t, &b_options::mtime_prefetch_,
+        &b_options::mtime_prefetch_specified_ >;
       _cli_b_options_map_["--max-stack"] =
       &::build2::build::cli::thunk< b_options, size_t, &b_options::max_stack_,
         &b_options::max_stack_specified_ >;
@@ -1269,6 +1421,9 @@ namespace build2
       _cli_b_options_map_["--trace-execute"] =
       &::build2::build::cli::thunk< b_options, vector<name>, &b_options::trace_execute_,
         &b_options::trace_execute_specified_ >;
+      _cli_b_options_map_["--trace-file"] =
+      &::build2::build::cli::thunk< b_options, path, &b_options::trace_file_,
+        &b_options::trace_file_specified_ >;
       _cli_b_options_map_["--no-column"] =
       &::build2::build::cli::thunk< b_options, &b_options::no_column_ >;
       _cli_b_options_map_["--no-line"] =
@@ -1282,6 +1437,14 @@ namespace build2
       _cli_b_options_map_["--config-sub"] =
       &::build2::build::cli::thunk< b_options, path, &b_options::config_sub_,
         &b_options::config_sub_specified_ >;
+      _cli_b_options_map_["--guess-cache"] =
+      &::build2::build::cli::thunk< b_options, dir_path, &b_options::guess_cache_,
+        &b_options::guess_cache_specified_ >;
+      _cli_b_options_map_["--snapshot"] =
+      &::build2::build::cli::thunk< b_options, path, &b_options::snapshot_,
+        &b_options::snapshot_specified_ >;
+      _cli_b_options_map_["--watch"] =
+      &::build2::build::cli::thunk< b_options, &b_options::watch_ >;
       _cli_b_options_map_["--pager"] =
       &::build2::build::cli::thunk< b_options, string, &b_options::pager_,
         &b_options::pager_specified_ >;
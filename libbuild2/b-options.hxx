@@ -96,6 +96,9 @@ namespace build2
     const bool&
     stat () const;
 
+    const bool&
+    stat_json () const;
+
     const bool&
     progress () const;
 
@@ -126,6 +129,9 @@ namespace build2
     bool
     queue_depth_specified () const;
 
+    const bool&
+    work_stealing () const;
+
     const string&
     jobserver () const;
 
@@ -138,6 +144,12 @@ namespace build2
     bool
     file_cache_specified () const;
 
+    const size_t&
+    mtime_prefetch () const;
+
+    bool
+    mtime_prefetch_specified () const;
+
     const size_t&
     max_stack () const;
 
@@ -210,6 +222,12 @@ namespace build2
     bool
     trace_execute_specified () const;
 
+    const path&
+    trace_file () const;
+
+    bool
+    trace_file_specified () const;
+
     const bool&
     no_column () const;
 
@@ -234,6 +252,21 @@ namespace build2
     bool
     config_sub_specified () const;
 
+    const dir_path&
+    guess_cache () const;
+
+    bool
+    guess_cache_specified () const;
+
+    const path&
+    snapshot () const;
+
+    bool
+    snapshot_specified () const;
+
+    const bool&
+    watch () const;
+
     const string&
     pager () const;
 
@@ -295,6 +328,7 @@ namespace build2
     uint16_t verbose_;
     bool verbose_specified_;
     bool stat_;
+    bool stat_json_;
     bool progress_;
     bool no_progress_;
     bool diag_color_;
@@ -305,10 +339,13 @@ namespace build2
     bool max_jobs_specified_;
     size_t queue_depth_;
     bool queue_depth_specified_;
+    bool work_stealing_;
     string jobserver_;
     bool jobserver_specified_;
     string file_cache_;
     bool file_cache_specified_;
+    size_t mtime_prefetch_;
+    bool mtime_prefetch_specified_;
     size_t max_stack_;
     bool max_stack_specified_;
     bool serial_stop_;
@@ -333,6 +370,8 @@ namespace build2
     bool trace_match_specified_;
     vector<name> trace_execute_;
     bool trace_execute_specified_;
+    path trace_file_;
+    bool trace_file_specified_;
     bool no_column_;
     bool no_line_;
     path buildfile_;
@@ -341,6 +380,11 @@ namespace build2
     bool config_guess_specified_;
     path config_sub_;
     bool config_sub_specified_;
+    dir_path guess_cache_;
+    bool guess_cache_specified_;
+    path snapshot_;
+    bool snapshot_specified_;
+    bool watch_;
     string pager_;
     bool pager_specified_;
     strings pager_option_;
@@ -68,6 +68,12 @@ namespace build2
     return this->stat_;
   }
 
+  inline const bool& b_options::
+  stat_json () const
+  {
+    return this->stat_json_;
+  }
+
   inline const bool& b_options::
   progress () const
   {
@@ -128,6 +134,12 @@ namespace build2
     return this->queue_depth_specified_;
   }
 
+  inline const bool& b_options::
+  work_stealing () const
+  {
+    return this->work_stealing_;
+  }
+
   inline const string& b_options::
   jobserver () const
   {
@@ -152,6 +164,18 @@ namespace build2
     return this->file_cache_specified_;
   }
 
+  inline const size_t& b_options::
+  mtime_prefetch () const
+  {
+    return this->mtime_prefetch_;
+  }
+
+  inline bool b_options::
+  mtime_prefetch_specified () const
+  {
+    return this->mtime_prefetch_specified_;
+  }
+
   inline const size_t& b_options::
   max_stack () const
   {
@@ -296,6 +320,18 @@ namespace build2
     return this->trace_execute_specified_;
   }
 
+  inline const path& b_options::
+  trace_file () const
+  {
+    return this->trace_file_;
+  }
+
+  inline bool b_options::
+  trace_file_specified () const
+  {
+    return this->trace_file_specified_;
+  }
+
   inline const bool& b_options::
   no_column () const
   {
@@ -344,6 +380,36 @@ namespace build2
     return this->config_sub_specified_;
   }
 
+  inline const dir_path& b_options::
+  guess_cache () const
+  {
+    return this->guess_cache_;
+  }
+
+  inline bool b_options::
+  guess_cache_specified () const
+  {
+    return this->guess_cache_specified_;
+  }
+
+  inline const path& b_options::
+  snapshot () const
+  {
+    return this->snapshot_;
+  }
+
+  inline bool b_options::
+  snapshot_specified () const
+  {
+    return this->snapshot_specified_;
+  }
+
+  inline const bool& b_options::
+  watch () const
+  {
+    return this->watch_;
+  }
+
   inline const string& b_options::
   pager () const
   {
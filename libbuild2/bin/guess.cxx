@@ -4,6 +4,7 @@
 #include <libbuild2/bin/guess.hxx>
 
 #include <libbuild2/diagnostics.hxx>
+#include <libbuild2/guess-cache.hxx>
 
 using namespace std;
 
@@ -86,6 +87,122 @@ namespace build2
       return run_search (prog, false, dir_path (), true);
     }
 
+    // Persistent cache (see <libbuild2/guess-cache.hxx> for details).
+    //
+    // Note that we only store the guess results and not the program paths
+    // since we have to search for the programs anyway in order to obtain
+    // their identities.
+    //
+    // Increment the version if changing the layout (or the way any of the
+    // guess results are calculated).
+    //
+    static const uint64_t guess_cache_version = 1;
+
+    // Return the persistent cache key or empty string if the cache is
+    // disabled or the program identity cannot be obtained.
+    //
+    static string
+    persistent_key (const string& key,
+                    const process_path& pp,
+                    const process_path* rp = nullptr)
+    {
+      if (!guess_cache_enabled ())
+        return string ();
+
+      xxh64 cs;
+      cs.append (key);
+      cs.append (guess_cache_version);
+
+      if (!append_program_identity (cs, pp) ||
+          (rp != nullptr && !append_program_identity (cs, *rp)))
+        return string ();
+
+      return cs.string ();
+    }
+
+    static void
+    save_result (guess_cache_writer& w, const guess_result& r)
+    {
+      w.write_string (r.id);
+      w.write_string (r.signature);
+      w.write_string (r.checksum);
+
+      w.write_bool (r.version.has_value ());
+      if (r.version)
+      {
+        w.write_uint (r.version->major);
+        w.write_uint (r.version->minor);
+        w.write_uint (r.version->patch);
+        w.write_string (r.version->build);
+      }
+    }
+
+    static guess_result
+    load_result (guess_cache_reader& r)
+    {
+      guess_result g;
+      g.id = r.read_string ();
+      g.signature = r.read_string ();
+      g.checksum = r.read_string ();
+
+      if (r.read_bool ())
+      {
+        uint64_t mj (r.read_uint ());
+        uint64_t mi (r.read_uint ());
+        uint64_t pa (r.read_uint ());
+        g.version = semantic_version (mj, mi, pa, r.read_string ());
+      }
+
+      return g;
+    }
+
+    // Load the specified number of results. Return false if not found or
+    // the data is invalid.
+    //
+    static bool
+    load_results (const char* kind,
+                  const string& pkey,
+                  guess_result& r1,
+                  guess_result* r2 = nullptr)
+    {
+      optional<string> d (guess_cache_load (kind, pkey));
+
+      if (!d)
+        return false;
+
+      try
+      {
+        guess_cache_reader r (*d);
+
+        r1 = load_result (r);
+
+        if (r2 != nullptr)
+          *r2 = load_result (r);
+
+        r.finish ();
+        return true;
+      }
+      catch (const invalid_argument&) {}
+
+      return false;
+    }
+
+    static void
+    store_results (const char* kind,
+                   const string& pkey,
+                   const guess_result& r1,
+                   const guess_result* r2 = nullptr)
+    {
+      guess_cache_writer w;
+
+      save_result (w, r1);
+
+      if (r2 != nullptr)
+        save_result (w, *r2);
+
+      guess_cache_store (kind, pkey, w.data);
+    }
+
     // Extracting ar/ranlib information requires running them which can become
     // expensive if done repeatedly. So we cache the result.
     //
@@ -117,6 +234,43 @@ namespace build2
                         ? search (*rl, paths, "config.bin.ranlib")
                         : process_path ());
 
+      // None of the ar/ranlib implementations we recognize seem to use
+      // environment variables (not even Microsoft lib.exe).
+      //
+      auto insert = [&key, &arr, &rlr, &arp, &rlp] () -> const ar_info&
+      {
+        return ar_cache.insert (move (key),
+                                ar_info {
+                                  move (arp),
+                                  move (arr.id),
+                                  move (arr.signature),
+                                  move (arr.checksum),
+                                  move (*arr.version),
+                                  nullptr,
+
+                                  move (rlp),
+                                  move (rlr.id),
+                                  move (rlr.signature),
+                                  move (rlr.checksum),
+                                  nullptr});
+      };
+
+      // Next check the persistent cache, if enabled.
+      //
+      string pkey (persistent_key (key, arp, rl != nullptr ? &rlp : nullptr));
+
+      if (!pkey.empty () && load_results ("ar", pkey, arr, &rlr))
+      {
+        // Make sure the result is consistent with what we would have
+        // calculated below.
+        //
+        if (!arr.empty () && arr.version && (rl == nullptr) == rlr.empty ())
+          return insert ();
+
+        arr = guess_result ();
+        rlr = guess_result ();
+      }
+
       // We should probably assume the utility output language words can be
       // translated and even rearranged. Thus pass LC_ALL=C.
       //
@@ -341,23 +495,10 @@ namespace build2
           fail << "unable to guess " << *rl << " signature";
       }
 
-      // None of the ar/ranlib implementations we recognize seem to use
-      // environment variables (not even Microsoft lib.exe).
-      //
-      return ar_cache.insert (move (key),
-                              ar_info {
-                                move (arp),
-                                move (arr.id),
-                                move (arr.signature),
-                                move (arr.checksum),
-                                move (*arr.version),
-                                nullptr,
-
-                                move (rlp),
-                                move (rlr.id),
-                                move (rlr.signature),
-                                move (rlr.checksum),
-                                nullptr});
+      if (!pkey.empty ())
+        store_results ("ar", pkey, arr, &rlr);
+
+      return insert ();
     }
 
     // Linker environment variables (see also the cc module which duplicates
@@ -417,6 +558,36 @@ namespace build2
 
       process_path pp (search (ld, paths, "config.bin.ld"));
 
+      auto insert = [&key, &r, &pp] () -> const ld_info&
+      {
+        const char* const* ld_env ((r.id == "gnu"    ||
+                                    r.id == "gnu-gold") ? gnu_ld_env :
+                                   (r.id == "msvc"   ||
+                                    r.id == "msvc-lld") ? msvc_ld_env :
+                                   nullptr);
+
+        return ld_cache.insert (move (key),
+                                ld_info {
+                                  move (pp),
+                                  move (r.id),
+                                  move (r.signature),
+                                  move (r.checksum),
+                                  move (r.version),
+                                  ld_env});
+      };
+
+      // Next check the persistent cache, if enabled.
+      //
+      string pkey (persistent_key (key, pp));
+
+      if (!pkey.empty ())
+      {
+        if (load_results ("ld", pkey, r) && !r.empty ())
+          return insert ();
+
+        r = guess_result ();
+      }
+
       // We should probably assume the utility output language words can be
       // translated and even rearranged. Thus pass LC_ALL=C.
       //
@@ -577,20 +748,10 @@ namespace build2
       if (r.empty ())
         fail << "unable to guess " << ld << " signature";
 
-      const char* const* ld_env ((r.id == "gnu"    ||
-                                  r.id == "gnu-gold") ? gnu_ld_env :
-                                 (r.id == "msvc"   ||
-                                  r.id == "msvc-lld") ? msvc_ld_env :
-                                 nullptr);
+      if (!pkey.empty ())
+        store_results ("ld", pkey, r);
 
-      return ld_cache.insert (move (key),
-                              ld_info {
-                                move (pp),
-                                move (r.id),
-                                move (r.signature),
-                                move (r.checksum),
-                                move (r.version),
-                                ld_env});
+      return insert ();
     }
 
     // Resource compiler environment variables.
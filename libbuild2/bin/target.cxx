@@ -92,7 +92,7 @@ namespace build2
     {
       const G* g (ctx.targets.find<G> (dir, out, n));
 
-      M* m (new M (ctx, move (dir), move (out), move (n)));
+      M* m (new (ctx) M (ctx, move (dir), move (out), move (n)));
       m->group = g;
 
       return m;
@@ -0,0 +1,768 @@
+// file      : libbuild2/cc/cache.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/cc/cache.hxx>
+
+#ifndef _WIN32
+#  include <netdb.h>      // getaddrinfo()
+#  include <fcntl.h>      // fcntl()
+#  include <unistd.h>     // close()
+#  include <sys/time.h>   // timeval
+#  include <sys/socket.h>
+#endif
+
+#include <map>
+#include <deque>
+#include <cerrno>
+#include <cstring> // memcmp()
+
+#include <libbutl/sha256.hxx>
+#include <libbutl/filesystem.hxx> // cpfile(), mvfile(), try_mkdir_p()
+
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace cc
+  {
+    cache_backend::
+    ~cache_backend ()
+    {
+    }
+
+    // Temporary file for an atomic update of the specified file.
+    //
+    static inline path
+    temp_file (const path& f)
+    {
+      return f + ('.' + to_string (process::current_id ()) + ".tmp");
+    }
+
+    // Local directory cache.
+    //
+    // The entry with key <key> is stored as <dir>/<key[0,2]>/<key> to keep
+    // the directories reasonably sized.
+    //
+    class dir_cache: public cache_backend
+    {
+    public:
+      explicit
+      dir_cache (dir_path d): dir_ (move (d)) {}
+
+      virtual bool
+      load (const string&, const path&) override;
+
+      virtual void
+      store (const string&, const path&) override;
+
+    private:
+      path
+      entry (const string& k) const
+      {
+        return dir_ / dir_path (string (k, 0, 2)) / path (k);
+      }
+
+      dir_path dir_;
+    };
+
+    bool dir_cache::
+    load (const string& k, const path& f)
+    {
+      tracer trace ("cc::dir_cache::load");
+
+      path e (entry (k));
+
+      try
+      {
+        if (!file_exists (e))
+          return false;
+
+        cpfile (e, f, (cpflags::overwrite_content |
+                       cpflags::overwrite_permissions));
+
+        l5 ([&]{trace << "restored " << f << " from " << e;});
+        return true;
+      }
+      catch (const system_error& x)
+      {
+        l4 ([&]{trace << "unable to restore " << f << " from " << e << ": "
+                      << x;});
+        return false;
+      }
+    }
+
+    void dir_cache::
+    store (const string& k, const path& f)
+    {
+      tracer trace ("cc::dir_cache::store");
+
+      path e (entry (k));
+
+      // Copy to a temporary file in the same directory and then move it into
+      // place, which makes the update atomic with regards to concurrent
+      // readers and writers.
+      //
+      path t (temp_file (e));
+
+      try
+      {
+        try_mkdir_p (e.directory ());
+
+        cpfile (f, t, cpflags::overwrite_content);
+
+        butl::mvfile (t,
+                      e,
+                      (cpflags::overwrite_content |
+                       cpflags::overwrite_permissions));
+
+        l5 ([&]{trace << "stored " << f << " as " << e;});
+      }
+      catch (const system_error& x)
+      {
+        l4 ([&]{trace << "unable to store " << f << " as " << e << ": "
+                      << x;});
+        try_rmfile_ignore_error (t);
+      }
+    }
+
+    // Remote HTTP cache.
+    //
+#ifndef _WIN32
+    // Entry contents header. The SHA256 checksum of the file contents
+    // followed by a newline comes next.
+    //
+    static const char http_entry_header[] = "build2 cc cache 1\n";
+
+    // Network timeout in seconds.
+    //
+    static const int http_timeout = 30;
+
+    // Cap the amount of memory pending uploads can occupy. Entries that
+    // don't fit are dropped.
+    //
+    static const size_t http_upload_budget = 256 * 1024 * 1024;
+
+    class http_cache: public cache_backend
+    {
+    public:
+      // Return NULL if the URL is not http:// or fail if it is invalid.
+      //
+      static unique_ptr<cache_backend>
+      create (const string& url);
+
+      virtual bool
+      load (const string&, const path&) override;
+
+      virtual void
+      store (const string&, const path&) override;
+
+      virtual void
+      flush () override;
+
+      virtual
+      ~http_cache () override;
+
+    public:
+      http_cache (string u, string h, string p, string r)
+          : url_ (move (u)),
+            host_ (move (h)), port_ (move (p)), root_ (move (r)) {}
+
+    private:
+      // Perform the request returning the response status and body or
+      // nullopt if unable to communicate with the server, in which case
+      // also disable the backend. If the response body is truncated (that
+      // is, does not match the content length), then return 0 status
+      // without disabling the backend (the caller should treat it as a
+      // miss).
+      //
+      optional<uint16_t>
+      request (const char* method,
+               const string& key,
+               const vector<char>* body,
+               vector<char>* response);
+
+      void
+      upload (const string& key, const vector<char>& data);
+
+      void
+      thread_main ();
+
+    private:
+      string url_;
+      string host_;
+      string port_;
+      string root_; // Path with the trailing slash.
+
+      atomic<bool> disabled_ {false};
+
+      struct upload_entry
+      {
+        string key;
+        vector<char> data;
+      };
+
+      mutex mutex_;
+      condition_variable cv_;
+      deque<upload_entry> queue_; // Protected by mutex_.
+      size_t pending_ = 0;        // Bytes queued or being uploaded.
+      bool busy_ = false;         // Upload in progress.
+      bool stop_ = false;
+      thread thread_;             // Started on the first store.
+    };
+
+    unique_ptr<cache_backend> http_cache::
+    create (const string& u)
+    {
+      if (u.compare (0, 7, "http://") != 0)
+        return nullptr;
+
+      // http://<host>[:<port>][/<path>]
+      //
+      size_t p (7);
+      size_t n (u.size ());
+
+      string h;
+      if (p != n && u[p] == '[') // IPv6 address.
+      {
+        size_t e (u.find (']', p));
+
+        if (e == string::npos)
+          fail << "invalid remote cache URL '" << u << "'";
+
+        h.assign (u, p + 1, e - p - 1);
+        p = e + 1;
+      }
+      else
+      {
+        size_t e (u.find_first_of (":/", p));
+        h.assign (u, p, (e == string::npos ? n : e) - p);
+        p = e == string::npos ? n : e;
+      }
+
+      if (h.empty ())
+        fail << "missing host in remote cache URL '" << u << "'";
+
+      string pt ("80");
+      if (p != n && u[p] == ':')
+      {
+        size_t e (u.find ('/', ++p));
+        pt.assign (u, p, (e == string::npos ? n : e) - p);
+        p = e == string::npos ? n : e;
+
+        if (pt.empty () ||
+            pt.find_first_not_of ("0123456789") != string::npos)
+          fail << "invalid port in remote cache URL '" << u << "'";
+      }
+
+      if (p != n && u[p] != '/')
+        fail << "invalid remote cache URL '" << u << "'";
+
+      string r (p != n ? string (u, p) : string ("/"));
+
+      if (r.back () != '/')
+        r += '/';
+
+      return unique_ptr<cache_backend> (
+        new http_cache (u, move (h), move (pt), move (r)));
+    }
+
+    // Send the whole buffer returning false on failure.
+    //
+    static bool
+    send_all (int fd, const char* b, size_t n)
+    {
+#ifdef MSG_NOSIGNAL
+      const int flags (MSG_NOSIGNAL);
+#else
+      const int flags (0); // See SO_NOSIGPIPE below.
+#endif
+
+      while (n != 0)
+      {
+        ssize_t r (send (fd, b, n, flags));
+
+        if (r == -1)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return false;
+        }
+
+        b += r;
+        n -= static_cast<size_t> (r);
+      }
+
+      return true;
+    }
+
+    optional<uint16_t> http_cache::
+    request (const char* method,
+             const string& key,
+             const vector<char>* body,
+             vector<char>* response)
+    {
+      tracer trace ("cc::http_cache::request");
+
+      if (disabled_.load (memory_order_relaxed))
+        return nullopt;
+
+      // Disable the backend warning once about it. The error is either the
+      // errno value or the description.
+      //
+      auto disable = [this] (const char* what, int e, const char* d = nullptr)
+      {
+        if (!disabled_.exchange (true))
+        {
+          diag_record dr (warn);
+          dr << "unable to " << what << " remote cache " << url_;
+
+          if (e != 0)
+            dr << ": " << system_error (e, generic_category ()); // Sanitize.
+          else if (d != nullptr)
+            dr << ": " << d;
+
+          dr << info << "remote cache disabled for the rest of this build";
+        }
+
+        return nullopt;
+      };
+
+      addrinfo hints {};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+
+      addrinfo* ai;
+      if (int e = getaddrinfo (host_.c_str (), port_.c_str (), &hints, &ai))
+        return disable ("resolve", 0, gai_strerror (e));
+
+      auto_fd fd;
+      int err (0);
+
+      for (addrinfo* a (ai); a != nullptr; a = a->ai_next)
+      {
+        fd = auto_fd (socket (a->ai_family, a->ai_socktype, a->ai_protocol));
+
+        if (fd.get () == -1)
+        {
+          err = errno;
+          continue;
+        }
+
+        fcntl (fd.get (), F_SETFD, FD_CLOEXEC);
+
+        timeval tv {http_timeout, 0};
+        setsockopt (fd.get (), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+        setsockopt (fd.get (), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+
+#ifdef SO_NOSIGPIPE
+        int one (1);
+        setsockopt (fd.get (), SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof (one));
+#endif
+
+        if (connect (fd.get (), a->ai_addr, a->ai_addrlen) == 0)
+          break;
+
+        err = errno;
+        fd.reset ();
+      }
+
+      freeaddrinfo (ai);
+
+      if (fd.get () == -1)
+        return disable ("connect to", err);
+
+      // Note that we use HTTP/1.0 in order not to have to deal with the
+      // chunked transfer encoding and persistent connections.
+      //
+      string rq (method);
+      rq += ' ';
+      rq += root_;
+      rq += key;
+      rq += " HTTP/1.0\r\nHost: ";
+      rq += host_;
+      rq += "\r\nConnection: close\r\n";
+
+      if (body != nullptr)
+      {
+        rq += "Content-Type: application/octet-stream\r\n";
+        rq += "Content-Length: " + to_string (body->size ()) + "\r\n";
+      }
+
+      rq += "\r\n";
+
+      if (!send_all (fd.get (), rq.c_str (), rq.size ()) ||
+          (body != nullptr &&
+           !send_all (fd.get (), body->data (), body->size ())))
+        return disable ("send request to", errno);
+
+      // Read the whole response.
+      //
+      vector<char> rs;
+      for (char b[8192];; )
+      {
+        ssize_t r (recv (fd.get (), b, sizeof (b), 0));
+
+        if (r == -1)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return disable ("receive response from", errno);
+        }
+
+        if (r == 0)
+          break;
+
+        rs.insert (rs.end (), b, b + r);
+      }
+
+      // HTTP/1.x <code> <reason>\r\n<headers>\r\n\r\n<body>
+      //
+      static const char hs[] = "\r\n\r\n";
+      auto he (search (rs.begin (), rs.end (), hs, hs + 4));
+
+      if (he == rs.end ())
+        return disable ("parse response from", 0);
+
+      // Note that the header may well be shorter than the whole response.
+      //
+      string hd (rs.begin (), he);
+
+      if (hd.size () < 12                        ||
+          hd.compare (0, 7, "HTTP/1.") != 0      ||
+          hd[8] != ' ')
+        return disable ("parse response from", 0);
+
+      uint16_t st (0);
+
+      for (size_t i (9); i != 12; ++i)
+      {
+        char c (hd[i]);
+
+        if (c < '0' || c > '9')
+          return disable ("parse response from", 0);
+
+        st = st * 10 + static_cast<uint16_t> (c - '0');
+      }
+
+      l5 ([&]{trace << method << ' ' << root_ << key << ": " << st;});
+
+      if (response != nullptr)
+      {
+        response->assign (he + 4, rs.end ());
+
+        // Detect truncated responses if we have the length.
+        //
+        string lh (lcase (hd));
+        size_t p (lh.find ("\r\ncontent-length:"));
+
+        if (p != string::npos)
+        {
+          p += 17;
+
+          size_t e (lh.find ("\r\n", p));
+          string v (trim (string (lh, p, e == string::npos ? e : e - p)));
+
+          if (v != to_string (response->size ()))
+          {
+            l4 ([&]{trace << "truncated response for " << key << ": "
+                          << response->size () << " bytes instead of " << v;});
+            response->clear ();
+            return 0;
+          }
+        }
+      }
+
+      return st;
+    }
+
+    bool http_cache::
+    load (const string& k, const path& f)
+    {
+      tracer trace ("cc::http_cache::load");
+
+      vector<char> d;
+      optional<uint16_t> st (request ("GET", k, nullptr, &d));
+
+      if (!st || *st != 200)
+        return false;
+
+      // Verify the checksum.
+      //
+      const size_t hn (sizeof (http_entry_header) - 1);
+      const size_t cn (64 + 1); // SHA256 hex and newline.
+
+      if (d.size () < hn + cn                                 ||
+          memcmp (d.data (), http_entry_header, hn) != 0      ||
+          d[hn + cn - 1] != '\n'                              ||
+          sha256 (d.data () + hn + cn, d.size () - hn - cn).string () !=
+          string (d.data () + hn, cn - 1))
+      {
+        warn << "invalid or corrupted entry " << k << " in remote cache "
+             << url_;
+        return false;
+      }
+
+      path t (temp_file (f));
+
+      try
+      {
+        ofdstream os (t, fdopen_mode::binary);
+        os.write (d.data () + hn + cn,
+                  static_cast<streamsize> (d.size () - hn - cn));
+        os.close ();
+
+        butl::mvfile (t,
+                      f,
+                      (cpflags::overwrite_content |
+                       cpflags::overwrite_permissions));
+      }
+      catch (const io_error& e)
+      {
+        l4 ([&]{trace << "unable to write " << t << ": " << e;});
+        try_rmfile_ignore_error (t);
+        return false;
+      }
+      catch (const system_error& e)
+      {
+        l4 ([&]{trace << "unable to move " << t << " to " << f << ": " << e;});
+        try_rmfile_ignore_error (t);
+        return false;
+      }
+
+      l5 ([&]{trace << "restored " << f << " from " << url_;});
+      return true;
+    }
+
+    void http_cache::
+    store (const string& k, const path& f)
+    {
+      tracer trace ("cc::http_cache::store");
+
+      if (disabled_.load (memory_order_relaxed))
+        return;
+
+      // Read the file here (the caller may overwrite it as soon as we
+      // return) but do everything else in the background thread.
+      //
+      vector<char> d;
+      try
+      {
+        ifdstream is (f, fdopen_mode::binary, ifdstream::badbit);
+        d = is.read_binary ();
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        l4 ([&]{trace << "unable to read " << f << ": " << e;});
+        return;
+      }
+
+      mlock l (mutex_);
+
+      if (pending_ + d.size () > http_upload_budget)
+      {
+        l4 ([&]{trace << "upload budget exhausted, dropping " << k;});
+        return;
+      }
+
+      if (!thread_.joinable ())
+      {
+        try
+        {
+          thread_ = thread ([this] () {thread_main ();});
+        }
+        catch (const system_error& e)
+        {
+          l4 ([&]{trace << "unable to start upload thread: " << e;});
+          return;
+        }
+      }
+
+      pending_ += d.size ();
+      queue_.push_back (upload_entry {k, move (d)});
+
+      l.unlock ();
+      cv_.notify_all ();
+    }
+
+    void http_cache::
+    upload (const string& k, const vector<char>& d)
+    {
+      // Prefix the contents with the header and checksum. Note that we
+      // calculate the checksum here rather than in store() in order not to
+      // delay the build.
+      //
+      vector<char> b (http_entry_header,
+                      http_entry_header + sizeof (http_entry_header) - 1);
+
+      string cs (sha256 (d.data (), d.size ()).string ());
+      b.insert (b.end (), cs.begin (), cs.end ());
+      b.push_back ('\n');
+      b.insert (b.end (), d.begin (), d.end ());
+
+      optional<uint16_t> st (request ("PUT", k, &b, nullptr));
+
+      if (st && (*st < 200 || *st >= 300))
+      {
+        // The server is up but won't take the entry. Probably a
+        // misconfiguration so let's warn once and stop trying.
+        //
+        if (!disabled_.exchange (true))
+          warn << "unable to store entry in remote cache " << url_
+               << ": server responded with status " << *st <<
+            info << "remote cache disabled for the rest of this build";
+      }
+    }
+
+    void http_cache::
+    thread_main ()
+    {
+      mlock l (mutex_);
+
+      for (;;)
+      {
+        if (queue_.empty ())
+        {
+          if (stop_)
+            break;
+
+          cv_.wait (l);
+          continue;
+        }
+
+        upload_entry e (move (queue_.front ()));
+        queue_.pop_front ();
+        busy_ = true;
+
+        l.unlock ();
+
+        if (!disabled_.load (memory_order_relaxed))
+          upload (e.key, e.data);
+
+        l.lock ();
+
+        busy_ = false;
+        pending_ -= e.data.size ();
+
+        cv_.notify_all (); // Wake up flush().
+      }
+    }
+
+    void http_cache::
+    flush ()
+    {
+      mlock l (mutex_);
+
+      while (!queue_.empty () || busy_)
+        cv_.wait (l);
+    }
+
+    http_cache::
+    ~http_cache ()
+    {
+      if (thread_.joinable ())
+      {
+        {
+          mlock l (mutex_);
+          stop_ = true;
+        }
+
+        cv_.notify_all ();
+        thread_.join ();
+      }
+    }
+#endif
+
+    // Registry.
+    //
+    static map<string, cache_factory*>&
+    cache_schemes ()
+    {
+#ifndef _WIN32
+      static map<string, cache_factory*> r {{"http", &http_cache::create}};
+#else
+      static map<string, cache_factory*> r;
+#endif
+      return r;
+    }
+
+    void
+    register_cache_scheme (const string& s, cache_factory* f)
+    {
+      cache_schemes ()[s] = f;
+    }
+
+    // Note that the backends are only destroyed on process exit which also
+    // completes any pending uploads that were not flushed (see
+    // flush_caches()).
+    //
+    static mutex cache_mutex;
+    static map<string, unique_ptr<cache_backend>> cache_backends;
+
+    void
+    flush_caches ()
+    {
+      // Note that we don't hold the lock while flushing (which may take a
+      // while) since the backends are never removed.
+      //
+      vector<cache_backend*> bs;
+      {
+        mlock l (cache_mutex);
+
+        for (const auto& p: cache_backends)
+          bs.push_back (p.second.get ());
+      }
+
+      for (cache_backend* b: bs)
+        b->flush ();
+    }
+
+    cache_backend&
+    local_cache (const dir_path& d)
+    {
+      mlock l (cache_mutex);
+
+      unique_ptr<cache_backend>& r (cache_backends[d.representation ()]);
+
+      if (r == nullptr)
+        r.reset (new dir_cache (d));
+
+      return *r;
+    }
+
+    cache_backend&
+    remote_cache (const string& u)
+    {
+      mlock l (cache_mutex);
+
+      auto i (cache_backends.find (u));
+      if (i != cache_backends.end ())
+        return *i->second;
+
+      size_t p (u.find ("://"));
+
+      if (p == string::npos || p == 0)
+        fail << "invalid remote cache URL '" << u << "'";
+
+      string s (u, 0, p);
+
+      const auto& ss (cache_schemes ());
+      auto j (ss.find (s));
+
+      if (j == ss.end ())
+        fail << "unsupported remote cache URL scheme '" << s << "'";
+
+      unique_ptr<cache_backend> r (j->second (u));
+
+      if (r == nullptr)
+        fail << "unsupported remote cache URL '" << u << "'";
+
+      return *(cache_backends[u] = move (r));
+    }
+  }
+}
@@ -0,0 +1,103 @@
+// file      : libbuild2/cc/cache.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_CC_CACHE_HXX
+#define LIBBUILD2_CC_CACHE_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/cc/export.hxx>
+
+namespace build2
+{
+  namespace cc
+  {
+    // Build output cache backend (see config.cc.cache and
+    // config.cc.cache.remote).
+    //
+    // A backend maps opaque keys (checksums calculated by the rule) to file
+    // contents. It is expected to be MT-safe and no operation on it is
+    // expected to fail the build: a backend that is unable to load an entry
+    // treats it as a miss and one that is unable to store an entry simply
+    // drops it (after issuing a warning, if appropriate).
+    //
+    class LIBBUILD2_CC_SYMEXPORT cache_backend
+    {
+    public:
+      // Restore the entry with the specified key into the specified file
+      // returning false if there is no such entry or it could not be
+      // restored.
+      //
+      virtual bool
+      load (const string& key, const path& file) = 0;
+
+      // Store the specified file as the entry with the specified key. Note
+      // that the store can be asynchronous in which case the file contents
+      // is read before returning.
+      //
+      virtual void
+      store (const string& key, const path& file) = 0;
+
+      // Wait for any pending asynchronous stores to complete.
+      //
+      virtual void
+      flush () {}
+
+      virtual
+      ~cache_backend ();
+    };
+
+    // Create a backend for the specified remote cache URL. Return NULL if
+    // the URL is not supported by this factory.
+    //
+    using cache_factory = unique_ptr<cache_backend> (const string& url);
+
+    // Register the factory for the specified URL scheme (for example,
+    // https), replacing any previously registered one. The http scheme is
+    // registered by default (see below). Note that this function is not
+    // MT-safe and should normally be called during module initialization.
+    //
+    LIBBUILD2_CC_SYMEXPORT void
+    register_cache_scheme (const string& scheme, cache_factory*);
+
+    // Return the process-wide backend for the specified local cache
+    // directory, creating it if necessary.
+    //
+    LIBBUILD2_CC_SYMEXPORT cache_backend&
+    local_cache (const dir_path&);
+
+    // Return the process-wide backend for the specified remote cache URL,
+    // creating it if necessary. Fail if the URL scheme is not registered or
+    // the URL is invalid.
+    //
+    // The default http backend talks a simple protocol that should be
+    // easy to implement with any web server that supports uploads: the
+    // entry with key <key> is retrieved with GET and stored with PUT as
+    // <url>/<key> with 404 indicating a miss. The entry contents is prefixed
+    // with the SHA256 checksum of the file which is verified on download.
+    // Uploads are performed asynchronously by a background thread (see
+    // flush_caches()) so that storing an entry never delays the build. If
+    // the server cannot be reached or its response cannot be parsed, then
+    // the backend is disabled for the rest of the process. A truncated or
+    // corrupted entry is treated as a miss.
+    //
+    // Currently this backend is not supported on Windows.
+    //
+    LIBBUILD2_CC_SYMEXPORT cache_backend&
+    remote_cache (const string& url);
+
+    // Wait for the pending asynchronous stores of all the backends created
+    // so far to complete (see cache_backend::flush()).
+    //
+    // This function is called at the end of update (see core_config_init())
+    // so that the remaining uploads are performed (and any diagnostics
+    // issued) at a well-defined point rather than during static destruction
+    // on process exit (which only serves as a safety net).
+    //
+    LIBBUILD2_CC_SYMEXPORT void
+    flush_caches ();
+  }
+}
+
+#endif // LIBBUILD2_CC_CACHE_HXX
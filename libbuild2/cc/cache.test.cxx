@@ -0,0 +1,327 @@
+// file      : libbuild2/cc/cache.test.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef _WIN32
+#  include <unistd.h>      // close()
+#  include <netinet/in.h>
+#  include <arpa/inet.h>   // htonl()
+#  include <sys/socket.h>
+#endif
+
+#include <map>
+#include <iostream>
+
+#include <libbutl/filesystem.hxx> // auto_rmdir
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/cc/cache.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace cc
+  {
+#ifndef _WIN32
+    // Stand-in for the remote cache server: a minimal HTTP server on
+    // 127.0.0.1 that keeps the entries in memory.
+    //
+    class server
+    {
+    public:
+      server ()
+      {
+        fd_ = socket (AF_INET, SOCK_STREAM, 0);
+        assert (fd_ != -1);
+
+        sockaddr_in a {};
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        a.sin_port = 0; // Any.
+
+        socklen_t n (sizeof (a));
+        assert (bind (fd_, reinterpret_cast<sockaddr*> (&a), n) == 0);
+        assert (listen (fd_, 16) == 0);
+        assert (getsockname (fd_, reinterpret_cast<sockaddr*> (&a), &n) == 0);
+
+        port = ntohs (a.sin_port);
+        thread_ = thread ([this] () {run ();});
+      }
+
+      // Stop accepting connections.
+      //
+      ~server ()
+      {
+        shutdown (fd_, SHUT_RDWR);
+        thread_.join ();
+        close (fd_);
+      }
+
+      uint16_t port;
+
+      mutex mutex_;
+      map<string, string> entries;  // Protected by mutex_.
+      bool truncate = false;        // Close connection in the middle of
+                                    // the GET response body.
+      bool malformed = false;       // Omit the status code from the GET
+                                    // response status line.
+
+    private:
+      void
+      run ()
+      {
+        for (;;)
+        {
+          int c (accept (fd_, nullptr, nullptr));
+          if (c == -1)
+            break;
+
+          serve (c);
+          close (c);
+        }
+      }
+
+      void
+      serve (int c)
+      {
+        string rq;
+        char b[4096];
+
+        // Read the headers and then the body according to Content-Length.
+        //
+        size_t he;
+        for (; (he = rq.find ("\r\n\r\n")) == string::npos; )
+        {
+          ssize_t r (recv (c, b, sizeof (b), 0));
+          assert (r > 0);
+          rq.append (b, r);
+        }
+
+        size_t cl (0);
+        size_t p (rq.find ("Content-Length: "));
+        if (p != string::npos && p < he)
+          cl = stoul (string (rq, p + 16));
+
+        while (rq.size () < he + 4 + cl)
+        {
+          ssize_t r (recv (c, b, sizeof (b), 0));
+          assert (r > 0);
+          rq.append (b, r);
+        }
+
+        size_t m (rq.find (' '));
+        string method (rq, 0, m);
+        string target (rq, m + 1, rq.find (' ', m + 1) - m - 1);
+
+        string rs;
+        {
+          mlock l (mutex_);
+
+          if (method == "PUT")
+          {
+            entries[target] = string (rq, he + 4);
+            rs = "HTTP/1.0 201 Created\r\nContent-Length: 0\r\n\r\n";
+          }
+          else
+          {
+            assert (method == "GET");
+
+            auto i (entries.find (target));
+            if (i != entries.end () && malformed)
+              rs = "HTTP/1.0\r\n\r\n" + i->second;
+            else if (i != entries.end ())
+              rs = "HTTP/1.0 200 OK\r\nContent-Length: " +
+                to_string (i->second.size ()) + "\r\n\r\n" +
+                (truncate
+                 ? string (i->second, 0, i->second.size () / 2)
+                 : i->second);
+            else
+              rs = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+          }
+        }
+
+        for (size_t i (0); i != rs.size (); )
+        {
+          ssize_t r (send (c, rs.data () + i, rs.size () - i, 0));
+          assert (r > 0);
+          i += r;
+        }
+      }
+
+      int fd_;
+      thread thread_;
+    };
+#endif
+
+    static void
+    write_file (const path& f, const string& s)
+    {
+      ofdstream os (f, fdopen_mode::binary);
+      os << s;
+      os.close ();
+    }
+
+    static string
+    read_file (const path& f)
+    {
+      ifdstream is (f, fdopen_mode::binary);
+      string r (is.read_text ());
+      is.close ();
+      return r;
+    }
+
+    int
+    main (int, char*[])
+    {
+      dir_path d (dir_path::temp_path ("build2-cc-cache"));
+      try_mkdir_p (d);
+      auto_rmdir rm (d);
+
+      path f (d / "foo.o");
+      path g (d / "bar.o");
+
+      const string data ("\x7f" "ELF\n\0binary\r\n", 14);
+      write_file (f, data);
+
+      // Local cache.
+      //
+      {
+        cache_backend& c (local_cache (d / dir_path ("local")));
+        assert (&c == &local_cache (d / dir_path ("local")));
+
+        assert (!c.load ("abcdef", g));
+        c.store ("abcdef", f);
+        assert (c.load ("abcdef", g) && read_file (g) == data);
+      }
+
+#ifndef _WIN32
+      // Remote cache.
+      //
+      string k1 ("0123456789abcdef");
+      string k2 ("fedcba9876543210");
+      string k3 ("00112233aabbccdd");
+      {
+        server s;
+        string u ("http://127.0.0.1:" + to_string (s.port) + "/cc");
+
+        cache_backend& c (remote_cache (u));
+
+        // Miss.
+        //
+        assert (!c.load (k1, g));
+
+        // Store (asynchronously) and hit.
+        //
+        c.store (k1, f);
+        c.store (k2, f);
+        c.flush ();
+
+        {
+          mlock l (s.mutex_);
+          assert (s.entries.size () == 2 &&
+                  s.entries.find ("/cc/" + k1) != s.entries.end ());
+        }
+
+        rmfile (g);
+        assert (c.load (k1, g) && read_file (g) == data);
+
+        // Corrupted entry is treated as a miss.
+        //
+        {
+          mlock l (s.mutex_);
+          string& e (s.entries["/cc/" + k2]);
+          e.back () ^= 1;
+        }
+
+        assert (!c.load (k2, g));
+
+        // Short entry is treated as a miss.
+        //
+        {
+          mlock l (s.mutex_);
+          s.entries["/cc/" + k3] = "build2 cc cache 1\n";
+        }
+
+        assert (!c.load (k3, g));
+
+        // Truncated response (server closes the connection early) is
+        // treated as a miss and does not disable the backend.
+        //
+        {
+          mlock l (s.mutex_);
+          s.truncate = true;
+        }
+
+        assert (!c.load (k1, g));
+
+        {
+          mlock l (s.mutex_);
+          s.truncate = false;
+        }
+
+        rmfile (g);
+        assert (c.load (k1, g) && read_file (g) == data);
+      }
+
+      // Malformed response (the status line is shorter than the whole
+      // response but too short to contain the status code) disables the
+      // backend.
+      //
+      {
+        server s;
+        string u ("http://127.0.0.1:" + to_string (s.port) + "/malformed");
+
+        cache_backend& c (remote_cache (u));
+
+        c.store (k1, f);
+        c.flush ();
+
+        {
+          mlock l (s.mutex_);
+          s.malformed = true;
+        }
+
+        assert (!c.load (k1, g));
+
+        {
+          mlock l (s.mutex_);
+          s.malformed = false;
+        }
+
+        assert (!c.load (k1, g));
+      }
+
+      // Unreachable server disables the backend.
+      //
+      {
+        uint16_t port;
+        {
+          server s;
+          port = s.port;
+        }
+
+        string u ("http://127.0.0.1:" + to_string (port) + "/");
+        cache_backend& c (remote_cache (u));
+
+        assert (!c.load (k1, g));
+        c.store (k1, f);
+        c.flush ();
+      }
+#endif
+
+      return 0;
+    }
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  return build2::cc::main (argc, argv);
+}
@@ -813,6 +813,70 @@ namespace build2
         chain->pop_back ();
     }
 
+    // Return the interface closure of the library memoizing it on the first
+    // call.
+    //
+    // With deep library stacks the same interface dependencies are walked
+    // for every translation unit that depends on the library (and then again
+    // to extract prefixes; see compile_rule::append_library_options()),
+    // which becomes expensive. Because the options of
+    // a library are added on its first occurrence and all the subsequent
+    // occurrences are pruned (together with their interface dependencies,
+    // which by then have all been added), replaying this sequence while
+    // skipping the already appended libraries produces the same result as
+    // the walk.
+    //
+    const common::library_options& common::
+    library_closure (action a, const scope& bs,
+                     const file& l, bool la,
+                     linfo li,
+                     library_cache* lib_cache) const
+    {
+      closure_key k (&l, &bs, a.inner_id, a.outer_id, li.type, li.order);
+
+      {
+        slock sl (closures_mutex_);
+
+        auto i (closures_.find (k));
+        if (i != closures_.end ())
+          return i->second;
+      }
+
+      library_options r;
+      small_vector<const target*, 256> ls; // Appended libraries.
+
+      auto imp = [] (const target& l, bool la) {return la && l.is_a<libux> ();};
+
+      auto opt = [&r, &ls] (const target& l,
+                            const string& t, bool com, bool exp)
+      {
+        if (!exp) // Ignore libux.
+          return true;
+
+        if (find (ls.begin (), ls.end (), &l) != ls.end ())
+          return false;
+
+        r.push_back (library_option {&l, t, com});
+
+        if (com)
+          ls.push_back (&l);
+
+        return true;
+      };
+
+      process_libraries (a, bs, li, sys_lib_dirs,
+                         l, la, 0, // lflags unused.
+                         imp, nullptr, opt,
+                         false /* self */,
+                         false /* proc_opt_group */,
+                         lib_cache);
+
+      // If another thread beat us to it, then theirs is the same.
+      //
+      ulock ul (closures_mutex_);
+      return closures_.emplace (move (k), move (r)).first->second;
+    }
+
     // The name can be an absolute or relative target name (for example,
     // /tmp/libfoo/lib{foo} or ../libfoo/lib{foo}) or a project-qualified
     // relative target name (e.g., libfoo%lib{foo}).
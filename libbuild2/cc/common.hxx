@@ -400,6 +400,29 @@ namespace build2
         small_vector<const target*, 32>*,
         small_vector<const target*, 32>*) const;
 
+      // Interface closure of a library: the sequence of the opt callback
+      // calls (see process_libraries()) that contribute *.export.poptions,
+      // with the subsequent occurrences of each library pruned.
+      //
+      // Note that only the interface options are memoized. The walks that
+      // also process the libraries themselves (link_rule::append_libraries(),
+      // pkgconfig_save(), etc) depend on per-walk state (lflags, the
+      // dependency chain, the last occurrence deduplication) and are
+      // performed once per link rather than once per translation unit.
+      //
+      struct library_option
+      {
+        const target* lib;
+        string        lang;
+        bool          com;
+      };
+
+      using library_options = vector<library_option>;
+
+      const library_options&
+      library_closure (action, const scope&, const file&, bool, linfo,
+                       library_cache* = nullptr) const;
+
       const target*
       search_library (action a,
                       const dir_paths& sysd,
@@ -523,6 +546,18 @@ namespace build2
       //
       void
       append_diag_color_options (cstrings&) const;
+
+    private:
+      // Memoized library interface closures keyed by the library, the base
+      // scope of the dependent, the action, and the link information (see
+      // library_closure()).
+      //
+      using closure_key = tuple<const file*, const scope*,
+                                action_id, action_id,
+                                otype, lorder>;
+
+      mutable shared_mutex                      closures_mutex_;
+      mutable map<closure_key, library_options> closures_;
     };
   }
 }
@@ -18,12 +18,14 @@
 #include <libbuild2/filesystem.hxx>  // mtime()
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/make-parser.hxx>
+#include <libbuild2/mtime-prefetch.hxx>
 
 #include <libbuild2/bin/target.hxx>
 
 #include <libbuild2/cc/parser.hxx>
 #include <libbuild2/cc/target.hxx>  // h
 #include <libbuild2/cc/module.hxx>
+#include <libbuild2/cc/cache.hxx>
 #include <libbuild2/cc/utility.hxx>
 #include <libbuild2/cc/compiledb.hxx>
 
@@ -252,6 +254,7 @@ namespace build2
       prerequisite_member src;
       file_cache::entry psrc;               // Preprocessed source, if any.
       path dd;                              // Dependency database path.
+      string cache;                         // Object cache key, if any.
       size_t header_units = 0;              // Number of imported header units.
       module_positions modules = {0, 0, 0}; // Positions of imported modules.
 
@@ -290,6 +293,14 @@ namespace build2
           } while (s != ws);
         }
       }
+
+      // Setup the object caches, if any.
+      //
+      if (const auto* d = cast_null<abs_dir_path> (rs["config.cc.cache"]))
+        caches_.push_back (&local_cache (*d));
+
+      if (const auto* u = cast_null<string> (rs["config.cc.cache.remote"]))
+        caches_.push_back (&remote_cache (*u));
     }
 
     template <typename T>
@@ -725,6 +736,19 @@ namespace build2
         return true;
       };
 
+      // Unless we need the common options from the groups (in which case
+      // the library may be reached both as a member and as a group), replay
+      // the memoized closure instead of walking the interface dependencies.
+      //
+      if (!common)
+      {
+        for (const library_option& o:
+               library_closure (a, bs, l, la, li, lib_cache))
+          opt (*o.lib, o.lang, o.com, true /* exp */);
+
+        return;
+      }
+
       process_libraries (a, bs, li, sys_lib_dirs,
                          l, la, 0, // lflags unused.
                          imp, nullptr, opt,
@@ -808,8 +832,6 @@ namespace build2
         prefix_map&         pm;
       } d {ls, pm};
 
-      auto imp = [] (const target& l, bool la) {return la && l.is_a<libux> ();};
-
       auto opt = [&d, this] (const target& lt,
                              const string& t, bool com, bool exp)
       {
@@ -847,11 +869,6 @@ namespace build2
         return true;
       };
 
-      // The same logic as in append_library_options().
-      //
-      const function<bool (const target&, bool)> impf (imp);
-      const function<bool (const target&, const string&, bool, bool)> optf (opt);
-
       library_cache lib_cache;
       for (prerequisite_member p: group_prerequisite_members (a, t))
       {
@@ -869,12 +886,11 @@ namespace build2
                 pt->is_a<libs> ()))
             continue;
 
-          process_libraries (a, bs, li, sys_lib_dirs,
-                             pt->as<file> (), la, 0, // lflags unused.
-                             impf, nullptr, optf,
-                             false /* self */,
-                             false /* proc_opt_group */,
-                             &lib_cache);
+          // The same logic as in append_library_options().
+          //
+          for (const library_option& o:
+                 library_closure (a, bs, pt->as<file> (), la, li, &lib_cache))
+            opt (*o.lib, o.lang, o.com, true /* exp */);
         }
       }
     }
@@ -1265,6 +1281,7 @@ namespace build2
         // The idea is to keep them exactly as they are passed to the compiler
         // since the order may be significant.
         //
+        string ocs; // Also used in the object cache key (see below).
         {
           xxh64 cs;
 
@@ -1317,7 +1334,9 @@ namespace build2
           if (md.pp != preprocessed::all)
             append_sys_hdr_options (cs); // Extra system header dirs (last).
 
-          if (dd.expect (cs.string ()) != nullptr)
+          ocs = cs.string ();
+
+          if (dd.expect (ocs) != nullptr)
           {
             l4 ([&]{trace << "options mismatch forcing update of " << t;});
 
@@ -1466,6 +1485,8 @@ namespace build2
         // the header extraction phase (none of the module information should
         // be relevant).
         //
+        string tucs; // Translation unit checksum, if re-parsed.
+
         if (!md.deferred_failure)
         {
           optional<string> cs;
@@ -1488,6 +1509,8 @@ namespace build2
                 parse_unit (
                   a, t, li, src, psrc.first, readonly, md, dd.path, tu));
 
+              tucs = ncs;
+
               if (!cs || *cs != ncs)
               {
                 // Unchanged TU has a different (non-empty) checksum?
@@ -1599,6 +1622,36 @@ namespace build2
           }
         }
 
+        // If we are going to compile and the object cache is enabled, then
+        // calculate the cache entry key (see config.cc.cache for details).
+        //
+        // The key is the combination of everything that determines the
+        // object file: the compiler, its environment and options, the
+        // translation unit checksum (which covers the preprocessed token
+        // stream and its line information), and the target path (which ends
+        // up in the debug information). We only do this for non-modular
+        // translation units that don't import any header units or modules
+        // since the result also depends on the imported BMIs.
+        //
+        if (!caches_.empty ()            &&
+            u                            &&
+            !tucs.empty ()               &&
+            ut == unit_type::non_modular &&
+            md.header_units == 0         &&
+            md.modules.start == 0        &&
+            !ctx.dry_run)
+        {
+          xxh64 cs;
+          cs.append (rule_id);
+          cs.append (cast<string> (rs[x_checksum]));
+          cs.append (env_checksum);
+          cs.append (ocs);
+          cs.append (tucs);
+          cs.append (tp.string ());
+
+          md.cache = cs.string ();
+        }
+
         // If anything got updated, then we didn't rely on the cache. However,
         // the cached data could actually have been valid and the compiler run
         // in extract_headers() as well as the code above merely validated it.
@@ -3993,6 +4046,48 @@ namespace build2
           //
           assert (skip_count == 0);
 
+          // Queue the cached headers for the modification time prefetch so
+          // that loading them (which happens when the corresponding header
+          // targets are matched below) overlaps with the rest of the work.
+          //
+          // Note that the header paths are absolute and we skip the header
+          // unit lines (they are relatively rare).
+          //
+          // We also skip the headers that have already been entered (see
+          // enter_header()) and whose targets have the modification time
+          // loaded, which is normally the case for the headers shared by
+          // many translation units.
+          //
+          if (ctx.mtime_prefetch->enabled ())
+          {
+            const config_module& hc (*header_cache_);
+
+            dd.peek ([&ctx, &hc] (const char* l, size_t n)
+                     {
+                       if (n == 0) // Blank line terminates the list.
+                         return false;
+
+                       if (l[0] == '@')
+                         return true;
+
+                       config_module::header_key hk {path (string (l, n)), 0};
+                       hk.hash = hash<string> () (hk.file.string ());
+                       {
+                         slock sl (hc.header_map_mutex);
+
+                         auto i (hc.header_map.find (hk));
+                         if (i != hc.header_map.end () &&
+                             i->second.target->mtime () != timestamp_unknown)
+                           return true;
+                       }
+
+                       ctx.mtime_prefetch->prefetch (
+                         move (hk.file).string (), hk.hash);
+
+                       return true;
+                     });
+          }
+
           // We should always end with a blank line.
           //
           for (;;)
@@ -7420,6 +7515,10 @@ namespace build2
           if (!relo.empty () &&
               find_options ({"/Zi", "/ZI", "-Zi", "-ZI"}, args))
           {
+            // We don't cache .pdb files.
+            //
+            md.cache.clear ();
+
             if (fc)
               args.push_back ("/Fd:");
             else
@@ -7781,12 +7880,34 @@ namespace build2
       if (!env.empty ())
         env.push_back (nullptr);
 
+      // If we have the object cache key (see apply()), then try to restore
+      // the object file from the caches instead of compiling. If restored
+      // from a remote cache, then also store it in the local one. Note that
+      // in this case we don't replay any diagnostics (warnings) that the
+      // compiler may have issued.
+      //
+      bool restored (false);
+      if (!md.cache.empty ())
+      {
+        for (auto i (caches_.begin ()); i != caches_.end (); ++i)
+        {
+          if ((*i)->load (md.cache, tp))
+          {
+            for (auto j (caches_.begin ()); j != i; ++j)
+              (*j)->store (md.cache, tp);
+
+            restored = true;
+            break;
+          }
+        }
+      }
+
       // We have no choice but to serialize early if we want the command line
       // printed shortly before actually executing the compiler. Failed that,
       // it may look like we are still executing in parallel.
       //
       scheduler::alloc_guard jobs_ag;
-      if (!ctx.dry_run && cast_false<bool> (t[c_serialize]))
+      if (!restored && !ctx.dry_run && cast_false<bool> (t[c_serialize]))
         jobs_ag = scheduler::alloc_guard (*ctx.sched, phase_unlock (nullptr));
 
       // With verbosity level 2 print the command line as if we are compiling
@@ -7803,6 +7924,8 @@ namespace build2
 
         print_diag (name, s, t);
       }
+      else if (verb >= 2 && restored)
+        text << "restored " << tp << " from cache";
       else if (verb == 2)
         print_process (args);
 
@@ -7898,7 +8021,7 @@ namespace build2
           md.psrc.temporary = false;
       }
 
-      if (verb >= 3)
+      if (verb >= 3 && !restored)
         print_process (args);
 
       // @@ DRYRUN: Currently we discard the (partially) preprocessed file on
@@ -7910,7 +8033,7 @@ namespace build2
       // translation unit (i.e., one of the imported module's BMIs has
       // changed).
       //
-      if (!ctx.dry_run)
+      if (!ctx.dry_run && !restored)
       {
         try
         {
@@ -7966,6 +8089,12 @@ namespace build2
 
         if (md.deferred_failure)
           fail << "expected error exit status from " << x_lang << " compiler";
+
+        if (!md.cache.empty ())
+        {
+          for (cache_backend* c: caches_)
+            c->store (md.cache, tp);
+        }
       }
 
       // Remove preprocessed file (see above).
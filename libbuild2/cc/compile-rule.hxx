@@ -23,6 +23,7 @@ namespace build2
   namespace cc
   {
     class config_module;
+    class cache_backend;
 
     // The order is arranged so that their integral values indicate whether
     // one is a "stronger" than another.
@@ -207,6 +208,10 @@ namespace build2
     private:
       const string rule_id;
       const config_module* header_cache_;
+
+      // Object caches, local first (see config.cc.cache*).
+      //
+      small_vector<cache_backend*, 2> caches_;
     };
   }
 }
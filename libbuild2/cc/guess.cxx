@@ -68,6 +68,7 @@
 #include <cstring> // strlen(), strchr(), strstr()
 
 #include <libbuild2/diagnostics.hxx>
+#include <libbuild2/guess-cache.hxx>
 
 using namespace std;
 
@@ -3333,6 +3334,247 @@ namespace build2
     //
     static global_cache<compiler_info> cache;
 
+    // Persistent cache (see <libbuild2/guess-cache.hxx> for details).
+    //
+    // Increment the version if changing the compiler_info layout (or the
+    // way any of its members are calculated).
+    //
+    static const uint64_t guess_cache_version = 1;
+
+    // Environment variable lists that can be referenced by compiler_info.
+    // They are all included into the key (plus PATH) and are serialized as
+    // their position in this list (with 0 meaning NULL).
+    //
+    static const char* const* const guess_cache_envs[] = {
+      msvc_env,
+      gcc_c_env, gcc_cxx_env,
+      clang_c_env, clang_cxx_env,
+      macos_env};
+
+    static optional<uint64_t>
+    save_environment (const char* const* e)
+    {
+      if (e == nullptr)
+        return 0;
+
+      for (size_t i (0); i != sizeof (guess_cache_envs) / sizeof (e); ++i)
+      {
+        if (guess_cache_envs[i] == e)
+          return i + 1;
+      }
+
+      return nullopt;
+    }
+
+    static const char* const*
+    load_environment (uint64_t i)
+    {
+      if (i == 0)
+        return nullptr;
+
+      if (i > sizeof (guess_cache_envs) / sizeof (guess_cache_envs[0]))
+        throw invalid_argument ("invalid environment");
+
+      return guess_cache_envs[i - 1];
+    }
+
+    static void
+    save_version (guess_cache_writer& w, const compiler_version& v)
+    {
+      w.write_string (v.string);
+      w.write_uint (v.major);
+      w.write_uint (v.minor);
+      w.write_uint (v.patch);
+      w.write_string (v.build);
+    }
+
+    static compiler_version
+    load_version (guess_cache_reader& r)
+    {
+      compiler_version v;
+      v.string = r.read_string ();
+      v.major = r.read_uint ();
+      v.minor = r.read_uint ();
+      v.patch = r.read_uint ();
+      v.build = r.read_string ();
+      return v;
+    }
+
+    static void
+    save_dirs (guess_cache_writer& w,
+               const optional<pair<dir_paths, size_t>>& ds)
+    {
+      w.write_bool (ds.has_value ());
+
+      if (ds)
+      {
+        w.write_uint (ds->first.size ());
+        for (const dir_path& d: ds->first)
+          w.write_string (d.string ());
+        w.write_uint (ds->second);
+      }
+    }
+
+    static optional<pair<dir_paths, size_t>>
+    load_dirs (guess_cache_reader& r)
+    {
+      optional<pair<dir_paths, size_t>> ds;
+
+      if (r.read_bool ())
+      {
+        ds = pair<dir_paths, size_t> ();
+
+        for (uint64_t n (r.read_uint ()); n != 0; --n)
+          ds->first.push_back (dir_path (r.read_string ()));
+
+        ds->second = static_cast<size_t> (r.read_uint ());
+      }
+
+      return ds;
+    }
+
+    // Return nullopt if the information cannot be saved.
+    //
+    static optional<string>
+    save_compiler_info (const compiler_info& ci)
+    {
+      optional<uint64_t> ce (save_environment (ci.compiler_environment));
+      optional<uint64_t> pe (save_environment (ci.platform_environment));
+
+      const char* rp (ci.path.recall_string ());
+
+      if (!ce || !pe || rp == nullptr)
+        return nullopt;
+
+      guess_cache_writer w;
+
+      w.write_string (rp);
+      w.write_string (ci.path.effect.string ());
+
+      w.write_uint (static_cast<uint64_t> (ci.id.type));
+      w.write_string (ci.id.variant);
+      w.write_uint (static_cast<uint64_t> (ci.class_));
+
+      save_version (w, ci.version);
+
+      w.write_bool (ci.variant_version.has_value ());
+      if (ci.variant_version)
+        save_version (w, *ci.variant_version);
+
+      w.write_string (ci.signature);
+      w.write_string (ci.checksum);
+      w.write_string (ci.target);
+      w.write_string (ci.original_target);
+      w.write_string (ci.pattern);
+      w.write_string (ci.bin_pattern);
+      w.write_string (ci.runtime);
+      w.write_string (ci.c_stdlib);
+      w.write_string (ci.x_stdlib);
+
+      save_dirs (w, ci.sys_lib_dirs);
+      save_dirs (w, ci.sys_hdr_dirs);
+
+      w.write_bool (ci.std_mods.has_value ());
+      if (ci.std_mods)
+      {
+        w.write_uint (ci.std_mods->size ());
+        for (const std_module& m: *ci.std_mods)
+        {
+          w.write_string (m.name);
+          w.write_string (m.path.string ());
+
+          w.write_uint (m.poptions.size ());
+          for (const string& o: m.poptions)
+            w.write_string (o);
+        }
+      }
+
+      w.write_uint (*ce);
+      w.write_uint (*pe);
+
+      return move (w.data);
+    }
+
+    // Return nullopt if the data is invalid.
+    //
+    static optional<compiler_info>
+    load_compiler_info (const string& d)
+    {
+      try
+      {
+        guess_cache_reader r (d);
+        compiler_info ci;
+
+        {
+          path rp (r.read_string ());
+          path ep (r.read_string ());
+          ci.path = process_path (nullptr /* initial */, move (rp), move (ep));
+        }
+
+        uint64_t t (r.read_uint ());
+        if (t == 0 || t > static_cast<uint64_t> (compiler_type::icc))
+          throw invalid_argument ("invalid compiler type");
+
+        ci.id.type = static_cast<compiler_type> (t);
+        ci.id.variant = r.read_string ();
+
+        uint64_t c (r.read_uint ());
+        if (c > static_cast<uint64_t> (compiler_class::msvc))
+          throw invalid_argument ("invalid compiler class");
+
+        ci.class_ = static_cast<compiler_class> (c);
+
+        ci.version = load_version (r);
+
+        if (r.read_bool ())
+          ci.variant_version = load_version (r);
+
+        ci.signature = r.read_string ();
+        ci.checksum = r.read_string ();
+        ci.target = r.read_string ();
+        ci.original_target = r.read_string ();
+        ci.pattern = r.read_string ();
+        ci.bin_pattern = r.read_string ();
+        ci.runtime = r.read_string ();
+        ci.c_stdlib = r.read_string ();
+        ci.x_stdlib = r.read_string ();
+
+        ci.sys_lib_dirs = load_dirs (r);
+        ci.sys_hdr_dirs = load_dirs (r);
+
+        if (r.read_bool ())
+        {
+          ci.std_mods = std_modules ();
+
+          for (uint64_t n (r.read_uint ()); n != 0; --n)
+          {
+            std_module m;
+            m.name = r.read_string ();
+            m.path = path (r.read_string ());
+
+            for (uint64_t k (r.read_uint ()); k != 0; --k)
+              m.poptions.push_back (r.read_string ());
+
+            ci.std_mods->push_back (move (m));
+          }
+        }
+
+        ci.compiler_environment = load_environment (r.read_uint ());
+        ci.platform_environment = load_environment (r.read_uint ());
+
+        r.finish ();
+        return ci;
+      }
+      catch (const invalid_argument&)
+      {
+      }
+      catch (const invalid_path&)
+      {
+      }
+
+      return nullopt;
+    }
+
     const compiler_info&
     guess (context& ctx,
            const char* xm,
@@ -3383,6 +3625,41 @@ namespace build2
           return *r;
       }
 
+      // Next check the persistent cache, if enabled.
+      //
+      // For the key we use the in-process key plus the identity of the
+      // compiler executable as found in PATH (if it's not found, then we
+      // let the guess logic below deal with it, including trying the
+      // fallback locations) plus the environment.
+      //
+      string pkey;
+      if (guess_cache_enabled ())
+      {
+        process_path xp (run_try_search (xc,
+                                         false /* init */,
+                                         dir_path () /* fallback */,
+                                         true /* path_only */));
+        xxh64 cs;
+        if (!xp.empty () && append_program_identity (cs, xp))
+        {
+          static const char* path_env[] = {"PATH", nullptr};
+
+          cs.append (key);
+          cs.append (guess_cache_version);
+          append_environment (cs, path_env);
+          for (const char* const* e: guess_cache_envs)
+            append_environment (cs, e);
+
+          pkey = cs.string ();
+
+          if (optional<string> d = guess_cache_load ("cc", pkey))
+          {
+            if (optional<compiler_info> r = load_compiler_info (*d))
+              return cache.insert (move (key), move (*r));
+          }
+        }
+      }
+
       // Parse the user-specified compiler id (config.x.id).
       //
       optional<compiler_id> xi;
@@ -3536,6 +3813,12 @@ namespace build2
           r.bin_pattern = p.directory ().representation (); // Trailing slash.
       }
 
+      if (!pkey.empty ())
+      {
+        if (optional<string> d = save_compiler_info (r))
+          guess_cache_store ("cc", pkey, *d);
+      }
+
       return cache.insert (move (key), move (r));
     }
 
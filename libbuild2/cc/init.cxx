@@ -10,6 +10,7 @@
 
 #include <libbuild2/config/utility.hxx>
 
+#include <libbuild2/cc/cache.hxx>
 #include <libbuild2/cc/module.hxx>
 #include <libbuild2/cc/target.hxx>
 #include <libbuild2/cc/utility.hxx>
@@ -107,6 +108,14 @@ namespace build2
       return r;
     }
 
+    // Context operation callback for completing the pending cache stores.
+    //
+    static void
+    flush_caches_post (context&, action, const action_targets&, bool)
+    {
+      flush_caches ();
+    }
+
     // Detect if just <name> in the <name>[@<path>] form is actually <path>.
     // We assume it is <path> and not <name> if it contains a directory
     // component or is the special directory name (`.`/`..`) . If that's the
@@ -234,6 +243,12 @@ namespace build2
 
       vp.insert<abs_dir_path> ("config.cc.pkgconfig.sysroot");
 
+      // Object file cache local directory and remote URL (see the manual for
+      // details).
+      //
+      vp.insert<abs_dir_path> ("config.cc.cache");
+      vp.insert<string>       ("config.cc.cache.remote");
+
       // Compilation database.
       //
       // See the manual for the semantics.
@@ -527,6 +542,47 @@ namespace build2
       //
       lookup_config (rs, "config.cc.pkgconfig.sysroot");
 
+      // config.cc.cache
+      //
+      // Note: save omitted.
+      //
+      bool cache (lookup_config (rs, "config.cc.cache"));
+
+      // config.cc.cache.remote
+      //
+      // Note: save omitted.
+      //
+      if (lookup_config (rs, "config.cc.cache.remote"))
+        cache = true;
+
+      // Register context operation callback for completing the pending
+      // asynchronous cache stores at the end of update rather than on
+      // process exit (see flush_caches() for details). Register only once
+      // per context (note that there is no harm in flushing more than once
+      // if nested contexts inherit it).
+      //
+      if (cache)
+      {
+        using post_callback = context::operation_callback::post_callback;
+
+        auto r (ctx.operation_callbacks.equal_range (perform_update_id));
+
+        if (find_if (
+              r.first, r.second,
+              [] (const context::operation_callback_map::value_type& v)
+              {
+                const post_callback* const* f (
+                  v.second.post.target<post_callback*> ());
+
+                return f != nullptr && *f == &flush_caches_post;
+              }) == r.second)
+        {
+          ctx.operation_callbacks.emplace (
+            perform_update_id,
+            context::operation_callback {nullptr, &flush_caches_post});
+        }
+      }
+
       // Load the bin.config module.
       //
       if (!cast_false<bool> (rs["bin.config.build.loaded"]))
@@ -0,0 +1,750 @@
+// file      : libbuild2/cc/pkgconfig-native.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef BUILD2_BOOTSTRAP
+
+#include <libbuild2/cc/pkgconfig.hxx>
+
+#include <map>
+#include <cstring> // strchr(), memcmp()
+
+#include <libbuild2/diagnostics.hxx>
+
+namespace build2
+{
+  namespace cc
+  {
+    // Built-in .pc file parser.
+    //
+    // Unlike libpkgconf and libpkg-config, this implementation is
+    // thread-safe and caches the parsed files process-wide so that a .pc
+    // file that is imported by multiple projects (or, more commonly, that
+    // is required by multiple packages) is only parsed once. The cache
+    // entries are keyed by the file path and are invalidated if the file
+    // modification time changes.
+    //
+    // The semantics follows that of the libraries: the variables are
+    // expanded on load, the Cflags/Libs values are split into fragments
+    // (with the shell-like quoting), and the Requires and Requires.private
+    // packages are searched for in the directory of the loaded file
+    // followed by the pc_dirs directories, with their version constraints
+    // verified. The flags are collected from the package itself and then
+    // from its (transitively) required packages in the topological order
+    // with the duplicate fragments suppressed. Note that the -uninstalled
+    // variants and the sysroot relocation are not supported.
+    //
+    struct pkgconfig::package
+    {
+      struct requirement
+      {
+        string name;
+        string operation; // Empty if unconstrained.
+        string version;
+      };
+
+      path_type path;
+      string    version;
+
+      vector<pair<string, string>> vars; // Expanded.
+
+      strings cflags;
+      strings cflags_private;
+      strings libs;
+      strings libs_private;
+
+      vector<requirement> required;
+      vector<requirement> required_private;
+
+      const string*
+      find (const string& n) const
+      {
+        for (const pair<string, string>& v: vars)
+          if (v.first == n)
+            return &v.second;
+
+        return nullptr;
+      }
+    };
+
+    using package = pkgconfig::package;
+    using requirement = package::requirement;
+
+    // Expand the ${name} variable references and the $$ escapes.
+    //
+    static string
+    expand (const package& p, const string& v, const location& l)
+    {
+      string r;
+
+      for (size_t i (0), n (v.size ()); i != n; ++i)
+      {
+        char c (v[i]);
+
+        if (c == '$' && i + 1 != n)
+        {
+          if (v[i + 1] == '$')
+          {
+            r += '$';
+            ++i;
+            continue;
+          }
+
+          if (v[i + 1] == '{')
+          {
+            size_t e (v.find ('}', i + 2));
+
+            if (e == string::npos)
+              fail (l) << "unterminated variable reference in '" << v << "'";
+
+            // Undefined variables expand to empty, as in pkg-config.
+            //
+            if (const string* s = p.find (string (v, i + 2, e - i - 2)))
+              r += *s;
+
+            i = e;
+            continue;
+          }
+        }
+
+        r += c;
+      }
+
+      return r;
+    }
+
+    // Split the value into fragments handling the single/double quotes and
+    // backslash escapes, similar to pkgconf_argv_split().
+    //
+    static strings
+    split (const string& v, const location& l)
+    {
+      strings r;
+
+      string f;
+      bool frag (false); // Inside a fragment (which can be quoted empty).
+      char quote ('\0');
+
+      for (size_t i (0), n (v.size ()); i != n; ++i)
+      {
+        char c (v[i]);
+
+        if (quote != '\0')
+        {
+          if (c == quote)
+            quote = '\0';
+          else if (c == '\\' && quote == '"' && i + 1 != n)
+            f += v[++i];
+          else
+            f += c;
+
+          continue;
+        }
+
+        switch (c)
+        {
+        case ' ':
+        case '\t':
+          {
+            if (frag)
+            {
+              r.push_back (move (f));
+              f.clear ();
+              frag = false;
+            }
+            continue;
+          }
+        case '\'':
+        case '"':
+          {
+            quote = c;
+            break;
+          }
+        case '\\':
+          {
+            if (i + 1 != n)
+              c = v[++i];
+
+            f += c;
+            break;
+          }
+        default:
+          {
+            f += c;
+            break;
+          }
+        }
+
+        frag = true;
+      }
+
+      if (quote != '\0')
+        fail (l) << "unterminated quote in '" << v << "'";
+
+      if (frag)
+        r.push_back (move (f));
+
+      return r;
+    }
+
+    // Parse the list of required packages each optionally followed by the
+    // version constraint, for example:
+    //
+    // Requires: glib-2.0 >= 2.50, gobject-2.0 zlib>1.2
+    //
+    static vector<requirement>
+    parse_requires (const string& v, const location& l)
+    {
+      vector<requirement> r;
+
+      auto ws = [] (char c) {return c == ' ' || c == '\t' || c == ',';};
+      auto op = [] (char c) {return strchr ("<>=!", c) != nullptr;};
+
+      for (size_t i (0), n (v.size ()); ; )
+      {
+        for (; i != n && ws (v[i]); ++i) ;
+
+        if (i == n)
+          break;
+
+        requirement q;
+
+        for (; i != n && !ws (v[i]) && !op (v[i]); ++i)
+          q.name += v[i];
+
+        for (; i != n && (v[i] == ' ' || v[i] == '\t'); ++i) ;
+
+        if (i != n && op (v[i]))
+        {
+          for (; i != n && op (v[i]); ++i)
+            q.operation += v[i];
+
+          const string& o (q.operation);
+          if (o != "=" && o != "<" && o != ">" &&
+              o != "<=" && o != ">=" && o != "!=")
+            fail (l) << "invalid version operation '" << o << "' in '" << v
+                     << "'";
+
+          for (; i != n && (v[i] == ' ' || v[i] == '\t'); ++i) ;
+
+          for (; i != n && !ws (v[i]); ++i)
+            q.version += v[i];
+
+          if (q.version.empty ())
+            fail (l) << "missing version for '" << q.name << "' in '" << v
+                     << "'";
+        }
+
+        if (q.name.empty ())
+          fail (l) << "missing package name in '" << v << "'";
+
+        r.push_back (move (q));
+      }
+
+      return r;
+    }
+
+    // Compare versions the same way as pkg-config, that is, using the RPM
+    // version comparison algorithm (rpmvercmp()).
+    //
+    static int
+    compare_versions (const string& x, const string& y)
+    {
+      if (x == y)
+        return 0;
+
+      auto digit = [] (char c) {return c >= '0' && c <= '9';};
+      auto alpha = [] (char c)
+      {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+      };
+
+      const char* a (x.c_str ());
+      const char* b (y.c_str ());
+
+      while (*a != '\0' || *b != '\0')
+      {
+        for (; *a != '\0' && !digit (*a) && !alpha (*a) && *a != '~'; ++a) ;
+        for (; *b != '\0' && !digit (*b) && !alpha (*b) && *b != '~'; ++b) ;
+
+        // Tilde sorts before anything else, even the end of the version.
+        //
+        if (*a == '~' || *b == '~')
+        {
+          if (*a != '~') return 1;
+          if (*b != '~') return -1;
+
+          ++a;
+          ++b;
+          continue;
+        }
+
+        if (*a == '\0' || *b == '\0')
+          break;
+
+        const char* as (a);
+        const char* bs (b);
+
+        bool num (digit (*a));
+        if (num)
+        {
+          for (; digit (*a); ++a) ;
+          for (; digit (*b); ++b) ;
+        }
+        else
+        {
+          for (; alpha (*a); ++a) ;
+          for (; alpha (*b); ++b) ;
+        }
+
+        // Numeric segment is always newer than alpha.
+        //
+        if (bs == b)
+          return num ? 1 : -1;
+
+        if (num)
+        {
+          for (; *as == '0' && as + 1 != a; ++as) ;
+          for (; *bs == '0' && bs + 1 != b; ++bs) ;
+
+          if (a - as != b - bs)
+            return a - as < b - bs ? -1 : 1;
+        }
+
+        size_t an (a - as), bn (b - bs);
+        if (int c = memcmp (as, bs, an < bn ? an : bn))
+          return c < 0 ? -1 : 1;
+
+        if (an != bn)
+          return an < bn ? -1 : 1;
+      }
+
+      if (*a == '\0' && *b == '\0')
+        return 0;
+
+      return *a == '\0' ? -1 : 1;
+    }
+
+    static bool
+    satisfies (const string& v, const requirement& q)
+    {
+      const string& o (q.operation);
+
+      if (o.empty ())
+        return true;
+
+      int c (compare_versions (v, q.version));
+
+      return o == "="  ? c == 0 :
+             o == "!=" ? c != 0 :
+             o == "<"  ? c <  0 :
+             o == "<=" ? c <= 0 :
+             o == ">"  ? c >  0 :
+             /* ">=" */  c >= 0;
+    }
+
+    static package
+    parse (const path& f)
+    {
+      package r;
+      r.path = f;
+
+      const location l0 (r.path);
+
+      // Predefined variables.
+      //
+      r.vars.emplace_back ("pcfiledir", f.directory ().string ());
+
+      try
+      {
+        ifdstream is (f);
+
+        string s;
+        uint64_t ln (0), n (0); // Start and current line numbers.
+
+        for (string p; getline (is, p); )
+        {
+          ++n;
+
+          if (!p.empty () && p.back () == '\r')
+            p.pop_back ();
+
+          // Join the continuation lines.
+          //
+          if (!p.empty () && p.back () == '\\')
+          {
+            if (s.empty ())
+              ln = n;
+
+            p.pop_back ();
+            s += p;
+            continue;
+          }
+
+          if (s.empty ())
+            ln = n;
+
+          s += p;
+
+          // Strip the comment, if any, unescaping the \# sequences.
+          //
+          string v;
+          for (size_t i (0); i != s.size (); ++i)
+          {
+            char c (s[i]);
+
+            if (c == '\\' && i + 1 != s.size () && s[i + 1] == '#')
+            {
+              v += '#';
+              ++i;
+            }
+            else if (c == '#')
+              break;
+            else
+              v += c;
+          }
+
+          s.clear ();
+
+          const location l (r.path, ln);
+
+          // Trim and parse <name>=<value> or <name>: <value>.
+          //
+          size_t b (v.find_first_not_of (" \t"));
+          if (b == string::npos)
+            continue;
+
+          size_t e (b);
+          for (char c;
+               e != v.size () &&
+                 (((c = v[e]) >= 'a' && c <= 'z') ||
+                  (c >= 'A' && c <= 'Z')          ||
+                  (c >= '0' && c <= '9')          ||
+                  c == '_' || c == '.');
+               ++e) ;
+
+          string name (v, b, e - b);
+
+          for (; e != v.size () && (v[e] == ' ' || v[e] == '\t'); ++e) ;
+
+          if (name.empty () || e == v.size () || (v[e] != '=' && v[e] != ':'))
+            fail (l) << "invalid line '" << v << "'";
+
+          bool var (v[e] == '=');
+
+          b = v.find_first_not_of (" \t", e + 1);
+          e = v.find_last_not_of (" \t");
+
+          string val (
+            expand (r, b != string::npos ? string (v, b, e - b + 1) : "", l));
+
+          if (var)
+          {
+            auto i (find_if (r.vars.begin (), r.vars.end (),
+                             [&name] (const pair<string, string>& v)
+                             {
+                               return v.first == name;
+                             }));
+
+            if (i != r.vars.end ())
+              i->second = move (val);
+            else
+              r.vars.emplace_back (move (name), move (val));
+          }
+          else if (name == "Version")
+            r.version = move (val);
+          else if (name == "Cflags" || name == "CFlags" || name == "CFLAGS")
+            r.cflags = split (val, l);
+          else if (name == "Cflags.private" || name == "CFlags.private")
+            r.cflags_private = split (val, l);
+          else if (name == "Libs" || name == "LIBS")
+            r.libs = split (val, l);
+          else if (name == "Libs.private")
+            r.libs_private = split (val, l);
+          else if (name == "Requires")
+            r.required = parse_requires (val, l);
+          else if (name == "Requires.private")
+            r.required_private = parse_requires (val, l);
+
+          // Ignore Name, Description, Conflicts, etc.
+        }
+
+        if (!s.empty ())
+          fail (location (r.path, ln)) << "unterminated line continuation";
+
+        is.close ();
+      }
+      catch (const io_error& e)
+      {
+        fail (l0) << "unable to read: " << e;
+      }
+
+      return r;
+    }
+
+    // The parsed .pc files cache (modification time and package).
+    //
+    static shared_mutex pc_cache_mutex;
+    static map<path, pair<timestamp, shared_ptr<const package>>> pc_cache;
+
+    // Load the package returning NULL if the file does not exist.
+    //
+    static shared_ptr<const package>
+    load (const path& f)
+    {
+      timestamp mt;
+      try
+      {
+        mt = file_mtime (f);
+      }
+      catch (const system_error& e)
+      {
+        fail << "unable to stat " << f << ": " << e;
+      }
+
+      if (mt == timestamp_nonexistent)
+        return nullptr;
+
+      {
+        slock l (pc_cache_mutex);
+
+        auto i (pc_cache.find (f));
+        if (i != pc_cache.end () && i->second.first == mt)
+          return i->second.second;
+      }
+
+      // Note that if another thread beats us to it, then the result will be
+      // the same.
+      //
+      shared_ptr<const package> r (make_shared<package> (parse (f)));
+
+      ulock l (pc_cache_mutex);
+      pc_cache[f] = make_pair (mt, r);
+      return r;
+    }
+
+    pkgconfig::
+    pkgconfig (path_type p,
+               const dir_paths& pc_dirs,
+               const dir_paths& sys_lib_dirs,
+               const dir_paths& sys_hdr_dirs)
+        : path (move (p)),
+          sys_lib_dirs_ (sys_lib_dirs),
+          sys_hdr_dirs_ (sys_hdr_dirs)
+    {
+      pkg_ = load (path);
+
+      if (pkg_ == nullptr)
+        fail << "package '" << path << "' not found";
+
+      // Note that, as with the libraries, the directories of the required
+      // packages are not added to the search list.
+      //
+      pc_dirs_.push_back (path.directory ());
+
+      for (const dir_path& d: pc_dirs)
+      {
+        if (find (pc_dirs_.begin (), pc_dirs_.end (), d) == pc_dirs_.end ())
+          pc_dirs_.push_back (d);
+      }
+    }
+
+    // Return this package followed by its (transitively) required packages
+    // in the topological order (that is, each package before any package
+    // that it requires), loading them if necessary.
+    //
+    vector<const package*> pkgconfig::
+    closure (bool priv) const
+    {
+      assert (pkg_ != nullptr); // Must not be empty.
+
+      vector<const package*> r;
+
+      // Keep the loaded packages alive for the duration of the call (they
+      // are normally also kept alive by the cache).
+      //
+      vector<shared_ptr<const package>> ps;
+
+      // Visited packages. Note that we also skip the cycles, like
+      // pkg-config.
+      //
+      vector<const package*> vs;
+
+      auto visit = [&r, &ps, &vs, priv, this] (const package& p,
+                                                const auto& visit) -> void
+      {
+        vs.push_back (&p);
+
+        auto req = [&ps, &vs, &p, &visit, this] (const requirement& q)
+        {
+          shared_ptr<const package> d;
+          for (const dir_path& pd: pc_dirs_)
+          {
+            if ((d = load (pd / path_type (q.name + ".pc"))) != nullptr)
+              break;
+          }
+
+          if (d == nullptr)
+            fail << "package '" << q.name << "', required by '" << p.path
+                 << "', not found";
+
+          if (!satisfies (d->version, q))
+            fail << "package '" << q.name << "' version '" << d->version
+                 << "' does not satisfy requirement '" << q.name << ' '
+                 << q.operation << ' ' << q.version << "' of '" << p.path
+                 << "'" <<
+              info << "package file " << d->path;
+
+          if (find (vs.begin (), vs.end (), d.get ()) == vs.end ())
+          {
+            ps.push_back (d);
+            visit (*d, visit);
+          }
+        };
+
+        // Visit the required packages in the reverse order so that they end
+        // up in the declaration order once the result is reversed.
+        //
+        if (priv)
+        {
+          for (auto i (p.required_private.rbegin ());
+               i != p.required_private.rend ();
+               ++i)
+            req (*i);
+        }
+
+        for (auto i (p.required.rbegin ()); i != p.required.rend (); ++i)
+          req (*i);
+
+        r.push_back (&p); // Post-order.
+      };
+
+      visit (*pkg_, visit);
+
+      reverse (r.begin (), r.end ());
+      return r;
+    }
+
+    // Append fragments skipping the -I/-L options that refer to system
+    // directories as well as the duplicates. For the -l options keep the last
+    // occurrence (so that the libraries are still linked after the libraries
+    // that depend on them) and for everything else -- the first.
+    //
+    static void
+    append (strings& r,
+            const strings& frags,
+            char type,
+            const dir_paths& sysdirs)
+    {
+      assert (type == 'I' || type == 'L');
+
+      auto sys = [&sysdirs] (const string& v)
+      {
+        try
+        {
+          dir_path d (v);
+          d.normalize ();
+
+          return find (sysdirs.begin (), sysdirs.end (), d) != sysdirs.end ();
+        }
+        catch (const invalid_path&)
+        {
+          return false;
+        }
+      };
+
+      for (auto i (frags.begin ()), e (frags.end ()); i != e; ++i)
+      {
+        const string& f (*i);
+        bool opt (f.size () >= 2 && f[0] == '-' && f[1] == type);
+
+        // Option that is separated from its value, for example:
+        //
+        // -I /usr/lib
+        //
+        // Add the option and directory (unless the latter is a system one)
+        // without suppressing the duplicates.
+        //
+        if (opt && f.size () == 2)
+        {
+          if (i + 1 == e) // Add the dangling option.
+            r.push_back (f);
+          else if (!sys (*++i))
+          {
+            r.push_back (f);
+            r.push_back (*i);
+          }
+
+          continue;
+        }
+
+        if (opt && sys (string (f, 2)))
+          continue;
+
+        auto j (find (r.begin (), r.end (), f));
+
+        if (j != r.end ())
+        {
+          if (type == 'L' && f.size () > 2 && f[0] == '-' && f[1] == 'l')
+            r.erase (j);
+          else
+            continue;
+        }
+
+        r.push_back (f);
+      }
+    }
+
+    strings pkgconfig::
+    cflags (bool stat) const
+    {
+      strings r;
+
+      // Walk through the private package dependencies (Requires.private)
+      // besides the public ones while collecting the flags. Note that we do
+      // this for both static and shared linking.
+      //
+      for (const package* p: closure (true /* private */))
+      {
+        append (r, p->cflags, 'I', sys_hdr_dirs_);
+
+        // Collect flags from Cflags.private besides those from Cflags for
+        // the static linking.
+        //
+        if (stat)
+          append (r, p->cflags_private, 'I', sys_hdr_dirs_);
+      }
+
+      return r;
+    }
+
+    strings pkgconfig::
+    libs (bool stat) const
+    {
+      strings r;
+
+      // Additionally collect flags from the private dependency packages (see
+      // above) and from the Libs.private value for the static linking.
+      //
+      for (const package* p: closure (stat /* private */))
+      {
+        append (r, p->libs, 'L', sys_lib_dirs_);
+
+        if (stat)
+          append (r, p->libs_private, 'L', sys_lib_dirs_);
+      }
+
+      return r;
+    }
+
+    optional<string> pkgconfig::
+    variable (const char* name) const
+    {
+      assert (pkg_ != nullptr); // Must not be empty.
+
+      const string* r (pkg_->find (name));
+      return r != nullptr ? optional<string> (*r) : nullopt;
+    }
+  }
+}
+
+#endif // BUILD2_BOOTSTRAP
@@ -0,0 +1,196 @@
+// file      : libbuild2/cc/pkgconfig-native.test.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <iostream>
+
+#include <libbutl/filesystem.hxx> // auto_rmdir
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/cc/pkgconfig.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace cc
+  {
+#if defined(BUILD2_PKGCONFIG_NATIVE) && !defined(BUILD2_BOOTSTRAP)
+    static void
+    write_file (const path& f, const string& s)
+    {
+      ofdstream os (f);
+      os << s;
+      os.close ();
+    }
+
+    static string
+    join (const strings& ss)
+    {
+      string r;
+      for (const string& s: ss)
+      {
+        if (!r.empty ())
+          r += ' ';
+
+        r += s;
+      }
+      return r;
+    }
+
+    static bool
+    fails (const path& f, const dir_paths& pc_dirs = {})
+    {
+      try
+      {
+        pkgconfig pc (f, pc_dirs, dir_paths (), dir_paths ());
+        pc.cflags (true);
+        pc.libs (true);
+        return false;
+      }
+      catch (const failed&)
+      {
+        return true;
+      }
+    }
+#endif
+
+    int
+    main (int, char*[])
+    {
+#if defined(BUILD2_PKGCONFIG_NATIVE) && !defined(BUILD2_BOOTSTRAP)
+      dir_path d (dir_path::temp_path ("build2-cc-pkgconfig"));
+      try_mkdir_p (d);
+      auto_rmdir rm (d);
+
+      dir_path ld (d / dir_path ("lib"));
+      try_mkdir (ld);
+
+      dir_paths sys_hdr {dir_path ("/usr/include")};
+      dir_paths sys_lib {dir_path ("/usr/lib")};
+
+      write_file (
+        d / "foo.pc",
+        "# Comment.\n"
+        "prefix=/opt/foo\n"
+        "includedir=${prefix}/include # Trailing comment.\n"
+        "libdir=${prefix}/lib\n"
+        "hash=a\\#b\n"
+        "price=$$5\n"
+        "\n"
+        "Name: foo\n"
+        "Version: 1.2.3\n"
+        "Requires: bar >= 1.0, baz\n"
+        "Requires.private: qux<2.0\n"
+        "Cflags: -I${includedir} -I/usr/include -DFOO=\"a b\" \\\n"
+        "  -I /usr/include\n"
+        "Cflags.private: -DFOO_STATIC\n"
+        "Libs: -L${libdir} -L/usr/lib -lfoo\n"
+        "Libs.private: -lm\n");
+
+      write_file (
+        d / "bar.pc",
+        "Version: 1.10\n"
+        "Requires: baz\n"
+        "Cflags: -I/opt/bar/include -DBAR\n"
+        "Libs: -lbar\n");
+
+      write_file (
+        ld / "baz.pc",
+        "Version: 1.0\n"
+        "Cflags: -DBAZ -I/opt/bar/include\n"
+        "Libs: -lbaz\n");
+
+      write_file (
+        ld / "qux.pc",
+        "Version: 2.0~rc1\n"
+        "Cflags: -DQUX\n"
+        "Libs: -lqux\n");
+
+      // Variables, flags, and requirements.
+      //
+      {
+        pkgconfig pc (d / "foo.pc", {ld}, sys_lib, sys_hdr);
+
+        assert (*pc.variable ("includedir") == "/opt/foo/include");
+        assert (*pc.variable ("hash") == "a#b");
+        assert (*pc.variable ("price") == "$5");
+        assert (*pc.variable ("pcfiledir") == d.string ());
+        assert (!pc.variable ("name"));
+
+        assert (join (pc.cflags (false)) ==
+                "-I/opt/foo/include -DFOO=a b -I/opt/bar/include -DBAR "
+                "-DBAZ -DQUX");
+
+        assert (join (pc.cflags (true)) ==
+                "-I/opt/foo/include -DFOO=a b -DFOO_STATIC -I/opt/bar/include "
+                "-DBAR -DBAZ -DQUX");
+
+        assert (join (pc.libs (false)) == "-L/opt/foo/lib -lfoo -lbar -lbaz");
+
+        assert (join (pc.libs (true)) ==
+                "-L/opt/foo/lib -lfoo -lm -lbar -lbaz -lqux");
+      }
+
+      // Required packages are not searched for in the directories of other
+      // required packages.
+      //
+      assert (fails (d / "foo.pc"));
+
+      // Version constraints.
+      //
+      write_file (d / "ver1.pc", "Requires: bar > 1.9.9\n");
+      assert (!fails (d / "ver1.pc", {ld}));
+
+      write_file (d / "ver2.pc", "Requires: bar >= 1.10.1\n");
+      assert (fails (d / "ver2.pc", {ld}));
+
+      write_file (d / "ver3.pc", "Requires: qux >= 2.0\n");
+      assert (fails (d / "ver3.pc", {ld}));
+
+      // Invalid files.
+      //
+      write_file (d / "bad.pc", "Cflags -DBAD\n");
+      assert (fails (d / "bad.pc"));
+
+      write_file (d / "bad.pc", "Cflags: \"-DBAD\n");
+      assert (fails (d / "bad.pc"));
+
+      write_file (d / "bad.pc", "Requires: foo >> 1\n");
+      assert (fails (d / "bad.pc"));
+
+      assert (fails (d / "none.pc"));
+
+      // Modified file is reloaded.
+      //
+      {
+        path f (d / "mod.pc");
+
+        write_file (f, "Libs: -lmod1\n");
+        file_mtime (f, timestamp (chrono::seconds (1000)));
+
+        assert (join (pkgconfig (f, {}, {}, {}).libs (false)) == "-lmod1");
+
+        write_file (f, "Libs: -lmod2\n");
+        file_mtime (f, timestamp (chrono::seconds (2000)));
+
+        assert (join (pkgconfig (f, {}, {}, {}).libs (false)) == "-lmod2");
+      }
+#endif
+
+      return 0;
+    }
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  return build2::cc::main (argc, argv);
+}
@@ -9,7 +9,9 @@
 //
 #ifndef BUILD2_BOOTSTRAP
 
-#ifndef BUILD2_LIBPKGCONF
+#if defined(BUILD2_PKGCONFIG_NATIVE)
+   // Built-in .pc file parser (see pkgconfig-native.cxx).
+#elif !defined(BUILD2_LIBPKGCONF)
 #  include <libpkg-config/pkg-config.h>
 #else
 #  include <libpkgconf/libpkgconf.h>
@@ -52,12 +54,18 @@ namespace build2
       // an object is illegal.
       //
       pkgconfig () = default;
-      ~pkgconfig ();
 
       // Movable-only type.
       //
+#ifndef BUILD2_PKGCONFIG_NATIVE
+      ~pkgconfig ();
+
       pkgconfig (pkgconfig&&) noexcept;
       pkgconfig& operator= (pkgconfig&&) noexcept;
+#else
+      pkgconfig (pkgconfig&&) = default;
+      pkgconfig& operator= (pkgconfig&&) = default;
+#endif
 
       pkgconfig (const pkgconfig&) = delete;
       pkgconfig& operator= (const pkgconfig&) = delete;
@@ -74,6 +82,20 @@ namespace build2
       optional<string>
       variable (const string& s) const {return variable (s.c_str ());}
 
+#ifdef BUILD2_PKGCONFIG_NATIVE
+    public:
+      struct package; // Parsed .pc file.
+
+    private:
+      vector<const package*>
+      closure (bool private_) const;
+
+      shared_ptr<const package> pkg_;
+
+      dir_paths pc_dirs_; // Package file directory first.
+      dir_paths sys_lib_dirs_;
+      dir_paths sys_hdr_dirs_;
+#else
     private:
       void
       free ();
@@ -84,9 +106,11 @@ namespace build2
 #else
       pkgconf_client_t* client_ = nullptr;
       pkgconf_pkg_t* pkg_ = nullptr;
+#endif
 #endif
     };
 
+#ifndef BUILD2_PKGCONFIG_NATIVE
     inline pkgconfig::
     ~pkgconfig ()
     {
@@ -121,6 +145,7 @@ namespace build2
       }
       return *this;
     }
+#endif
   }
 }
 
@@ -9,9 +9,12 @@
 #include <libbuild2/rule.hxx>
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
+#include <libbuild2/profile.hxx>
+#include <libbuild2/timeline.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/function.hxx>
 #include <libbuild2/diagnostics.hxx>
+#include <libbuild2/mtime-prefetch.hxx>
 
 #include <libbutl/ft/exception.hxx> // uncaught_exceptions
 
@@ -42,6 +45,8 @@ namespace build2
 
   struct context::data
   {
+    dir_pool dirs; // Note: must be destroyed after scopes and targets.
+    mtime_prefetcher mtime_prefetch;
     scope_map scopes;
     target_set targets;
     variable_pool var_pool;
@@ -55,9 +60,15 @@ namespace build2
     strings original_var_overrides;
     context::entered_var_overrides_map entered_var_overrides;
 
-    data (context& c)
-        : scopes (c),
-          targets (c),
+    // Note that the target set (and directory pool) shard count is normally
+    // derived from the scheduler's shard size (one for the special
+    // contexts).
+    //
+    data (context& c, size_t target_shards)
+        : dirs (target_shards),
+          mtime_prefetch (target_shards, mtime_prefetch_threads),
+          scopes (c),
+          targets (c, target_shards),
           var_pool (&c /* shared */, nullptr /* outer */, &var_patterns),
           var_patterns (&c /* shared */, &var_pool) {}
   };
@@ -68,7 +79,7 @@ namespace build2
     assert (phase == run_phase::load);
 
     if (res.targets != 0)
-      data_->targets.map_.reserve (res.targets);
+      data_->targets.reserve (res.targets);
 
     if (res.variables != 0)
       data_->var_pool.map_.reserve (res.variables);
@@ -265,6 +276,8 @@ namespace build2
           nullptr /* overrides */,
           v});
 
+      p->id = variable_id (p->name);
+
       // Back link.
       //
       p->aliases = p.get ();
@@ -321,7 +334,7 @@ namespace build2
            optional<context*> mc,
            const module_libraries_lock* ml,
            const function<var_override_function>& var_ovr_func)
-      : data_ (new data (*this)),
+      : data_ (new data (*this, s.shard_size ())),
         sched (&s),
         mutexes (&ms),
         fcache (&fc),
@@ -331,6 +344,8 @@ namespace build2
         no_diag_buffer (ndb),
         keep_going (kg),
         phase_mutex (*this),
+        dirs (data_->dirs),
+        mtime_prefetch (&data_->mtime_prefetch),
         scopes (data_->scopes),
         targets (data_->targets),
         var_pool (data_->var_pool),
@@ -753,7 +768,7 @@ namespace build2
 
   context::
   context (bool ndb)
-      : data_ (new data (*this)),
+      : data_ (new data (*this, 1 /* target_shards */)),
         sched (nullptr),
         mutexes (nullptr),
         fcache (nullptr),
@@ -763,6 +778,8 @@ namespace build2
         no_diag_buffer (ndb),
         keep_going (false),
         phase_mutex (*this),
+        dirs (data_->dirs),
+        mtime_prefetch (&data_->mtime_prefetch),
         scopes (data_->scopes),
         targets (data_->targets),
         var_pool (data_->var_pool),
@@ -898,7 +915,7 @@ namespace build2
 
   context::
   context ()
-      : data_ (new data (*this)),
+      : data_ (new data (*this, 1 /* target_shards */)),
         sched (nullptr),
         mutexes (nullptr),
         fcache (nullptr),
@@ -908,6 +925,8 @@ namespace build2
         no_diag_buffer (false),
         keep_going (false),
         phase_mutex (*this),
+        dirs (data_->dirs),
+        mtime_prefetch (&data_->mtime_prefetch),
         scopes (data_->scopes),
         targets (data_->targets),
         var_pool (data_->var_pool),
@@ -1117,6 +1136,19 @@ namespace build2
     }
   }
 
+  static inline profile::phase
+  profile_phase (run_phase p)
+  {
+    switch (p)
+    {
+    case run_phase::load:    return profile::phase::load;
+    case run_phase::match:   return profile::phase::match;
+    case run_phase::execute: return profile::phase::execute;
+    }
+
+    return profile::phase::load;
+  }
+
   bool run_phase_mutex::
   lock (run_phase n)
   {
@@ -1144,6 +1176,12 @@ namespace build2
       {
         ctx_.phase = n;
         r = !fail_;
+
+        if (ctx_.profile != nullptr)
+          ctx_.profile->switch_phase (profile_phase (n));
+
+        if (timeline* t = timeline::instance)
+          t->phase (n);
       }
       else if (ctx_.phase != n)
       {
@@ -1213,6 +1251,12 @@ namespace build2
 
         ctx_.phase = n;
 
+        if (ctx_.profile != nullptr)
+          ctx_.profile->switch_phase (profile_phase (n));
+
+        if (timeline* t = timeline::instance)
+          t->phase (n);
+
         // Enter/leave scheduler sub-phase. See also the other half in
         // relock().
         //
@@ -1270,6 +1314,12 @@ namespace build2
         ctx_.phase = n;
         r = !fail_;
 
+        if (ctx_.profile != nullptr)
+          ctx_.profile->switch_phase (profile_phase (n));
+
+        if (timeline* t = timeline::instance)
+          t->phase (n);
+
         // Enter/leave scheduler sub-phase. See also the other half in
         // unlock().
         //
@@ -20,6 +20,7 @@
 
 namespace build2
 {
+  class profile;
   class file_cache;
   class module_libraries_lock;
 
@@ -239,6 +240,15 @@ namespace build2
     run_phase phase = run_phase::load;
     size_t load_generation = 0;
 
+    // Variable generation. Incremented whenever a variable is added to or
+    // removed from a scope variable map as well as when the variable
+    // visibility changes. Used to invalidate the scope variable lookup cache
+    // (see scope::lookup_original() for details).
+    //
+    // Note must come (and thus initialized) before the data_ member.
+    //
+    relaxed_atomic<size_t> var_generation = 0;
+
   private:
     struct data;
     unique_ptr<data> data_;
@@ -328,6 +338,15 @@ namespace build2
     const vector<name>* trace_match = nullptr;
     const vector<name>* trace_execute = nullptr;
 
+    // Build time profile (see --stat and profile.hxx for details).
+    //
+    // If not NULL, then phase switches as well as rule match, apply, and
+    // execute times are recorded in this profile. Note that it must be set
+    // after construction, must remain valid for the lifetime of the context
+    // instance, and is propagated to the nested contexts.
+    //
+    build2::profile* profile = nullptr;
+
     // A "tri-mutex" that keeps all the threads in one of the three phases.
     // When a thread wants to switch a phase, it has to wait for all the other
     // threads to do the same (or release their phase locks). The load phase
@@ -522,6 +541,13 @@ namespace build2
 
     // Build state (scopes, targets, variables, etc).
     //
+    dir_pool& dirs;
+
+    // Note that the nested module and update-during-load contexts share the
+    // outer context's prefetcher (see <libbuild2/mtime-prefetch.hxx>).
+    //
+    mtime_prefetcher* mtime_prefetch;
+
     const scope_map& scopes;
     target_set& targets;
     const variable_pool& var_pool;           // Public variables pool.
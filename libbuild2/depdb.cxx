@@ -7,6 +7,7 @@
 #  include <libbutl/win32-utility.hxx>
 #endif
 
+#include <libbuild2/snapshot.hxx>
 #include <libbuild2/filesystem.hxx>  // mtime()
 #include <libbuild2/diagnostics.hxx>
 
@@ -19,14 +20,10 @@ namespace build2
   //
   depdb_base::
   depdb_base (const path& p, bool ro, state s, optional<uint64_t> pos)
-      : state_ (s), ro_ (ro)
+      : state_ (s), ro_ (ro), rpos_ (0), buf_ (nullptr)
   {
     if (s == state::write && ro)
-    {
-      new (&is_) ifdstream ();
-      buf_ = nullptr; // Shouldn't be needed.
       return;
-    }
 
     fdopen_mode om (fdopen_mode::binary);
     ifdstream::iostate em (ifdstream::badbit);
@@ -79,14 +76,39 @@ namespace build2
       fail << "unable to rewind " << p << ": " << e;
     }
 
-    // Open the corresponding stream. Note that if we throw after that, the
+    // In the read mode load the entire content keeping the file descriptor
+    // to be able to switch to writing.
+    //
+    // Otherwise, open the stream. Note that if we throw after that, the
     // corresponding member will not be destroyed. This is the reason for the
     // depdb/base split.
     //
     if (state_ == state::read)
     {
-      new (&is_) ifdstream (move (fd), em);
-      buf_ = static_cast<fdstreambuf*> (is_.rdbuf ());
+      try
+      {
+        uint64_t n (fdstat (fd.get ()).size);
+
+        ifdstream is (move (fd), em);
+
+        data_.resize (static_cast<size_t> (n));
+
+        if (n != 0)
+        {
+          is.read (&data_[0], static_cast<streamsize> (n));
+          data_.resize (static_cast<size_t> (is.gcount ()));
+        }
+
+        fd_ = is.release ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to read from " << p << ": " << e;
+      }
+      catch (const system_error& e) // fdstat()
+      {
+        fail << "unable to stat " << p << ": " << e;
+      }
     }
     else
     {
@@ -138,17 +160,13 @@ namespace build2
   {
     assert (state_ != state::write);
 
-    if (ro_)
-    {
-      buf_ = nullptr;
-    }
-    else
+    if (!ro_)
     {
-      // Transfer the file descriptor from ifdstream to ofdstream. Note that
-      // the steps in this dance must be carefully ordered to make sure we
-      // don't call any destructors twice in the face of exceptions.
+      // Transfer the file descriptor to ofdstream. Note that the steps in
+      // this dance must be carefully ordered to make sure we don't call any
+      // destructors twice in the face of exceptions.
       //
-      auto_fd fd (is_.release ());
+      auto_fd fd (move (fd_));
 
       // Consider this scenario: we are overwriting an old line (so it ends
       // with a newline and the "end marker") but the operation failed half
@@ -168,9 +186,9 @@ namespace build2
         fail << "unable to truncate " << path << ": " << e;
       }
 
-      // Note: the file descriptor position can be beyond the pos_ value due
-      // to the ifdstream buffering. That's why we need to seek to switch from
-      // reading to writing.
+      // Note: the file descriptor position is beyond the pos_ value since we
+      // have read the entire content. That's why we need to seek to switch
+      // from reading to writing.
       //
       try
       {
@@ -184,13 +202,16 @@ namespace build2
       // @@ Strictly speaking, ofdstream can throw which will leave us in a
       //    non-destructible state. Unlikely but possible.
       //
-      is_.~ifdstream ();
       new (&os_) ofdstream (move (fd),
                             ofdstream::badbit | ofdstream::failbit,
                             pos_);
       buf_ = static_cast<fdstreambuf*> (os_.rdbuf ());
     }
 
+    // We no longer need the content.
+    //
+    string ().swap (data_);
+
     state_ = state::write;
     mtime = timestamp_unknown;
   }
@@ -200,49 +221,46 @@ namespace build2
   {
     // Save the start position of this line so that we can overwrite it.
     //
-    pos_ = buf_->tellg ();
+    pos_ = rpos_;
 
-    try
-    {
-      // Note that we intentionally check for eof after updating the write
-      // position.
-      //
-      if (state_ == state::read_eof)
-        return nullptr;
+    // Note that we intentionally check for eof after updating the write
+    // position.
+    //
+    if (state_ == state::read_eof)
+      return nullptr;
 
-      getline (is_, line_); // Calls line_.erase().
+    // The line should always end with a newline. If it doesn't, then this
+    // line (and the rest of the database) is assumed corrupted. Also peek at
+    // the character after the newline. We should either have the next line
+    // or '\0', which is our "end marker", that is, it indicates the database
+    // was properly closed.
+    //
+    const char* b (data_.c_str ());
+    size_t n (data_.size ());
 
-      // The line should always end with a newline. If it doesn't, then this
-      // line (and the rest of the database) is assumed corrupted. Also peek
-      // at the character after the newline. We should either have the next
-      // line or '\0', which is our "end marker", that is, it indicates the
-      // database was properly closed.
-      //
-      ifdstream::int_type c;
-      if (is_.fail () || // Nothing got extracted.
-          is_.eof ()  || // Eof reached before delimiter.
-          (c = is_.peek ()) == ifdstream::traits_type::eof ())
-      {
-        // Preemptively switch to writing. While we could have delayed this
-        // until the user called write(), if the user calls read() again (for
-        // whatever misguided reason) we will mess up the overwrite position.
-        //
-        change ();
-        return nullptr;
-      }
+    const char* p (
+      static_cast<const char*> (memchr (b + rpos_, '\n', n - rpos_)));
 
-      // Handle the "end marker". Note that the caller can still switch to the
-      // write mode on this line. And, after calling read() again, write to
-      // the next line (i.e., start from the "end marker").
-      //
-      if (c == '\0')
-        state_ = state::read_eof;
-    }
-    catch (const io_error& e)
+    if (p == nullptr || static_cast<size_t> (p - b) + 1 == n)
     {
-      fail << "unable to read from " << path << ": " << e;
+      // Preemptively switch to writing. While we could have delayed this
+      // until the user called write(), if the user calls read() again (for
+      // whatever misguided reason) we will mess up the overwrite position.
+      //
+      change ();
+      return nullptr;
     }
 
+    line_.assign (b + rpos_, p - (b + rpos_));
+    rpos_ = static_cast<size_t> (p - b) + 1;
+
+    // Handle the "end marker". Note that the caller can still switch to the
+    // write mode on this line. And, after calling read() again, write to the
+    // next line (i.e., start from the "end marker").
+    //
+    if (b[rpos_] == '\0')
+      state_ = state::read_eof;
+
     return &line_;
   }
 
@@ -256,28 +274,28 @@ namespace build2
 
     // The rest is pretty similar in logic to read_() above.
     //
-    pos_ = buf_->tellg ();
+    pos_ = rpos_;
 
-    try
+    // Keep looking for newlines checking for the end marker after each.
+    //
+    const char* b (data_.c_str ());
+    size_t n (data_.size ());
+
+    for (size_t i (rpos_); i != n; )
     {
-      // Keep reading lines checking for the end marker after each newline.
-      //
-      ifdstream::int_type c;
-      do
+      const char* p (static_cast<const char*> (memchr (b + i, '\n', n - i)));
+
+      if (p == nullptr)
+        break;
+
+      i = static_cast<size_t> (p - b) + 1;
+
+      if (i != n && b[i] == '\0')
       {
-        if ((c = is_.get ()) == '\n')
-        {
-          if ((c = is_.get ()) == '\0')
-          {
-            state_ = state::read_eof;
-            return true;
-          }
-        }
-      } while (c != ifdstream::traits_type::eof ());
-    }
-    catch (const io_error& e)
-    {
-      fail << "unable to read from " << path << ": " << e;
+        rpos_ = i;
+        state_ = state::read_eof;
+        return true;
+      }
     }
 
     // Invalid database so change over to writing.
@@ -333,7 +351,16 @@ namespace build2
   {
     if (ro_)
     {
-      is_.close ();
+      if (state_ != state::write)
+      try
+      {
+        fd_.close ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to close " << path << ": " << e;
+      }
+
       return;
     }
 
@@ -352,7 +379,7 @@ namespace build2
       if (!touch)
       try
       {
-        is_.close ();
+        fd_.close ();
         return;
       }
       catch (const io_error& e)
@@ -373,13 +400,13 @@ namespace build2
       //
       if (*touch == timestamp_unknown)
       {
-        pos_ = buf_->tellg ();         // The last line is accepted.
+        pos_ = rpos_;                  // The last line is accepted.
         change (false /* truncate */); // Write end marker below.
       }
     }
     else if (state_ != state::write)
     {
-      pos_ = buf_->tellg (); // The last line is accepted.
+      pos_ = rpos_; // The last line is accepted.
       change (true /* truncate */);
     }
 
@@ -407,6 +434,9 @@ namespace build2
       fail << "unable to touch file " << path << ": " << e;
     }
 
+    if (build_snapshot* s = build_snapshot::instance)
+      s->record_output (path);
+
     // On some platforms (currently confirmed on FreeBSD running as VMs) one
     // can sometimes end up with a modification time that is a bit after the
     // call to close(). And in some tight cases this can mess with our
@@ -431,7 +461,7 @@ namespace build2
 
     if (state_ != state::write)
     {
-      pos_ = buf_->tellg (); // The last line is accepted.
+      pos_ = rpos_; // The last line is accepted.
       change (state_ != state::read_eof /* truncate */);
     }
 
@@ -447,6 +477,9 @@ namespace build2
       fail << "unable to flush file " << path << ": " << e;
     }
 
+    if (build_snapshot* s = build_snapshot::instance)
+      s->record_output (path);
+
     // Note: must still be done for FreeBSD if changing anything here (see
     // close() for details).
     //
@@ -60,6 +60,19 @@ namespace build2
   // the depdb mtime. This is also used to handle the dry-run mode where we
   // essentially do the interruption ourselves.
   //
+  // Note that while the database is mostly accessed by us, it must remain a
+  // line-oriented text file since it can also be read by external programs
+  // (for example, GCC reads the lines that start with '@' as the module
+  // mapper). However, in the read mode, the entire database is loaded into
+  // memory with a single read and the lines are then extracted from this
+  // buffer. This is substantially faster than reading line by line from a
+  // stream, which matters for large databases that are mostly validated
+  // during no-op builds (for example, the header dependencies of a
+  // translation unit).
+  //
+  // Note also that we don't memory-map the file since we may switch to
+  // (over)writing it (including truncating) using the same file descriptor.
+  //
   struct LIBBUILD2_SYMEXPORT depdb_base
   {
     // Implementation details.
@@ -72,13 +85,16 @@ namespace build2
     state state_;
     bool  ro_;
 
+    auto_fd fd_;   // read, read_eof (released when switching to write)
+    string  data_; // read, read_eof (entire database content)
+    size_t  rpos_; // read, read_eof (current read position in data_)
+
     union
     {
-      ifdstream is_; // read, read_eof, (ro && write)
-      ofdstream os_; // write
+      ofdstream os_; // write (!ro)
     };
 
-    butl::fdstreambuf* buf_; // Current buffer (for tellg()).
+    butl::fdstreambuf* buf_; // Write buffer (for tellp()).
   };
 
   class LIBBUILD2_SYMEXPORT depdb: private depdb_base
@@ -230,6 +246,20 @@ namespace build2
     bool
     skip ();
 
+    // Call the specified function for each of the remaining lines without
+    // reading them, stopping if it returns false or at the first incomplete
+    // line. The function signature is:
+    //
+    // bool (const char* line, size_t size)
+    //
+    // This is primarily useful to prefetch information (for example, file
+    // modification times) that will be needed to handle the subsequent
+    // lines. Note that the database is expected to be in the read state.
+    //
+    template <typename F>
+    void
+    peek (F&&) const;
+
     // Write the next line. If nl is false then don't write the newline yet.
     // Note that this switches the database into the write mode and no further
     // reading will be possible.
@@ -8,9 +8,7 @@ namespace build2
   inline depdb_base::
   ~depdb_base ()
   {
-    if (state_ != state::write || ro_)
-      is_.~ifdstream ();
-    else
+    if (state_ == state::write && !ro_)
       os_.~ofdstream ();
   }
 
@@ -28,6 +26,27 @@ namespace build2
     }
   }
 
+  template <typename F>
+  inline void depdb::
+  peek (F&& f) const
+  {
+    if (state_ != state::read)
+      return;
+
+    const char* b (data_.c_str ());
+    size_t n (data_.size ());
+
+    for (size_t i (rpos_); i != n && b[i] != '\0'; )
+    {
+      const char* p (static_cast<const char*> (memchr (b + i, '\n', n - i)));
+
+      if (p == nullptr || !f (b + i, static_cast<size_t> (p - (b + i))))
+        break;
+
+      i = static_cast<size_t> (p - b) + 1;
+    }
+  }
+
   inline bool depdb::
   mtime_check ()
   {
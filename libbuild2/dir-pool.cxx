@@ -0,0 +1,78 @@
+// file      : libbuild2/dir-pool.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/dir-pool.hxx>
+
+using namespace std;
+
+namespace build2
+{
+  dir_pool::
+  dir_pool (size_t shards)
+      : shards_ (new shard[shards]), shard_count_ (shards)
+  {
+    empty_ = &insert (dir_path ());
+  }
+
+  const interned_dir& dir_pool::
+  insert (dir_path d)
+  {
+    // Note: NULL while interning the empty directory itself (see above).
+    //
+    if (d.empty () && empty_ != nullptr)
+      return *empty_;
+
+    size_t h (hash<dir_path> () (d));
+
+    // First try to find it under the shared lock, which is the common case.
+    //
+    {
+      const shard& s (find_shard (h));
+      slock l (s.mutex);
+
+      auto i (s.map.find (key {&d, h}));
+      if (i != s.map.end ())
+        return *i->second;
+    }
+
+    // Intern the parent (outside of our shard's lock since it could be the
+    // same shard).
+    //
+    const interned_dir* p (nullptr);
+    if (!d.empty ())
+      p = &insert (d.root () ? dir_path () : d.directory ());
+
+    // Re-lock for exclusive access. In the meantime, someone could have
+    // interned this directory.
+    //
+    shard& s (find_shard (h));
+    ulock l (s.mutex);
+
+    auto i (s.map.find (key {&d, h}));
+    if (i != s.map.end ())
+      return *i->second;
+
+    unique_ptr<interned_dir> e (
+      new interned_dir (
+        move (d), next_id_.fetch_add (1, memory_order_relaxed), h, p));
+
+    const interned_dir& r (*e);
+    s.map.emplace (key {&r, h}, move (e));
+    return r;
+  }
+
+  const interned_dir* dir_pool::
+  find (const dir_path& d, bool excl) const
+  {
+    if (d.empty ())
+      return empty_;
+
+    size_t h (hash<dir_path> () (d));
+
+    const shard& s (find_shard (h));
+    slock l (s.mutex, defer_lock); if (!excl) l.lock ();
+
+    auto i (s.map.find (key {&d, h}));
+    return i != s.map.end () ? i->second.get () : nullptr;
+  }
+}
@@ -0,0 +1,150 @@
+// file      : libbuild2/dir-pool.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_DIR_POOL_HXX
+#define LIBBUILD2_DIR_POOL_HXX
+
+#include <unordered_map>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Interned directory.
+  //
+  // An interned directory is unique within the pool so two interned
+  // directories are equal if and only if they are the same object. It
+  // also carries its precomputed hash and a link to its parent directory
+  // (NULL for the empty directory which is the root of all the chains).
+  //
+  // Note that an interned directory "is-a" dir_path so it can be used as
+  // such. And if a dir_path is known to be interned (for example,
+  // target::dir or target::out), then it can be static_cast back.
+  //
+  struct interned_dir: dir_path
+  {
+    const size_t id;                  // Stable, dense, and unique in pool.
+    const size_t hash;                // hash<dir_path>.
+    const interned_dir* const parent; // NULL for the empty directory.
+
+    // Scope whose out path is this directory or NULL if none. Maintained
+    // by scope_map and protected by the phase mutex.
+    //
+    mutable scope* out_scope = nullptr;
+
+    interned_dir (dir_path&& d, size_t i, size_t h, const interned_dir* p)
+        : dir_path (move (d)), id (i), hash (h), parent (p) {}
+
+    interned_dir (const interned_dir&) = delete;
+    interned_dir& operator= (const interned_dir&) = delete;
+  };
+
+  // Context-wide directory intern table.
+  //
+  // Only normalized directories (absolute or empty) are expected to be
+  // interned, though this is not enforced. When a directory is interned,
+  // so are all its parents (so the parent links always form a complete
+  // chain to the empty directory).
+  //
+  // The same few thousand directories normally end up being referenced by
+  // hundreds of thousands of targets and storing them once not only saves
+  // memory but also allows replacing string comparisons with pointer
+  // comparisons (see target_set) and scope lookup with chasing the parent
+  // links (see scope_map).
+  //
+  // The pool is MT-safe and, similar to target_set, is split into shards
+  // (by the directory hash) to reduce contention during parallel match.
+  // Interned directories are never removed and their addresses are stable.
+  //
+  class LIBBUILD2_SYMEXPORT dir_pool
+  {
+  public:
+    // Return the interned directory, inserting it if necessary.
+    //
+    const interned_dir&
+    insert (dir_path);
+
+    // Return the interned directory or NULL if not interned.
+    //
+    // The empty directory (which is the out directory of most targets) is
+    // always interned and is returned without a lookup. If exclusive is
+    // true, then the caller guarantees that there are no concurrent
+    // insertions (for example, because it is running in the load phase) and
+    // the shard lock is not acquired.
+    //
+    const interned_dir*
+    find (const dir_path&, bool exclusive = false) const;
+
+    // Number of interned directories.
+    //
+    size_t
+    size () const {return next_id_.load (memory_order_relaxed);}
+
+  private:
+    friend class context;
+
+    explicit
+    dir_pool (size_t shards);
+
+    // Note that the key points to the value's dir_path and carries the
+    // precomputed hash.
+    //
+    struct key
+    {
+      const dir_path* path;
+      size_t          hash;
+    };
+
+    struct key_hash
+    {
+      size_t
+      operator() (const key& k) const {return k.hash;}
+    };
+
+    struct key_equal
+    {
+      bool
+      operator() (const key& x, const key& y) const
+      {
+        return x.hash == y.hash && *x.path == *y.path;
+      }
+    };
+
+    using map_type = std::unordered_map<key,
+                                        unique_ptr<interned_dir>,
+                                        key_hash,
+                                        key_equal>;
+
+    struct shard
+    {
+      mutable shared_mutex mutex;
+      map_type map;
+    };
+
+    // Mix in the high bits since the same hash is used by the shard's map
+    // (see target_set for background).
+    //
+    size_t
+    shard_index (size_t h) const {return (h ^ (h >> 17)) % shard_count_;}
+
+    shard&
+    find_shard (size_t h) {return shards_[shard_index (h)];}
+
+    const shard&
+    find_shard (size_t h) const {return shards_[shard_index (h)];}
+
+  private:
+    unique_ptr<shard[]> shards_;
+    size_t shard_count_;
+
+    atomic<size_t> next_id_ {0};
+
+    const interned_dir* empty_ = nullptr;
+  };
+}
+
+#endif // LIBBUILD2_DIR_POOL_HXX
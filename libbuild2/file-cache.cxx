@@ -12,6 +12,198 @@ using namespace butl;
 
 namespace build2
 {
+  // Compress the uncompressed file into the compressed file returning false
+  // (and removing the partially written compressed file) on failure.
+  //
+  static bool
+  compress (const path& f, const path& cf)
+  {
+    tracer trace ("file_cache::compress");
+
+    try
+    {
+      ifdstream ifs (f,  fdopen_mode::binary, ifdstream::badbit);
+      ofdstream ofs (cf, fdopen_mode::binary);
+
+      uint64_t n (fdstat (ifs.fd ()).size);
+
+      // Experience shows that for the type of content we typically cache
+      // using 1MB blocks results in almost the same comression as for 4MB.
+      //
+      uint64_t cn (lz4::compress (ofs, ifs,
+                                  1 /* compression_level (fastest) */,
+                                  6 /* block_size_id (1MB) */,
+                                  n));
+
+      ofs.close ();
+
+      l6 ([&]{trace << "compressed " << f << " to "
+                    << (n != 0 ? cn * 100 / n : 100) << '%';});
+    }
+    catch (const std::exception& e)
+    {
+      l5 ([&]{trace << "unable to compress " << f << ": " << e;});
+      try_rmfile_ignore_error (cf);
+      return false;
+    }
+
+    return true;
+  }
+
+  // file_cache
+  //
+  file_cache::
+  ~file_cache ()
+  {
+    if (thread_.joinable ())
+    {
+      {
+        mlock l (mutex_);
+        stop_ = true;
+      }
+
+      work_cv_.notify_one ();
+      thread_.join ();
+    }
+  }
+
+  bool file_cache::
+  enqueue (job& j)
+  {
+    mlock l (mutex_);
+
+    // Start the background thread on first use.
+    //
+    if (!thread_.joinable ())
+    {
+      try
+      {
+        thread_ = thread (&file_cache::worker, this);
+      }
+      catch (const system_error& e)
+      {
+        tracer trace ("file_cache::enqueue");
+        l5 ([&]{trace << "unable to start background thread: " << e;});
+        return false;
+      }
+    }
+
+    j.queued = true;
+    j.pos = queue_.insert (queue_.end (), &j);
+
+    l.unlock ();
+    work_cv_.notify_one ();
+    return true;
+  }
+
+  void file_cache::
+  claim (job& j)
+  {
+    mlock l (mutex_);
+
+    while (j.busy)
+      done_cv_.wait (l);
+
+    if (j.queued)
+    {
+      queue_.erase (j.pos);
+      j.queued = false;
+    }
+  }
+
+  bool file_cache::
+  cancel (job& j)
+  {
+    mlock l (mutex_);
+
+    if (j.busy)
+    {
+      j.abandoned = true;
+      return false;
+    }
+
+    if (j.queued)
+    {
+      queue_.erase (j.pos);
+      j.queued = false;
+    }
+
+    return true;
+  }
+
+  void file_cache::
+  worker ()
+  {
+    mlock l (mutex_);
+
+    for (;;)
+    {
+      if (queue_.empty ())
+      {
+        if (stop_)
+          break;
+
+        work_cv_.wait (l);
+        continue;
+      }
+
+      job& j (*queue_.front ());
+      queue_.pop_front ();
+      j.queued = false;
+      j.busy = true;
+
+      l.unlock ();
+      process (j);
+      l.lock ();
+
+      // If the entry was destroyed in the meantime, then it was temporary
+      // and we are responsible for cleaning up.
+      //
+      if (j.abandoned)
+      {
+        l.unlock ();
+
+        try_rmfile_ignore_error (j.path);
+        try_rmfile_ignore_error (j.comp_path);
+        delete &j;
+
+        l.lock ();
+        continue;
+      }
+
+      j.busy = false;
+      done_cv_.notify_all ();
+    }
+  }
+
+  void file_cache::
+  process (job& j)
+  {
+    // Note that this function is called on the background thread and
+    // should not throw.
+    //
+    switch (j.state)
+    {
+    case entry::uncomp:
+      {
+        if (!compress (j.path, j.comp_path))
+          break;
+
+        j.state = entry::decomp; // We now have both.
+      }
+      // Fall through.
+    case entry::decomp:
+      {
+        if (try_rmfile_ignore_error (j.path))
+          j.state = entry::comp;
+
+        break;
+      }
+    default:
+      assert (false);
+    }
+  }
+
   // file_cache::entry
   //
   file_cache::write file_cache::entry::
@@ -77,7 +269,7 @@ namespace build2
     {
     case uncomp:
       {
-        if (!compress ())
+        if (!compress (path_, comp_path_))
           break;
 
         state_ = decomp; // We now have both.
@@ -95,38 +287,50 @@ namespace build2
     }
   }
 
-  bool file_cache::entry::
-  compress ()
+  void file_cache::entry::
+  preempt_async ()
   {
-    tracer trace ("file_cache::entry::compress");
+    // Note that this function is called from destructors so it's best if it
+    // doesn't throw (we assume allocation failures are fatal).
+    //
+    if (job_ == nullptr)
+      job_.reset (new job);
 
-    try
-    {
-      ifdstream ifs (path_,      fdopen_mode::binary, ifdstream::badbit);
-      ofdstream ofs (comp_path_, fdopen_mode::binary);
+    job& j (*job_);
+    j.state = state_;
+    j.path = path_;
+    j.comp_path = comp_path_;
 
-      uint64_t n (fdstat (ifs.fd ()).size);
+    // Fallback to the synchronous preemption if unable to start the
+    // background thread.
+    //
+    if (!cache_->enqueue (j))
+    {
+      job_.reset ();
+      preempt ();
+    }
+  }
 
-      // Experience shows that for the type of content we typically cache
-      // using 1MB blocks results in almost the same comression as for 4MB.
-      //
-      uint64_t cn (lz4::compress (ofs, ifs,
-                                  1 /* compression_level (fastest) */,
-                                  6 /* block_size_id (1MB) */,
-                                  n));
+  void file_cache::entry::
+  claim ()
+  {
+    cache_->claim (*job_);
 
-      ofs.close ();
+    state_ = job_->state;
+    job_.reset ();
+  }
 
-      l6 ([&]{trace << "compressed " << path_ << " to "
-                    << (cn * 100 / n) << '%';});
-    }
-    catch (const std::exception& e)
+  bool file_cache::entry::
+  cancel ()
+  {
+    if (!cache_->cancel (*job_))
     {
-      l5 ([&]{trace << "unable to compress " << path_ << ": " << e;});
-      try_rmfile_ignore_error (comp_path_);
+      job_.release (); // Now owned by the background thread.
       return false;
     }
 
+    state_ = job_->state;
+    job_.reset ();
     return true;
   }
 
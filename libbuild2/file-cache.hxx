@@ -74,33 +74,50 @@ namespace build2
   // one that simply saves the file on disk) is file_cache::entry that is just
   // auto_rmfile.
 
-  // The synchronous LZ4 on-disk compression file cache implementation.
+  // The LZ4 on-disk compression file cache implementation with optional
+  // asynchronous compression.
   //
-  // If the cache entry is no longer pinned, this implementation compresses
-  // the content and removes the uncompressed file all as part of the call
-  // that caused the entry to become unpinned.
+  // In the synchronous mode, if the cache entry is no longer pinned, this
+  // implementation compresses the content and removes the uncompressed file
+  // all as part of the call that caused the entry to become unpinned.
+  //
+  // In the asynchronous mode the unpinned entry is instead queued to be
+  // preempted by a background thread and the entry is reclaimed (waiting
+  // for the preemption to complete, if necessary) when it is accessed
+  // again. A temporary entry that is destroyed while being preempted is
+  // removed by the background thread once done (rather than waiting for
+  // it).
   //
   // In order to deal with interruptions during compression, when recreating
   // the cache entry state from the filesystem state, this implementation
   // treats the presence of the uncompressed file as an indication that the
   // compressed file, if any, is invalid.
   //
-  class file_cache
+  class LIBBUILD2_SYMEXPORT file_cache
   {
   public:
     // If compression is disabled, then this implementation becomes equivalent
-    // to the noop implementation.
+    // to the noop implementation (and the async argument is ignored).
     //
     explicit
-    file_cache (bool compress);
+    file_cache (bool compress, bool async = false);
 
     file_cache () = default; // Create uninitialized instance.
 
+    ~file_cache ();
+
     void
-    init (bool compress);
+    init (bool compress, bool async = false);
+
+    file_cache (const file_cache&) = delete;
+    file_cache& operator= (const file_cache&) = delete;
 
     class entry;
 
+  private:
+    struct job;
+
+  public:
     // A cache entry write handle. During the lifetime of this object the
     // filesystem entry can be opened for writing and written to.
     //
@@ -218,13 +235,19 @@ namespace build2
     private:
       friend class file_cache;
 
-      entry (path_type, bool, bool);
+      entry (path_type, bool, bool, file_cache*);
 
       void
       preempt ();
 
+      void
+      preempt_async ();
+
+      void
+      claim ();
+
       bool
-      compress ();
+      cancel ();
 
       void
       decompress ();
@@ -238,6 +261,9 @@ namespace build2
       path_type path_;           // Uncompressed path.
       path_type comp_path_;      // Compressed path (empty if disabled).
       size_t    pin_ = 0;        // Pin count.
+
+      file_cache*     cache_ = nullptr; // Cache if asynchronous.
+      unique_ptr<job> job_;             // Preemption job, if any.
     };
 
     // Create a cache entry corresponding to the specified filesystem path.
@@ -266,8 +292,59 @@ namespace build2
     string
     compressed_extension (const char* ext = nullptr);
 
+  private:
+    // Asynchronous preemption job.
+    //
+    // The job is created when the entry becomes unpinned and contains a copy
+    // of the entry state that the background thread operates on. While the
+    // job is busy, it is exclusively owned by the background thread. When
+    // not busy, it can be on the queue (waiting to be preempted). The entry
+    // reclaims the job (see claim()) before accessing its state again or
+    // cancels it (see cancel()) if the entry is temporary and is being
+    // destroyed. If the job is busy at that point, then it is abandoned and
+    // the background thread removes its files and frees it once done.
+    //
+    struct job
+    {
+      entry::state      state;
+      entry::path_type  path;
+      entry::path_type  comp_path;
+
+      bool              busy = false;
+      bool              queued = false;
+      bool              abandoned = false;
+      list<job*>::iterator pos;  // Position in queue_ if queued.
+    };
+
+    bool
+    enqueue (job&);
+
+    void
+    claim (job&);
+
+    // Remove the job from the queue, if queued, and return true. If the job
+    // is busy, then mark it as abandoned and return false.
+    //
+    bool
+    cancel (job&);
+
+    void
+    worker ();
+
+    void
+    process (job&);
+
   private:
     bool compress_;
+    bool async_ = false;
+
+    mutex              mutex_;
+    condition_variable work_cv_;  // Signaled when work is available.
+    condition_variable done_cv_;  // Signaled when a job is no longer busy.
+
+    list<job*>   queue_;
+    bool         stop_ = false;
+    thread       thread_;
   };
 }
 
@@ -14,7 +14,8 @@ namespace build2
   inline void file_cache::entry::
   pin ()
   {
-    ++pin_;
+    if (pin_++ == 0 && job_ != nullptr)
+      claim ();
   }
 
   inline void file_cache::entry::
@@ -23,12 +24,19 @@ namespace build2
     if (--pin_ == 0          &&
         !comp_path_.empty () &&
         (state_ == uncomp || state_ == decomp))
-      preempt ();
+    {
+      if (cache_ != nullptr)
+        preempt_async ();
+      else
+        preempt ();
+    }
   }
 
   inline file_cache::read file_cache::entry::
   open ()
   {
+    pin ();
+
     assert (state_ != null && state_ != uninit);
 
     if (state_ == comp)
@@ -37,7 +45,6 @@ namespace build2
       state_ = decomp;
     }
 
-    pin ();
     return read (*this);
   }
 
@@ -48,20 +55,35 @@ namespace build2
   }
 
   inline file_cache::entry::
-  entry (path_type p, bool t, bool c)
+  entry (path_type p, bool t, bool c, file_cache* a)
       : temporary (t),
         state_ (uninit),
         path_ (move (p)),
         comp_path_ (c ? path_ + ".lz4" : path_type ()),
-        pin_ (1)
+        pin_ (1),
+        cache_ (c ? a : nullptr)
   {
   }
 
   inline file_cache::entry::
   ~entry ()
   {
-    if (state_ != null && temporary)
-      remove ();
+    if (state_ != null)
+    {
+      // Don't wait for the preemption of a temporary entry that we are about
+      // to remove anyway.
+      //
+      if (job_ != nullptr)
+      {
+        if (!temporary)
+          claim ();
+        else if (!cancel ())
+          return;
+      }
+
+      if (temporary)
+        remove ();
+    }
   }
 
   inline file_cache::entry::
@@ -70,7 +92,9 @@ namespace build2
         state_ (e.state_),
         path_ (move (e.path_)),
         comp_path_ (move (e.comp_path_)),
-        pin_ (e.pin_)
+        pin_ (e.pin_),
+        cache_ (e.cache_),
+        job_ (move (e.job_))
   {
     e.state_ = null;
   }
@@ -87,6 +111,8 @@ namespace build2
       path_ = move (e.path_);
       comp_path_ = move (e.comp_path_);
       pin_ = e.pin_;
+      cache_ = e.cache_;
+      job_ = move (e.job_);
 
       e.state_ = null;
     }
@@ -158,13 +184,19 @@ namespace build2
   inline file_cache::entry file_cache::
   create (path f, optional<bool>)
   {
-    return entry (move (f), true /* temporary */, compress_);
+    return entry (move (f),
+                  true /* temporary */,
+                  compress_,
+                  async_ ? this : nullptr);
   }
 
   inline file_cache::entry file_cache::
   create_existing (path f)
   {
-    entry e (move (f), false /* temporary */, compress_);
+    entry e (move (f),
+             false /* temporary */,
+             compress_,
+             async_ ? this : nullptr);
     e.init_existing ();
     return e;
   }
@@ -178,14 +210,15 @@ namespace build2
   }
 
   inline void file_cache::
-  init (bool compress)
+  init (bool compress, bool async)
   {
     compress_ = compress;
+    async_ = compress && async;
   }
 
   inline file_cache::
-  file_cache (bool compress)
+  file_cache (bool compress, bool async)
   {
-    init (compress);
+    init (compress, async);
   }
 }
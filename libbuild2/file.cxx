@@ -12,6 +12,8 @@
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/snapshot.hxx>
+#include <libbuild2/timeline.hxx>
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite-key.hxx>
@@ -306,6 +308,8 @@ namespace build2
 
     const path_name& fn (l.name ());
 
+    timeline::span ts ("load", fn);
+
     try
     {
       l5 ([&]{trace << "sourcing " << fn;});
@@ -516,6 +520,9 @@ namespace build2
       assert (*s.src_path_ == d);
 
     s.assign (ctx.var_forwarded) = forwarded;
+
+    if (build_snapshot* bs = build_snapshot::instance)
+      bs->record_root (d);
   }
 
   scope&
@@ -3,7 +3,10 @@
 
 #include <libbuild2/filesystem.hxx>
 
+#include <cstring> // strlen()
+
 #include <libbuild2/context.hxx>
+#include <libbuild2/snapshot.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 using namespace std;
@@ -40,7 +43,12 @@ namespace build2
   {
     try
     {
-      return file_mtime (p);
+      timestamp r (file_mtime (p));
+
+      if (build_snapshot* s = build_snapshot::instance)
+        s->record (p, strlen (p), r);
+
+      return r;
     }
     catch (const system_error& e)
     {
@@ -37,6 +37,15 @@ namespace build2
   class function_map;
   class function_family;
 
+  // <libbuild2/dir-pool.hxx>
+  //
+  struct interned_dir;
+  class dir_pool;
+
+  // <libbuild2/mtime-prefetch.hxx>
+  //
+  class mtime_prefetcher;
+
   // <libbuild2/scope.hxx>
   //
   class scope;
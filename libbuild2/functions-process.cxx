@@ -8,6 +8,7 @@
 #include <libbuild2/context.hxx>
 #include <libbuild2/function.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/regex-cache.hxx>
 
 using namespace std;
 using namespace butl;
@@ -57,7 +58,7 @@ namespace build2
     return value (move (r));
   }
 
-  regex
+  shared_ptr<const compiled_regex>
   parse_regex (const string&, regex::flag_type); // functions-regex.cxx
 
   // Read lines from a stream, match them against a regular expression, and
@@ -75,10 +76,18 @@ namespace build2
     // invalid_argument is thrown, which is probably ok since this is not a
     // common case.
     //
-    regex re (parse_regex (pat, regex::ECMAScript));
+    shared_ptr<const compiled_regex> cr (parse_regex (pat, regex::ECMAScript));
+    const regex& re (cr->re);
+    const linear_regex* lr (cr->linear ? &*cr->linear : nullptr);
 
     for (string l; !eof (getline (is, l)); )
     {
+      // Note that a line which doesn't match can be skipped without
+      // involving std::regex.
+      //
+      if (lr != nullptr && !lr->match (l))
+        continue;
+
       if (fmt)
       {
         pair<string, bool> p (regex_replace_match (l, re, *fmt));
@@ -86,7 +95,7 @@ namespace build2
         if (p.second)
           r.push_back (to_name (move (p.first)));
       }
-      else if (regex_match (l, re))
+      else if (lr != nullptr || regex_match (l, re))
         r.push_back (to_name (move (l)));
     }
 
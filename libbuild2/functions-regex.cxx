@@ -7,6 +7,7 @@
 
 #include <libbuild2/function.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/regex-cache.hxx>
 
 using namespace std;
 using namespace butl;
@@ -28,14 +29,16 @@ namespace build2
 
   // Parse a regular expression. Throw invalid_argument if it is not valid.
   //
+  // Note that the compiled regexes are cached (see regex-cache.hxx).
+  //
   // Note: also used in functions-process.cxx (thus not static).
   //
-  regex
+  shared_ptr<const compiled_regex>
   parse_regex (const string& s, regex::flag_type f)
   {
     try
     {
-      return regex (s, f);
+      return cached_regex (s, f);
     }
     catch (const regex_error& e)
     {
@@ -47,6 +50,58 @@ namespace build2
     }
   }
 
+  // Return the linear-time regex if available and usable for the submatches
+  // extraction, if requested, and NULL otherwise.
+  //
+  static inline const linear_regex*
+  linear (const compiled_regex& cr, bool subs = false)
+  {
+    return cr.linear && (!subs || cr.linear->exact_submatches ())
+      ? &*cr.linear
+      : nullptr;
+  }
+
+  // Return the marked sub-expressions as names, optionally preceded by the
+  // whole match (see match() and search() below for semantics).
+  //
+  static names
+  submatch_names (const string& s,
+                  const linear_regex::submatches& m,
+                  bool match,
+                  bool subs)
+  {
+    auto str = [&s, &m] (size_t i)
+    {
+      size_t b (m[i * 2]);
+      return b != string::npos ? string (s, b, m[i * 2 + 1] - b) : string ();
+    };
+
+    names r;
+
+    if (match)
+      r.emplace_back (str (0));
+
+    if (subs)
+    {
+      for (size_t i (1); i != m.size () / 2; ++i)
+        r.emplace_back (str (i));
+    }
+
+    return r;
+  }
+
+  // Return true if the linear-time regex is available and there is no
+  // non-empty match for it in the non-empty string. In this case the
+  // replacement functions can skip std::regex since the result is known in
+  // advance (see regex_replace_search() for details).
+  //
+  static inline bool
+  no_match (const compiled_regex& cr, const string& s)
+  {
+    const linear_regex* lr (linear (cr));
+    return lr != nullptr && !s.empty () && !lr->search (s, true);
+  }
+
   // Match value of an arbitrary type against the regular expression. See
   // match() overloads (below) for details.
   //
@@ -75,12 +130,25 @@ namespace build2
 
     // Parse regex.
     //
-    regex rge (parse_regex (re, rf));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, rf));
+    const regex& rge (cr->re);
 
     // Match.
     //
     string s (to_string (move (v)));
 
+    if (const linear_regex* lr = linear (*cr, subs))
+    {
+      linear_regex::submatches m;
+
+      if (!subs)
+        return value (lr->match (s)); // Return boolean value.
+
+      return lr->match (s, &m)
+        ? value (submatch_names (s, m, false /* match */, true /* subs */))
+        : value ();
+    }
+
     if (!subs)
       return value (regex_match (s, rge)); // Return boolean value.
 
@@ -132,7 +200,8 @@ namespace build2
 
     // Parse regex.
     //
-    regex rge (parse_regex (re, rf));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, rf));
+    const regex& rge (cr->re);
 
     // Search.
     //
@@ -150,6 +219,18 @@ namespace build2
     if (!s.empty ())
       mf |= regex_constants::match_not_null;
 
+    if (const linear_regex* lr = linear (*cr, subs))
+    {
+      linear_regex::submatches m;
+
+      if (!match && !subs)
+        return value (lr->search (s, !s.empty ())); // Return boolean value.
+
+      return lr->search (s, !s.empty (), &m)
+        ? value (submatch_names (s, m, match, subs))
+        : value ();
+    }
+
     if (!match && !subs)
       return value (regex_search (s, rge, mf)); // Return boolean value.
 
@@ -219,16 +300,21 @@ namespace build2
            optional<names>&& flags)
   {
     auto fl (parse_replacement_flags (move (flags)));
-    regex rge (parse_regex (re, fl.first));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl.first));
+    const regex& rge (cr->re);
+
+    bool no_copy ((fl.second & regex_constants::format_no_copy) != 0);
 
     names r;
 
     try
     {
-      r.emplace_back (regex_replace_search (to_string (move (v)),
-                                            rge,
-                                            fmt,
-                                            fl.second).first);
+      string s (to_string (move (v)));
+
+      if (no_match (*cr, s))
+        r.emplace_back (no_copy ? string () : move (s));
+      else
+        r.emplace_back (regex_replace_search (s, rge, fmt, fl.second).first);
     }
     catch (const regex_error& e)
     {
@@ -274,7 +360,8 @@ namespace build2
     }
 
     auto fl (parse_replacement_flags (move (flags)));
-    regex rge (parse_regex (re, fl.first));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl.first));
+    const regex& rge (cr->re);
 
     names r;
     string ls;
@@ -289,7 +376,9 @@ namespace build2
 
       for (string l; !eof (getline (is, l)); )
       {
-        auto rr (regex_replace_search (l, rge, efmt, fl.second));
+        auto rr (no_match (*cr, l)
+                 ? make_pair (no_copy ? string () : move (l), false)
+                 : regex_replace_search (l, rge, efmt, fl.second));
         string& s (rr.first);
 
         // Skip the empty replacement for a matched line if the format is
@@ -348,7 +437,8 @@ namespace build2
     auto fl (parse_replacement_flags (move (flags),
                                       false /* first_only */,
                                       &copy_empty));
-    regex rge (parse_regex (re, fl.first));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl.first));
+    const regex& rge (cr->re);
 
     names r;
 
@@ -386,7 +476,10 @@ namespace build2
     auto fl (parse_replacement_flags (move (flags),
                                       true /* first_only */,
                                       &copy_empty));
-    regex rge (parse_regex (re, fl.first));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl.first));
+    const regex& rge (cr->re);
+
+    bool no_copy ((fl.second & regex_constants::format_no_copy) != 0);
 
     names r;
 
@@ -394,10 +487,15 @@ namespace build2
     {
       for (auto& n: ns)
       {
-        string s (regex_replace_search (convert<string> (move (n)),
-                                        rge,
-                                        fmt,
-                                        fl.second).first);
+        string s (convert<string> (move (n)));
+
+        if (no_match (*cr, s))
+        {
+          if (no_copy)
+            s.clear ();
+        }
+        else
+          s = regex_replace_search (s, rge, fmt, fl.second).first;
 
         if (copy_empty || !s.empty ())
           r.emplace_back (move (s));
@@ -441,11 +539,14 @@ namespace build2
   find_match (names&& ns, const string& re, optional<names>&& flags)
   {
     regex::flag_type fl (parse_find_flags (move (flags)));
-    regex rge (parse_regex (re, fl));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl));
+    const linear_regex* lr (linear (*cr));
 
     for (auto& n: ns)
     {
-      if (regex_match (convert<string> (move (n)), rge))
+      string s (convert<string> (move (n)));
+
+      if (lr != nullptr ? lr->match (s) : regex_match (s, cr->re))
         return true;
     }
 
@@ -463,7 +564,8 @@ namespace build2
                 bool matching)
   {
     regex::flag_type fl (parse_find_flags (move (flags)));
-    regex rge (parse_regex (re, fl));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl));
+    const linear_regex* lr (linear (*cr));
 
     names r;
 
@@ -477,7 +579,8 @@ namespace build2
       bool s (n.simple ());
       string v (convert<string> (s ? move (n) : name (n)));
 
-      if (regex_match (v, rge) == matching)
+      if ((lr != nullptr ? lr->match (v) : regex_match (v, cr->re)) ==
+          matching)
         r.emplace_back (s ? name (move (v)) : move (n));
     }
 
@@ -491,7 +594,8 @@ namespace build2
   find_search (names&& ns, const string& re, optional<names>&& flags)
   {
     regex::flag_type fl (parse_find_flags (move (flags)));
-    regex rge (parse_regex (re, fl));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl));
+    const linear_regex* lr (linear (*cr));
 
     for (auto& n: ns)
     {
@@ -507,7 +611,9 @@ namespace build2
       if (!s.empty ())
         mf |= regex_constants::match_not_null;
 
-      if (regex_search (s, rge, mf))
+      if (lr != nullptr
+          ? lr->search (s, !s.empty ())
+          : regex_search (s, cr->re, mf))
         return true;
     }
 
@@ -526,7 +632,8 @@ namespace build2
                  bool matching)
   {
     regex::flag_type fl (parse_find_flags (move (flags)));
-    regex rge (parse_regex (re, fl));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl));
+    const linear_regex* lr (linear (*cr));
 
     names r;
 
@@ -550,7 +657,9 @@ namespace build2
       if (!v.empty ())
         mf |= regex_constants::match_not_null;
 
-      if (regex_search (v, rge, mf) == matching)
+      if ((lr != nullptr
+           ? lr->search (v, !v.empty ())
+           : regex_search (v, cr->re, mf)) == matching)
         r.emplace_back (s ? name (move (v)) : move (n));
     }
 
@@ -572,7 +681,10 @@ namespace build2
     auto fl (parse_replacement_flags (move (flags),
                                       true /* first_only */,
                                       &copy_empty));
-    regex rge (parse_regex (re, fl.first));
+    shared_ptr<const compiled_regex> cr (parse_regex (re, fl.first));
+    const regex& rge (cr->re);
+
+    bool no_copy ((fl.second & regex_constants::format_no_copy) != 0);
 
     string rs;
 
@@ -581,10 +693,15 @@ namespace build2
       bool first (true);
       for (auto& n: ns)
       {
-        string s (regex_replace_search (convert<string> (move (n)),
-                                        rge,
-                                        fmt,
-                                        fl.second).first);
+        string s (convert<string> (move (n)));
+
+        if (no_match (*cr, s))
+        {
+          if (no_copy)
+            s.clear ();
+        }
+        else
+          s = regex_replace_search (s, rge, fmt, fl.second).first;
 
         if (copy_empty || !s.empty ())
         {
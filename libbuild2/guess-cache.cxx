@@ -0,0 +1,256 @@
+// file      : libbuild2/guess-cache.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/guess-cache.hxx>
+
+#ifndef _WIN32
+#  include <sys/types.h>
+#  include <sys/stat.h>  // stat()
+#endif
+
+#include <libbutl/filesystem.hxx> // path_entry(), file_mtime(), mvfile()
+
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  // Entry file header. Increment the format version if changing anything
+  // in the entry layout (as opposed to the data layout of a specific kind,
+  // which should be reflected in its key).
+  //
+  static const char guess_cache_header[] = "build2 guess cache 1\n";
+
+  bool
+  append_program_identity (xxh64& cs, const process_path& pp)
+  {
+    tracer trace ("append_program_identity");
+
+    const char* p (pp.effect_string ());
+
+    if (p == nullptr || *p == '\0')
+      return false;
+
+    try
+    {
+      path f (p);
+
+      pair<bool, entry_stat> es (
+        path_entry (f, true /* follow_symlinks */, true /* ignore_error */));
+
+      if (!es.first || es.second.type != entry_type::regular)
+        return false;
+
+      timestamp mt (file_mtime (f));
+
+      if (mt == timestamp_nonexistent)
+        return false;
+
+      cs.append (f.string ());
+      cs.append (es.second.size);
+      cs.append (static_cast<uint64_t> (mt.time_since_epoch ().count ()));
+
+#ifndef _WIN32
+      struct stat s;
+      if (stat (p, &s) != 0)
+        return false;
+
+      cs.append (static_cast<uint64_t> (s.st_dev));
+      cs.append (static_cast<uint64_t> (s.st_ino));
+#endif
+
+      return true;
+    }
+    catch (const invalid_path&)
+    {
+    }
+    catch (const system_error& e)
+    {
+      l4 ([&]{trace << "unable to stat " << p << ": " << e;});
+    }
+
+    return false;
+  }
+
+  void
+  append_environment (xxh64& cs, const char* const* vs)
+  {
+    for (; vs != nullptr && *vs != nullptr; ++vs)
+    {
+      cs.append (*vs);
+
+      // Distinguish between unset and empty.
+      //
+      optional<string> v (getenv (*vs));
+      cs.append (v ? '=' + *v : string ());
+    }
+  }
+
+  static path
+  guess_cache_file (const char* kind, const string& key)
+  {
+    xxh64 cs;
+    cs.append (build_version.string ());
+    cs.append (key);
+
+    string n (kind);
+    n += '-';
+    n += cs.string ();
+
+    return *guess_cache / path (move (n));
+  }
+
+  optional<string>
+  guess_cache_load (const char* kind, const string& key)
+  {
+    tracer trace ("guess_cache_load");
+
+    path f (guess_cache_file (kind, key));
+
+    try
+    {
+      ifdstream ifs (f);
+
+      string s (ifs.read_text ());
+      ifs.close ();
+
+      size_t n (sizeof (guess_cache_header) - 1);
+
+      if (s.compare (0, n, guess_cache_header) != 0)
+      {
+        l4 ([&]{trace << "invalid entry " << f;});
+        return nullopt;
+      }
+
+      l5 ([&]{trace << "hit " << f;});
+
+      s.erase (0, n);
+      return s;
+    }
+    catch (const io_error& e)
+    {
+      // Note that this includes the non-existent file, which is the common
+      // miss case, so we only trace at the higher verbosity level.
+      //
+      l5 ([&]{trace << "miss " << f << ": " << e;});
+    }
+
+    return nullopt;
+  }
+
+  void
+  guess_cache_store (const char* kind, const string& key, const string& d)
+  {
+    tracer trace ("guess_cache_store");
+
+    path f (guess_cache_file (kind, key));
+
+    // Write to a temporary file in the same directory and then move it
+    // into place, which makes the update atomic with regards to concurrent
+    // readers and writers.
+    //
+    path t (f + ('.' + to_string (process::current_id ()) + ".tmp"));
+
+    try
+    {
+      try_mkdir_p (*guess_cache);
+
+      {
+        ofdstream ofs (t);
+        ofs << guess_cache_header << d;
+        ofs.close ();
+      }
+
+      butl::mvfile (t,
+                    f,
+                    cpflags::overwrite_content | cpflags::overwrite_permissions);
+
+      l5 ([&]{trace << "stored " << f;});
+    }
+    catch (const io_error& e)
+    {
+      l4 ([&]{trace << "unable to write " << f << ": " << e;});
+      try_rmfile_ignore_error (t);
+    }
+    catch (const system_error& e)
+    {
+      l4 ([&]{trace << "unable to store " << f << ": " << e;});
+      try_rmfile_ignore_error (t);
+    }
+  }
+
+  // guess_cache_writer
+  //
+  void guess_cache_writer::
+  write_string (const string& s)
+  {
+    data += to_string (s.size ());
+    data += ':';
+    data += s;
+  }
+
+  void guess_cache_writer::
+  write_uint (uint64_t v)
+  {
+    write_string (to_string (v));
+  }
+
+  // guess_cache_reader
+  //
+  string guess_cache_reader::
+  read_string ()
+  {
+    size_t p (data_.find (':', pos_));
+
+    if (p == string::npos || p == pos_ || p - pos_ > 19)
+      throw invalid_argument ("invalid size");
+
+    size_t n (0);
+    for (size_t i (pos_); i != p; ++i)
+    {
+      char c (data_[i]);
+
+      if (c < '0' || c > '9')
+        throw invalid_argument ("invalid size");
+
+      n = n * 10 + static_cast<size_t> (c - '0');
+    }
+
+    ++p;
+
+    if (n > data_.size () - p)
+      throw invalid_argument ("truncated value");
+
+    pos_ = p + n;
+    return string (data_, p, n);
+  }
+
+  uint64_t guess_cache_reader::
+  read_uint ()
+  {
+    string s (read_string ());
+
+    if (s.empty () || s.size () > 20)
+      throw invalid_argument ("invalid integer");
+
+    uint64_t r (0);
+    for (char c: s)
+    {
+      if (c < '0' || c > '9')
+        throw invalid_argument ("invalid integer");
+
+      r = r * 10 + static_cast<uint64_t> (c - '0');
+    }
+
+    return r;
+  }
+
+  void guess_cache_reader::
+  finish () const
+  {
+    if (pos_ != data_.size ())
+      throw invalid_argument ("trailing data");
+  }
+}
@@ -0,0 +1,118 @@
+// file      : libbuild2/guess-cache.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_GUESS_CACHE_HXX
+#define LIBBUILD2_GUESS_CACHE_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Persistent (on-disk) cache of information extracted from programs
+  // (compilers, linkers, etc; see --guess-cache).
+  //
+  // This cache complements the in-process global_cache: on the in-process
+  // cache miss the persistent cache is consulted and only if that also
+  // misses the program is actually run, with the result stored in both.
+  //
+  // Because the persistent entry can outlive the program it describes, its
+  // key must include, in addition to the inputs of the in-process key, the
+  // identity of the program (see append_program_identity()) and the values
+  // of any environment variables that may affect the result (see
+  // append_environment()). The build system version is included into the
+  // key automatically.
+  //
+  // Each entry is stored in a separate file named <kind>-<key> in the cache
+  // directory with the data being an opaque (to the cache) string, normally
+  // produced with guess_cache_writer and consumed with guess_cache_reader.
+  // Entries are written atomically (via a temporary file) so the cache can
+  // be shared by multiple concurrent build system invocations. There is no
+  // cleanup and removing the cache directory (or any of its entries) at any
+  // time is safe.
+  //
+  // Any failure to load an entry is treated as a cache miss and any failure
+  // to store it is ignored (both are traced at verbosity level 4).
+
+  // Return true if the persistent cache is enabled.
+  //
+  inline bool
+  guess_cache_enabled () {return guess_cache.has_value ();}
+
+  // Append the program identity (its effective path, size, modification
+  // time, and, where available, device and inode numbers) to the checksum.
+  // Return false if unable to obtain it, in which case the persistent cache
+  // should not be used.
+  //
+  LIBBUILD2_SYMEXPORT bool
+  append_program_identity (xxh64&, const process_path&);
+
+  // Append the values of the specified NULL-terminated list of environment
+  // variables to the checksum, distinguishing unset and empty values.
+  //
+  LIBBUILD2_SYMEXPORT void
+  append_environment (xxh64&, const char* const* vars);
+
+  // Load the entry data. Return nullopt if not found (or invalid).
+  //
+  LIBBUILD2_SYMEXPORT optional<string>
+  guess_cache_load (const char* kind, const string& key);
+
+  // Store the entry data, overwriting any existing entry.
+  //
+  LIBBUILD2_SYMEXPORT void
+  guess_cache_store (const char* kind, const string& key, const string&);
+
+  // Entry data serialization.
+  //
+  // Each value is written as <size>:<bytes> so that strings can contain
+  // arbitrary characters.
+  //
+  class LIBBUILD2_SYMEXPORT guess_cache_writer
+  {
+  public:
+    void
+    write_string (const string&);
+
+    void
+    write_uint (uint64_t);
+
+    void
+    write_bool (bool v) {write_uint (v ? 1 : 0);}
+
+    string data;
+  };
+
+  // Throw invalid_argument if the data is corrupted, which should be
+  // treated as a cache miss.
+  //
+  class LIBBUILD2_SYMEXPORT guess_cache_reader
+  {
+  public:
+    explicit
+    guess_cache_reader (const string& d): data_ (d) {}
+
+    string
+    read_string ();
+
+    uint64_t
+    read_uint ();
+
+    bool
+    read_bool () {return read_uint () != 0;}
+
+    // Throw invalid_argument if there is unread data.
+    //
+    void
+    finish () const;
+
+  private:
+    const string& data_;
+    size_t pos_ = 0;
+  };
+}
+
+#endif // LIBBUILD2_GUESS_CACHE_HXX
@@ -4,7 +4,24 @@
 #include <libbuild2/install/rule.hxx>
 #include <libbuild2/install/utility.hxx> // resolve_dir() declaration
 
-#include <libbutl/filesystem.hxx> // dir_exists(), file_exists()
+#ifndef _WIN32
+#  include <unistd.h>    // read(), write()
+#  include <sys/stat.h>  // fchmod()
+#endif
+
+#ifdef __linux__
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>  // FICLONE
+
+// copy_file_range() was added in glibc 2.27.
+//
+#  if defined(__GLIBC__) && \
+      (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#    define LIBBUILD2_INSTALL_COPY_FILE_RANGE
+#  endif
+#endif
+
+#include <libbutl/filesystem.hxx> // dir_exists(), file_exists(), mvfile()
 
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
@@ -1000,6 +1017,249 @@ namespace build2
       return s;
     }
 
+#ifndef _WIN32
+    // Built-in installer.
+    //
+    // Spawning install(1) for each file and directory dominates the time it
+    // takes to install a large number of small files (for example, headers).
+    // So if the default install program is used without any options or sudo
+    // (in which case we know exactly what it would have done), we perform the
+    // equivalent operations in-process. To force the use of the external
+    // program, specify it explicitly (for example, with its absolute path).
+    //
+    static bool
+    builtin_install (const install_dir& base)
+    {
+      return (base.sudo == nullptr    &&
+              base.options == nullptr &&
+              base.cmd != nullptr     &&
+              base.cmd->string () == "install");
+    }
+
+    // Parse the octal install mode returning nullopt if it is not in this
+    // form (for example, symbolic) or has any bits other than the permissions
+    // (setuid, etc) set, in which case the caller should fall back to the
+    // external program.
+    //
+    static optional<permissions>
+    builtin_mode (const string& m)
+    {
+      if (m.empty () || m.size () > 4)
+        return nullopt;
+
+      uint16_t r (0);
+      for (char c: m)
+      {
+        if (c < '0' || c > '7')
+          return nullopt;
+
+        r = r * 8 + static_cast<uint16_t> (c - '0');
+      }
+
+      if ((r & ~0777) != 0)
+        return nullopt;
+
+      return static_cast<permissions> (r);
+    }
+
+    // Copy the file contents from one file descriptor to another, cloning
+    // (reflinking) or copying in the kernel where supported.
+    //
+    static void
+    builtin_copy (int ifd, int ofd)
+    {
+#ifdef FICLONE
+      if (ioctl (ofd, FICLONE, ifd) == 0)
+        return;
+#endif
+
+#ifdef LIBBUILD2_INSTALL_COPY_FILE_RANGE
+      for (;;)
+      {
+        ssize_t n (copy_file_range (ifd, nullptr,
+                                    ofd, nullptr,
+                                    1024 * 1024 * 1024,
+                                    0));
+        if (n > 0)
+          continue;
+
+        if (n == 0)
+          return;
+
+        // Fall back to read/write if not supported for this combination of
+        // filesystems. Note that nothing has been copied in this case.
+        //
+        if (errno == EINTR)
+          continue;
+
+        if (errno != EXDEV      &&
+            errno != EINVAL     &&
+            errno != ENOSYS     &&
+            errno != EOPNOTSUPP &&
+            errno != EPERM)
+          throw_generic_error (errno);
+
+        break;
+      }
+#endif
+
+      char buf[64 * 1024];
+      for (;;)
+      {
+        ssize_t n (read (ifd, buf, sizeof (buf)));
+
+        if (n == 0)
+          return;
+
+        if (n == -1)
+        {
+          if (errno == EINTR)
+            continue;
+
+          throw_generic_error (errno);
+        }
+
+        for (ssize_t w (0); w != n; )
+        {
+          ssize_t r (write (ofd, buf + w, static_cast<size_t> (n - w)));
+
+          if (r == -1)
+          {
+            if (errno == EINTR)
+              continue;
+
+            throw_generic_error (errno);
+          }
+
+          w += r;
+        }
+      }
+    }
+
+    // Install the file similar to install -m <mode> <f> <t>.
+    //
+    // Similar to install(1), we don't write into the existing destination
+    // (which could be hard-linked or be an executable that is running) but
+    // rather replace it. We do it atomically by copying into a temporary
+    // file in the destination directory and then moving it into place.
+    //
+    static void
+    builtin_install_f (const path& f, const path& t, permissions m)
+    {
+      path tmp (t.directory () /
+                path ('.' + t.leaf ().string () + '.' +
+                      to_string (process::current_id ()) + ".tmp"));
+
+      auto_rmfile rm;
+      try
+      {
+        auto_fd ifd (fdopen (f, fdopen_mode::in | fdopen_mode::binary));
+
+        auto_fd ofd (fdopen (tmp,
+                             (fdopen_mode::out      |
+                              fdopen_mode::binary   |
+                              fdopen_mode::truncate |
+                              fdopen_mode::create),
+                             m));
+        rm = auto_rmfile (tmp);
+
+        builtin_copy (ifd.get (), ofd.get ());
+
+        // The mode passed to open() is subject to umask.
+        //
+        if (fchmod (ofd.get (), static_cast<mode_t> (m)) != 0)
+          throw_generic_error (errno);
+
+        ofd.close ();
+        ifd.close ();
+
+        butl::mvfile (tmp,
+                      t,
+                      (cpflags::overwrite_content |
+                       cpflags::overwrite_permissions));
+        rm.cancel ();
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to install " << f << " to " << t << ": " << e;
+      }
+      catch (const system_error& e)
+      {
+        fail << "unable to install " << f << " to " << t << ": " << e;
+      }
+    }
+
+    // Create the directory similar to install -d -m <mode> <d>. If parents
+    // is true, then also create any missing intermediate directories (which,
+    // similar to install(1), get the default mode).
+    //
+    static void
+    builtin_install_d (const dir_path& d, permissions m, bool parents)
+    {
+      try
+      {
+        // Note that the directory could have been created in the meantime
+        // in which case we still set the mode, similar to install(1).
+        //
+        if (parents)
+          try_mkdir_p (d);
+        else
+          try_mkdir (d, static_cast<mode_t> (m));
+
+        path_permissions (d, m);
+      }
+      catch (const system_error& e)
+      {
+        fail << "unable to create directory " << d << ": " << e;
+      }
+    }
+
+    // Built-in uninstaller.
+    //
+    // Removing files and directories does not involve the install program
+    // so the only part of the builtin_install() condition that applies here
+    // is the absence of sudo (in which case we have to run rm/rmdir under
+    // it).
+    //
+    static bool
+    builtin_uninstall (const install_dir& base)
+    {
+      return base.sudo == nullptr;
+    }
+
+    // Remove the file similar to rm -f <f>.
+    //
+    static void
+    builtin_uninstall_f (const path& f)
+    {
+      try
+      {
+        try_rmfile (f);
+      }
+      catch (const system_error& e)
+      {
+        fail << "unable to remove file " << f << ": " << e;
+      }
+    }
+
+    // Remove the empty directory similar to rmdir <d> returning false if
+    // unable to do so.
+    //
+    static bool
+    builtin_uninstall_d (const dir_path& d)
+    {
+      try
+      {
+        try_rmdir (d);
+        return true;
+      }
+      catch (const system_error&)
+      {
+        return false;
+      }
+    }
+#endif
+
     void file_rule::
     install_d (const scope& rs,
                const install_dir& base,
@@ -1043,8 +1303,9 @@ namespace build2
       // base and dir, we do it explicitly, one at a time. This way the output
       // is symmetrical to uninstall() below.
       //
-      // Note that if the chroot directory does not exist, then install -d
-      // will create it and we don't bother removing it.
+      // Note that if the chroot directory (or base itself) does not exist,
+      // then install -d will create it and we don't bother removing it (the
+      // built-in installer does the same, see builtin_install_d()).
       //
       if (d != base.dir)
       {
@@ -1079,7 +1340,20 @@ namespace build2
       args.push_back (reld.c_str ());
       args.push_back (nullptr);
 
-      process_path pp (run_search (args[0]));
+      // Note that we print the equivalent command line even if using the
+      // built-in installer.
+      //
+#ifndef _WIN32
+      optional<permissions> bm;
+      if (builtin_install (base))
+        bm = builtin_mode (*base.dir_mode);
+#endif
+
+      process_path pp;
+#ifndef _WIN32
+      if (!bm)
+#endif
+        pp = run_search (args[0]);
 
       if (verb >= verbosity)
       {
@@ -1089,9 +1363,14 @@ namespace build2
           print_diag ("install -d", chd); // See also `install -l` below.
       }
 
-      run (ctx,
-           pp, args,
-           verb >= verbosity ? 1 : verb_never /* finish_verbosity */);
+#ifndef _WIN32
+      if (bm)
+        builtin_install_d (chd, *bm, d == base.dir);
+      else
+#endif
+        run (ctx,
+             pp, args,
+             verb >= verbosity ? 1 : verb_never /* finish_verbosity */);
 
       context_data::manifest_install_d (ctx, t, d, *base.dir_mode);
     }
@@ -1148,7 +1427,19 @@ namespace build2
       args.push_back (reld.c_str ());
       args.push_back (nullptr);
 
-      process_path pp (run_search (args[0]));
+      // See install_d() for details.
+      //
+#ifndef _WIN32
+      optional<permissions> bm;
+      if (builtin_install (base))
+        bm = builtin_mode (*base.mode);
+#endif
+
+      process_path pp;
+#ifndef _WIN32
+      if (!bm)
+#endif
+        pp = run_search (args[0]);
 
       if (verb >= verbosity)
       {
@@ -1164,9 +1455,16 @@ namespace build2
       }
 
       if (!ctx.dry_run)
-        run (ctx,
-             pp, args,
-             verb >= verbosity ? 1 : verb_never /* finish_verbosity */);
+      {
+#ifndef _WIN32
+        if (bm)
+          builtin_install_f (f, chd / leaf, *bm);
+        else
+#endif
+          run (ctx,
+               pp, args,
+               verb >= verbosity ? 1 : verb_never /* finish_verbosity */);
+      }
 
       context_data::manifest_install_f (ctx, t, base.dir, leaf, *base.mode);
     }
@@ -1429,8 +1727,9 @@ namespace build2
         dir_path reld (relative (chd));
 
         // Normally when we need to remove a file or directory we do it
-        // directly without calling rm/rmdir. This however, won't work if we
-        // have sudo. So we are going to do it both ways.
+        // directly without calling rm/rmdir (see builtin_uninstall_d()).
+        // This however, won't work if we have sudo. So we are going to do it
+        // both ways.
         //
         // While there is no sudo on Windows, deleting things that are being
         // used can get complicated. So we will always use rm/rmdir from
@@ -1442,7 +1741,7 @@ namespace build2
         // failing we issue a warning and skip the directory.
         //
 #ifndef _WIN32
-        if (base.sudo == nullptr)
+        if (builtin_uninstall (base))
         {
           if (verb >= verbosity)
           {
@@ -1452,14 +1751,7 @@ namespace build2
               print_diag ("uninstall -d", chd);
           }
 
-          try
-          {
-            try_rmdir (chd);
-          }
-          catch (const system_error&)
-          {
-            r = false;
-          }
+          r = builtin_uninstall_d (chd);
         }
         else
 #endif
@@ -1529,22 +1821,13 @@ namespace build2
       // MSYS2/Cygwin).
       //
 #ifndef _WIN32
-      if (base.sudo == nullptr)
+      if (builtin_uninstall (base))
       {
         if (verb >= verbosity && verb >= 2)
           text << "rm " << relf;
 
         if (!ctx.dry_run)
-        {
-          try
-          {
-            try_rmfile (f);
-          }
-          catch (const system_error& e)
-          {
-            fail << "unable to remove file " << f << ": " << e;
-          }
-        }
+          builtin_uninstall_f (f);
       }
       else
 #endif
@@ -0,0 +1,912 @@
+// file      : libbuild2/linear-regex.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/linear-regex.hxx>
+
+using namespace std;
+
+namespace build2
+{
+  using opcode = linear_regex::opcode;
+  using instruction = linear_regex::instruction;
+  using charset = bitset<256>;
+
+  // Note that std::regex uses the (normally "C") locale's character
+  // classification. We stick to ASCII which is the same thing for the "C"
+  // locale.
+  //
+  static inline bool
+  digit (char c) {return c >= '0' && c <= '9';}
+
+  static inline bool
+  alpha (char c) {return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');}
+
+  static inline bool
+  word (char c) {return alpha (c) || digit (c) || c == '_';}
+
+  static inline bool
+  space (char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+           c == '\f' || c == '\v';
+  }
+
+  static inline char
+  lower (char c) {return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;}
+
+  static inline char
+  upper (char c) {return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;}
+
+  static inline size_t
+  index (char c) {return static_cast<unsigned char> (c);}
+
+  namespace
+  {
+    // Parsed regular expression.
+    //
+    struct node
+    {
+      enum kind_type
+      {
+        empty, chr, any, cls, bol, eol, wordb, nwordb, group, cat, alt, repeat
+      };
+
+      kind_type    kind;
+      char         c = '\0';
+      size_t       set = 0;    // Character class index.
+      size_t       mark = 0;   // Marked sub-expression number (1-based).
+      size_t       min = 0;    // Repetition bounds (max is npos if
+      size_t       max = 0;    // unbounded).
+      bool         greedy = true;
+      vector<node> nodes;
+
+      explicit
+      node (kind_type k): kind (k) {}
+    };
+
+    // The maximum {n,m} bound and program size we are prepared to handle.
+    //
+    const size_t max_bound = 1000;
+    const size_t max_program = 20000;
+
+    // Recursive-descent parser. Throw unsupported if the pattern is not
+    // supported or is invalid.
+    //
+    struct unsupported {};
+
+    class parser
+    {
+    public:
+      parser (const string& s, bool icase, vector<charset>& cs)
+          : s_ (s), n_ (s.size ()), icase_ (icase), classes_ (cs) {}
+
+      node
+      parse ()
+      {
+        node r (parse_alt ());
+
+        if (i_ != n_) // Unbalanced ')'.
+          throw unsupported ();
+
+        return r;
+      }
+
+      size_t marks = 0;
+      bool   exact = true;
+
+    private:
+      node
+      parse_alt ()
+      {
+        node r (node::alt);
+        r.nodes.push_back (parse_cat ());
+
+        while (i_ != n_ && s_[i_] == '|')
+        {
+          ++i_;
+          r.nodes.push_back (parse_cat ());
+        }
+
+        return r.nodes.size () == 1 ? move (r.nodes.front ()) : move (r);
+      }
+
+      node
+      parse_cat ()
+      {
+        node r (node::cat);
+
+        while (i_ != n_ && s_[i_] != '|' && s_[i_] != ')')
+        {
+          size_t m (marks);
+          node a (parse_atom ());
+
+          if (i_ != n_ && quantifier (s_[i_]))
+          {
+            // Repeating an assertion is not valid.
+            //
+            if (a.kind == node::bol   || a.kind == node::eol ||
+                a.kind == node::wordb || a.kind == node::nwordb)
+              throw unsupported ();
+
+            node q (node::repeat);
+            parse_quantifier (q);
+
+            // ECMAScript has special rules for the iterations that match
+            // empty which std::regex implementations don't follow
+            // consistently. So we leave such cases to std::regex.
+            //
+            if (q.max > 1 && nullable (a))
+              throw unsupported ();
+
+            if (q.max > 1 && marks != m)
+              exact = false;
+
+            q.nodes.push_back (move (a));
+            a = move (q);
+
+            if (i_ != n_ && quantifier (s_[i_])) // For example, a**.
+              throw unsupported ();
+          }
+
+          r.nodes.push_back (move (a));
+        }
+
+        return r.nodes.size () == 1 ? move (r.nodes.front ()) : move (r);
+      }
+
+      // Return true if the expression can match the empty string.
+      //
+      static bool
+      nullable (const node& n)
+      {
+        switch (n.kind)
+        {
+        case node::chr:
+        case node::any:
+        case node::cls:    return false;
+        case node::group:  return nullable (n.nodes.front ());
+        case node::repeat: return n.min == 0 || nullable (n.nodes.front ());
+        case node::cat:
+          {
+            for (const node& x: n.nodes)
+              if (!nullable (x))
+                return false;
+
+            return true;
+          }
+        case node::alt:
+          {
+            for (const node& x: n.nodes)
+              if (nullable (x))
+                return true;
+
+            return false;
+          }
+        default:           return true; // Empty and assertions.
+        }
+      }
+
+      static bool
+      quantifier (char c)
+      {
+        return c == '*' || c == '+' || c == '?' || c == '{';
+      }
+
+      void
+      parse_quantifier (node& q)
+      {
+        switch (s_[i_++])
+        {
+        case '*': q.min = 0; q.max = string::npos; break;
+        case '+': q.min = 1; q.max = string::npos; break;
+        case '?': q.min = 0; q.max = 1;            break;
+        default:
+          {
+            q.min = parse_number ();
+            q.max = q.min;
+
+            if (i_ != n_ && s_[i_] == ',')
+            {
+              ++i_;
+              q.max = (i_ != n_ && s_[i_] == '}'
+                       ? string::npos
+                       : parse_number ());
+            }
+
+            if (i_ == n_ || s_[i_] != '}' || q.min > q.max)
+              throw unsupported ();
+
+            ++i_;
+          }
+        }
+
+        if (i_ != n_ && s_[i_] == '?')
+        {
+          q.greedy = false;
+          ++i_;
+        }
+      }
+
+      size_t
+      parse_number ()
+      {
+        size_t r (0), b (i_);
+
+        for (; i_ != n_ && digit (s_[i_]); ++i_)
+        {
+          r = r * 10 + (s_[i_] - '0');
+
+          if (r > max_bound)
+            throw unsupported ();
+        }
+
+        if (i_ == b)
+          throw unsupported ();
+
+        return r;
+      }
+
+      node
+      parse_atom ()
+      {
+        char c (s_[i_++]);
+
+        switch (c)
+        {
+        case '(':
+          {
+            node r (node::group);
+
+            if (i_ != n_ && s_[i_] == '?')
+            {
+              // Only non-capturing groups (no lookahead, etc).
+              //
+              if (i_ + 1 == n_ || s_[i_ + 1] != ':')
+                throw unsupported ();
+
+              i_ += 2;
+            }
+            else
+              r.mark = ++marks;
+
+            r.nodes.push_back (parse_alt ());
+
+            if (i_ == n_ || s_[i_] != ')')
+              throw unsupported ();
+
+            ++i_;
+            return r;
+          }
+        case '[':  return parse_class ();
+        case '.':  return node (node::any);
+        case '^':  return node (node::bol);
+        case '$':  return node (node::eol);
+        case '\\': return parse_escape ();
+
+          // Nothing to repeat or (in case of braces) ambiguous.
+          //
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case '}':
+        case ']': throw unsupported ();
+        }
+
+        node r (node::chr);
+        r.c = c;
+        return r;
+      }
+
+      node
+      parse_escape ()
+      {
+        if (i_ == n_)
+          throw unsupported ();
+
+        char c (s_[i_++]);
+
+        switch (c)
+        {
+        case 'b': return node (node::wordb);
+        case 'B': return node (node::nwordb);
+        case 'd':
+        case 'D':
+        case 'w':
+        case 'W':
+        case 's':
+        case 'S':
+          {
+            charset cs;
+            add_class (cs, c);
+            return make_class (cs, false);
+          }
+        }
+
+        node r (node::chr);
+        r.c = escape_char (c);
+        return r;
+      }
+
+      // Return the character for a character escape (the backslash has
+      // already been consumed).
+      //
+      char
+      escape_char (char c)
+      {
+        switch (c)
+        {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case 'x':
+          {
+            if (n_ - i_ < 2)
+              throw unsupported ();
+
+            char r (static_cast<char> (hex (s_[i_]) * 16 + hex (s_[i_ + 1])));
+            i_ += 2;
+            return r;
+          }
+        }
+
+        // Backreferences, \c, \u, \0, etc.
+        //
+        if (alpha (c) || digit (c))
+          throw unsupported ();
+
+        return c; // Identity escape.
+      }
+
+      static unsigned int
+      hex (char c)
+      {
+        if (digit (c))             return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        throw unsupported ();
+      }
+
+      static void
+      add_class (charset& cs, char c)
+      {
+        bool neg (c == 'D' || c == 'W' || c == 'S');
+
+        for (size_t i (0); i != 256; ++i)
+        {
+          char x (static_cast<char> (i));
+          bool in (lower (c) == 'd' ? digit (x) :
+                   lower (c) == 'w' ? word (x)  :
+                   /* 's' */          space (x));
+
+          if (in != neg)
+            cs.set (i);
+        }
+      }
+
+      node
+      parse_class ()
+      {
+        // Note that we leave the edge cases (empty class, POSIX classes, etc)
+        // to std::regex.
+        //
+        bool neg (i_ != n_ && s_[i_] == '^');
+        if (neg)
+          ++i_;
+
+        if (i_ == n_ || s_[i_] == ']')
+          throw unsupported ();
+
+        charset cs;
+
+        // Parse the class element returning true if it is a character (which
+        // could then start a range) and false if it is a class escape.
+        //
+        auto element = [this, &cs] (char& r) -> bool
+        {
+          char c (s_[i_++]);
+
+          if (c == '[' && i_ != n_ &&
+              (s_[i_] == ':' || s_[i_] == '.' || s_[i_] == '='))
+            throw unsupported ();
+
+          if (c == '\\')
+          {
+            if (i_ == n_)
+              throw unsupported ();
+
+            c = s_[i_++];
+
+            switch (c)
+            {
+            case 'd':
+            case 'D':
+            case 'w':
+            case 'W':
+            case 's':
+            case 'S': add_class (cs, c); return false;
+            case 'b': throw unsupported (); // Backspace.
+            }
+
+            c = escape_char (c);
+          }
+
+          r = c;
+          return true;
+        };
+
+        while (i_ != n_ && s_[i_] != ']')
+        {
+          char f;
+          if (!element (f))
+          {
+            // A class escape cannot start a range.
+            //
+            if (i_ != n_ && s_[i_] == '-' && i_ + 1 != n_ && s_[i_ + 1] != ']')
+              throw unsupported ();
+
+            continue;
+          }
+
+          if (i_ + 1 < n_ && s_[i_] == '-' && s_[i_ + 1] != ']')
+          {
+            ++i_;
+
+            char l;
+            if (!element (l) || index (f) > index (l))
+              throw unsupported ();
+
+            for (size_t j (index (f)); j <= index (l); ++j)
+              cs.set (j);
+          }
+          else
+            cs.set (index (f));
+        }
+
+        if (i_ == n_)
+          throw unsupported ();
+
+        ++i_; // ']'
+
+        return make_class (cs, neg);
+      }
+
+      // Add the class to the list applying case folding and negation (in
+      // this order) and return its node.
+      //
+      node
+      make_class (const charset& cs, bool neg)
+      {
+        charset r (cs);
+
+        if (icase_)
+        {
+          for (size_t i (0); i != 256; ++i)
+          {
+            char c (static_cast<char> (i));
+            if (cs.test (index (lower (c))) || cs.test (index (upper (c))))
+              r.set (i);
+          }
+        }
+
+        if (neg)
+          r.flip ();
+
+        node n (node::cls);
+        n.set = classes_.size ();
+        classes_.push_back (r);
+        return n;
+      }
+
+    private:
+      const string&    s_;
+      size_t           i_ = 0;
+      size_t           n_;
+      bool             icase_;
+      vector<charset>& classes_;
+    };
+
+    // Compiler of the parsed expression into the program.
+    //
+    class compiler
+    {
+    public:
+      compiler (vector<instruction>& p, bool icase)
+          : prog_ (p), icase_ (icase) {}
+
+      void
+      compile (const node& n)
+      {
+        switch (n.kind)
+        {
+        case node::empty:                         break;
+        case node::chr:    emit (opcode::chr, icase_ ? lower (n.c) : n.c);
+                           break;
+        case node::any:    emit (opcode::any);    break;
+        case node::cls:    emit (opcode::cls, '\0', n.set);
+                           break;
+        case node::bol:    emit (opcode::bol);    break;
+        case node::eol:    emit (opcode::eol);    break;
+        case node::wordb:  emit (opcode::wordb);  break;
+        case node::nwordb: emit (opcode::nwordb); break;
+        case node::group:
+          {
+            if (n.mark != 0)
+              emit (opcode::save, '\0', n.mark * 2);
+
+            compile (n.nodes.front ());
+
+            if (n.mark != 0)
+              emit (opcode::save, '\0', n.mark * 2 + 1);
+
+            break;
+          }
+        case node::cat:
+          {
+            for (const node& x: n.nodes)
+              compile (x);
+
+            break;
+          }
+        case node::alt:
+          {
+            //     split L1, L2
+            // L1: <x1>
+            //     jmp E
+            // L2: split L2', L3
+            //     ...
+            // Ln: <xn>
+            // E:
+            //
+            vector<size_t> js;
+
+            for (size_t i (0), e (n.nodes.size ()); i != e; ++i)
+            {
+              if (i + 1 != e)
+              {
+                size_t s (emit (opcode::split));
+                prog_[s].x = static_cast<uint32_t> (pc ());
+                compile (n.nodes[i]);
+                js.push_back (emit (opcode::jmp));
+                prog_[s].y = static_cast<uint32_t> (pc ());
+              }
+              else
+                compile (n.nodes[i]);
+            }
+
+            for (size_t j: js)
+              prog_[j].x = static_cast<uint32_t> (pc ());
+
+            break;
+          }
+        case node::repeat:
+          {
+            const node& x (n.nodes.front ());
+
+            for (size_t i (0); i != n.min; ++i)
+              compile (x);
+
+            if (n.max == string::npos)
+            {
+              // L: split B, E
+              // B: <x>
+              //    jmp L
+              // E:
+              //
+              size_t l (emit (opcode::split));
+              prog_[l].x = static_cast<uint32_t> (pc ());
+              compile (x);
+              emit (opcode::jmp, '\0', l);
+              prog_[l].y = static_cast<uint32_t> (pc ());
+
+              if (!n.greedy)
+                swap (prog_[l].x, prog_[l].y);
+            }
+            else
+            {
+              //     split B1, E
+              // B1: <x>
+              //     split B2, E
+              //     ...
+              // E:
+              //
+              vector<size_t> ss;
+              for (size_t i (n.min); i != n.max; ++i)
+              {
+                size_t s (emit (opcode::split));
+                prog_[s].x = static_cast<uint32_t> (pc ());
+                ss.push_back (s);
+                compile (x);
+              }
+
+              for (size_t s: ss)
+              {
+                prog_[s].y = static_cast<uint32_t> (pc ());
+
+                if (!n.greedy)
+                  swap (prog_[s].x, prog_[s].y);
+              }
+            }
+
+            break;
+          }
+        }
+      }
+
+      size_t
+      pc () const {return prog_.size ();}
+
+      size_t
+      emit (opcode op, char c = '\0', size_t x = 0)
+      {
+        if (prog_.size () == max_program)
+          throw unsupported ();
+
+        prog_.push_back (instruction {op, c, static_cast<uint32_t> (x), 0});
+        return prog_.size () - 1;
+      }
+
+    private:
+      vector<instruction>& prog_;
+      bool                 icase_;
+    };
+  }
+
+  optional<linear_regex> linear_regex::
+  compile (const string& s, bool icase)
+  {
+    linear_regex r;
+    r.icase_ = icase;
+
+    try
+    {
+      parser p (s, icase, r.classes_);
+      node n (p.parse ());
+
+      r.marks_ = p.marks;
+      r.exact_ = p.exact;
+
+      compiler c (r.prog_, icase);
+
+      c.emit (opcode::save, '\0', 0);
+      c.compile (n);
+      c.emit (opcode::save, '\0', 1);
+      c.emit (opcode::match);
+    }
+    catch (const unsupported&)
+    {
+      return nullopt;
+    }
+
+    return r;
+  }
+
+  bool linear_regex::
+  match (const string& s, submatches* m) const
+  {
+    return run (s, false /* search */, false /* not_null */, m);
+  }
+
+  bool linear_regex::
+  search (const string& s, bool not_null, submatches* m) const
+  {
+    return run (s, true /* search */, not_null, m);
+  }
+
+  // Pike VM.
+  //
+  // Each thread is a program counter plus its submatch positions. Threads
+  // are kept in the priority order and, since the threads at the same
+  // program counter behave identically from then on, only the first
+  // (highest priority) one is kept, which is what makes it linear.
+  //
+  namespace
+  {
+    class thread_list
+    {
+    public:
+      thread_list (size_t prog, size_t caps)
+          : caps_n (caps), marks_ (prog, 0) {}
+
+      bool
+      marked (size_t pc) const {return marks_[pc] == gen_;}
+
+      void
+      mark (size_t pc) {marks_[pc] = gen_;}
+
+      void
+      push (size_t pc, const size_t* caps)
+      {
+        pcs.push_back (pc);
+        caps_.insert (caps_.end (), caps, caps + caps_n);
+      }
+
+      size_t
+      size () const {return pcs.size ();}
+
+      const size_t*
+      caps (size_t i) const {return caps_.data () + i * caps_n;}
+
+      void
+      clear ()
+      {
+        pcs.clear ();
+        caps_.clear ();
+
+        if (++gen_ == 0) // Wrapped around.
+        {
+          fill (marks_.begin (), marks_.end (), 0);
+          gen_ = 1;
+        }
+      }
+
+      size_t         caps_n;
+      vector<size_t> pcs;
+
+    private:
+      vector<size_t> caps_;
+      vector<size_t> marks_;
+      size_t         gen_ = 1;
+    };
+  }
+
+  bool linear_regex::
+  run (const string& s, bool search, bool not_null, submatches* m) const
+  {
+    const size_t n (s.size ());
+    const size_t nc ((marks_ + 1) * 2);
+
+    thread_list cl (prog_.size (), nc), nl (prog_.size (), nc);
+
+    // Add a thread following the non-consuming instructions. To keep the
+    // stack usage bounded we use an explicit stack of pending program
+    // counters and submatch restorations (pc is npos for the latter).
+    //
+    struct pending {size_t pc; size_t slot; size_t pos;};
+
+    vector<size_t> caps (nc, string::npos);
+    vector<pending> stack;
+
+    auto add = [this, &s, n, &caps, &stack] (thread_list& l,
+                                             size_t pc,
+                                             size_t sp)
+    {
+      stack.push_back (pending {pc, 0, 0});
+
+      while (!stack.empty ())
+      {
+        pending e (stack.back ());
+        stack.pop_back ();
+
+        if (e.pc == string::npos)
+        {
+          caps[e.slot] = e.pos;
+          continue;
+        }
+
+        for (pc = e.pc; !l.marked (pc); )
+        {
+          l.mark (pc);
+
+          const instruction& i (prog_[pc]);
+
+          bool next (true);
+          switch (i.op)
+          {
+          case opcode::jmp:
+            {
+              pc = i.x;
+              continue;
+            }
+          case opcode::split:
+            {
+              stack.push_back (pending {i.y, 0, 0});
+              pc = i.x;
+              continue;
+            }
+          case opcode::save:
+            {
+              stack.push_back (pending {string::npos, i.x, caps[i.x]});
+              caps[i.x] = sp;
+              break;
+            }
+          case opcode::bol: next = sp == 0; break;
+          case opcode::eol: next = sp == n; break;
+          case opcode::wordb:
+          case opcode::nwordb:
+            {
+              bool b ((sp != 0 && word (s[sp - 1])) !=
+                      (sp != n && word (s[sp])));
+
+              next = b == (i.op == opcode::wordb);
+              break;
+            }
+          default:
+            {
+              l.push (pc, caps.data ());
+              next = false;
+              break;
+            }
+          }
+
+          if (!next)
+            break;
+
+          ++pc;
+        }
+      }
+    };
+
+    bool r (false);
+
+    for (size_t sp (0);; ++sp)
+    {
+      // Start a new (lowest priority) thread unless we already have a match.
+      //
+      if (!r && (search || sp == 0))
+      {
+        fill (caps.begin (), caps.end (), string::npos);
+        add (cl, 0, sp);
+      }
+
+      if (cl.size () == 0)
+      {
+        if (r || !search || sp >= n)
+          break;
+
+        cl.clear ();
+        continue;
+      }
+
+      char c (sp != n ? s[sp] : '\0');
+      char lc (icase_ ? lower (c) : c);
+
+      for (size_t t (0); t != cl.size (); ++t)
+      {
+        const instruction& i (prog_[cl.pcs[t]]);
+        const size_t* tc (cl.caps (t));
+
+        bool adv (false);
+        switch (i.op)
+        {
+        case opcode::match:
+          {
+            if ((!search && sp != n) || (not_null && tc[0] == sp))
+              continue;
+
+            r = true;
+
+            if (m != nullptr)
+              m->assign (tc, tc + nc);
+
+            // Cut off the lower priority threads.
+            //
+            t = cl.size () - 1;
+            continue;
+          }
+        case opcode::chr: adv = sp != n && lc == i.c;                 break;
+        case opcode::any: adv = sp != n && c != '\n' && c != '\r';    break;
+        case opcode::cls: adv = sp != n && classes_[i.x].test (index (c));
+                          break;
+        default:                                                      break;
+        }
+
+        if (adv)
+        {
+          caps.assign (tc, tc + nc);
+          add (nl, cl.pcs[t] + 1, sp + 1);
+        }
+      }
+
+      if (sp == n)
+        break;
+
+      swap (cl, nl);
+      nl.clear ();
+    }
+
+    return r;
+  }
+}
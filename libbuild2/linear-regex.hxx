@@ -0,0 +1,118 @@
+// file      : libbuild2/linear-regex.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_LINEAR_REGEX_HXX
+#define LIBBUILD2_LINEAR_REGEX_HXX
+
+#include <bitset>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Linear-time regular expression matcher.
+  //
+  // The std::regex implementations are backtracking, which makes them slow
+  // and recursion-heavy on long inputs. This class implements the subset of
+  // the ECMAScript grammar that is commonly used in buildfiles by simulating
+  // the NFA (the so-called Pike VM). This takes time linear in the input
+  // size and produces the same matches as std::regex: leftmost, with the
+  // ECMAScript priority of alternatives and greedy/lazy quantifiers.
+  //
+  // The supported constructs are:
+  // - literal characters and identity escapes;
+  // - `.` and character classes, including ranges and the \d, \w, \s
+  //   escapes and their complements;
+  // - the `^`, `$`, \b, and \B assertions;
+  // - capturing and non-capturing groups, and alternation;
+  // - the *, +, ?, and {n,m} greedy and lazy quantifiers.
+  //
+  // Patterns that use anything else (backreferences, lookahead, POSIX
+  // character classes, etc), that repeat sub-expressions which can match
+  // empty (std::regex implementations differ from ECMAScript on these), as
+  // well as invalid patterns, are rejected. The caller should then fall back
+  // to std::regex (which will also diagnose the invalid ones).
+  //
+  class LIBBUILD2_SYMEXPORT linear_regex
+  {
+  public:
+    // Return nullopt if the pattern is not supported (see above).
+    //
+    static optional<linear_regex>
+    compile (const string&, bool icase = false);
+
+    // Number of marked sub-expressions.
+    //
+    size_t
+    mark_count () const {return marks_;}
+
+    // Return false if the pattern contains marked sub-expressions inside
+    // repetitions. ECMAScript has special rules for these (they are reset
+    // on each iteration) which are not implemented. In this case only the
+    // presence of a match and the whole match are guaranteed to be the
+    // same as with std::regex.
+    //
+    bool
+    exact_submatches () const {return exact_;}
+
+    // Submatch positions: the begin and end offsets of the whole match
+    // followed by those of each marked sub-expression. An unmatched
+    // sub-expression has string::npos as both offsets.
+    //
+    using submatches = vector<size_t>;
+
+    // Return true if the entire string matches (the regex_match()
+    // semantics).
+    //
+    bool
+    match (const string&, submatches* = nullptr) const;
+
+    // Return true if some part of the string matches (the regex_search()
+    // semantics). If not_null is true, then ignore empty matches (the
+    // match_not_null semantics).
+    //
+    bool
+    search (const string&,
+            bool not_null = false,
+            submatches* = nullptr) const;
+
+  public:
+    enum class opcode: uint8_t
+    {
+      chr,     // Match character c.
+      any,     // Match any character except newline.
+      cls,     // Match character from classes_[x].
+      bol,     // Assert beginning of string.
+      eol,     // Assert end of string.
+      wordb,   // Assert word boundary.
+      nwordb,  // Assert not word boundary.
+      save,    // Save the current position into submatch slot x.
+      jmp,     // Continue at x.
+      split,   // Continue at x and, with lower priority, at y.
+      match    // Match.
+    };
+
+    struct instruction
+    {
+      opcode   op;
+      char     c;
+      uint32_t x;
+      uint32_t y;
+    };
+
+  private:
+    bool
+    run (const string&, bool search, bool not_null, submatches*) const;
+
+    vector<instruction>      prog_;
+    vector<std::bitset<256>> classes_;
+    size_t                   marks_ = 0;
+    bool                     exact_ = true;
+    bool                     icase_ = false;
+  };
+}
+
+#endif // LIBBUILD2_LINEAR_REGEX_HXX
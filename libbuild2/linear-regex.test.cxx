@@ -0,0 +1,208 @@
+// file      : libbuild2/linear-regex.test.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <iostream>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/linear-regex.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+using namespace std;
+
+namespace build2
+{
+  // Return the std::regex submatches in the linear_regex representation.
+  //
+  static linear_regex::submatches
+  offsets (const string& s, const smatch& m)
+  {
+    linear_regex::submatches r;
+    for (const auto& sm: m)
+    {
+      if (sm.matched)
+      {
+        r.push_back (static_cast<size_t> (sm.first - s.begin ()));
+        r.push_back (static_cast<size_t> (sm.second - s.begin ()));
+      }
+      else
+      {
+        r.push_back (string::npos);
+        r.push_back (string::npos);
+      }
+    }
+    return r;
+  }
+
+  // Verify that linear_regex produces the same results as std::regex.
+  //
+  static void
+  verify (const string& p, const strings& ss, bool icase = false)
+  {
+    optional<linear_regex> lr (linear_regex::compile (p, icase));
+
+    if (!lr)
+    {
+      cerr << "unsupported pattern '" << p << "'" << endl;
+      assert (false);
+    }
+
+    regex re (p, icase ? regex::ECMAScript | regex::icase : regex::ECMAScript);
+
+    assert (lr->mark_count () == re.mark_count ());
+
+    for (const string& s: ss)
+    {
+      auto fail = [&p, &s] (const char* w)
+      {
+        cerr << w << " mismatch for '" << p << "' on '" << s << "'" << endl;
+        assert (false);
+      };
+
+      linear_regex::submatches lm;
+      smatch m;
+
+      bool r (regex_match (s, m, re));
+      if (lr->match (s, &lm) != r)
+        fail ("match");
+
+      if (r && lr->exact_submatches () && lm != offsets (s, m))
+        fail ("match submatches");
+
+      for (bool nn: {false, true})
+      {
+        r = regex_search (s,
+                          m,
+                          re,
+                          nn
+                          ? regex_constants::match_not_null
+                          : regex_constants::match_default);
+
+        if (lr->search (s, nn, &lm) != r)
+          fail ("search");
+
+        if (r)
+        {
+          linear_regex::submatches sm (offsets (s, m));
+
+          if (lr->exact_submatches () ? lm != sm : (lm[0] != sm[0] ||
+                                                    lm[1] != sm[1]))
+            fail ("search submatches");
+        }
+      }
+    }
+  }
+
+  int
+  main (int, char*[])
+  {
+    strings ss {
+      "", "a", "b", "ab", "ba", "abc", "aab", "abab", "aaa", "abcabc",
+      "foo.cxx", "foo.hxx", "bar.test.cxx", "libfoo.so.1.2", "x y\tz",
+      "a\nb", "a\rb", "A", "AbC", "FOO.CXX", "_9", "a-b", "[x]", "a.b", "1.23",
+      "--foo=bar", "-DFOO", "-I/usr/include", "hello world"};
+
+    // Literals, classes, and assertions.
+    //
+    verify ("a", ss);
+    verify ("abc", ss);
+    verify (".", ss);
+    verify ("a.b", ss);
+    verify ("a\\.b", ss);
+    verify ("[abc]", ss);
+    verify ("[^abc]", ss);
+    verify ("[a-c]+", ss);
+    verify ("[^a-z]+", ss);
+    verify ("[\\w.]+", ss);
+    verify ("[\\s\\d]", ss);
+    verify ("[-a]", ss);
+    verify ("[a-]", ss);
+    verify ("[\\]x]", ss);
+    verify ("\\d+", ss);
+    verify ("\\D+", ss);
+    verify ("\\w+", ss);
+    verify ("\\W", ss);
+    verify ("\\s", ss);
+    verify ("\\S+", ss);
+    verify ("\\x41", ss);
+    verify ("\\t|\\n|\\r", ss);
+    verify ("^a", ss);
+    verify ("b$", ss);
+    verify ("^$", ss);
+    verify ("\\bb", ss);
+    verify ("\\Bb", ss);
+    verify ("a\\b", ss);
+
+    // Groups, alternation, and repetition.
+    //
+    verify ("(a)(b)?", ss);
+    verify ("(?:ab)+", ss);
+    verify ("a|b|", ss);
+    verify ("(a|ab)(c|bcd)?", ss);
+    verify ("a*", ss);
+    verify ("a*?", ss);
+    verify ("a+?b", ss);
+    verify ("a??b", ss);
+    verify ("a{2}", ss);
+    verify ("a{1,2}", ss);
+    verify ("a{1,2}?", ss);
+    verify ("a{2,}", ss);
+    verify ("(a*)b", ss);
+    verify ("(a*?)(a*)", ss);
+    verify ("(.*)\\.(cxx|hxx)", ss);
+    verify ("(.+?)\\.(.*)", ss);
+    verify ("^-D(.+)$", ss);
+    verify ("^-I(.*)", ss);
+    verify ("^--([^=]+)=(.*)$", ss);
+    verify ("lib(.+)\\.so(\\.[0-9]+)*", ss);
+    verify ("(a|b)*c", ss);
+    verify ("()", ss);
+    verify ("(?:)", ss);
+    verify ("(a+)*", ss);
+    verify ("(?:a|b|c)+?b", ss);
+
+    // Case-insensitive.
+    //
+    verify ("abc", ss, true);
+    verify ("[a-c]+", ss, true);
+    verify ("[^a-z]+", ss, true);
+    verify ("(.*)\\.CXX", ss, true);
+    verify ("\\W", ss, true);
+
+    // Unsupported (or invalid) patterns.
+    //
+    for (const char* p: {
+           "(a)\\1", "(?=a)", "(?!a)", "[[:alpha:]]", "\\ca", "\\0",
+           "\\u0041", "a**", "*a", "a{1", "a{2,1}", "a{1001}", "(a", "a)",
+           "[a", "[]", "[b-a]", "[\\d-z]", "[\\b]", "{", "}", "]", "\\",
+           "\\q", "^*", "(a*)*", "(a|)+b", "(?:a?){2}"})
+      assert (!linear_regex::compile (p));
+
+    // Submatches inside repetitions are not exact.
+    //
+    assert (!linear_regex::compile ("(a)*")->exact_submatches ());
+    assert (linear_regex::compile ("(a)?")->exact_submatches ());
+
+    // Linear time on the classic catastrophic backtracking case.
+    //
+    {
+      string s (100000, 'a');
+      optional<linear_regex> lr (linear_regex::compile ("(a|aa)*b"));
+      assert (!lr->match (s) && !lr->search (s));
+
+      s += 'b';
+      assert (lr->match (s));
+    }
+
+    return 0;
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  return build2::main (argc, argv);
+}
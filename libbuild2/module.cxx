@@ -15,6 +15,7 @@
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/profile.hxx>
 #include <libbuild2/operation.hxx>
 #include <libbuild2/diagnostics.hxx>
 
@@ -116,6 +117,12 @@ namespace build2
     //
     context& mctx (*(ctx.module_context = ctx.module_context_storage->get ()));
 
+    mctx.profile = ctx.profile;
+
+    // Share the modification time prefetcher (see context::mtime_prefetch).
+    //
+    mctx.mtime_prefetch = ctx.mtime_prefetch;
+
     // Note: ctx cannot be the nested u-d-l context (see update_during_load()
     // for details).
     //
@@ -213,6 +220,11 @@ namespace build2
     action a (perform_update_id);
     action_targets tgs;
 
+    // We share the profile with the outer context (see
+    // create_module_context()) so restore its phase once done.
+    //
+    profile::phase_guard pg (mctx.profile);
+
     mo_perform.search  ({},      /* parameters */
                         rs,      /* root scope */
                         rs,      /* base scope */
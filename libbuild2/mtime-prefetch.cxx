@@ -0,0 +1,185 @@
+// file      : libbuild2/mtime-prefetch.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/mtime-prefetch.hxx>
+
+#include <libbutl/filesystem.hxx> // file_mtime()
+
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  mtime_prefetcher::
+  mtime_prefetcher (size_t shards, size_t threads)
+      : shards_ (new shard[shards]), shard_count_ (shards), threads_ (threads)
+  {
+  }
+
+  mtime_prefetcher::
+  ~mtime_prefetcher ()
+  {
+    if (!workers_.empty ())
+    {
+      {
+        mlock l (mutex_);
+        stop_ = true;
+      }
+
+      cv_.notify_all ();
+
+      for (thread& t: workers_)
+        t.join ();
+    }
+  }
+
+  void mtime_prefetcher::
+  prefetch (const char* p, size_t n)
+  {
+    if (threads_ == 0)
+      return;
+
+    string k (p, n);
+    size_t h (hash<string> () (k));
+    prefetch (move (k), h);
+  }
+
+  void mtime_prefetcher::
+  prefetch (string k, size_t h)
+  {
+    if (threads_ == 0)
+      return;
+
+    shard& s (find_shard (h));
+
+    // First check under the shared lock, which is the common case since the
+    // same files are normally referenced by many targets.
+    //
+    {
+      slock l (s.mutex);
+      if (s.map.find (k) != s.map.end ())
+        return;
+    }
+
+    map_type::value_type* e;
+    {
+      ulock l (s.mutex);
+
+      auto r (s.map.emplace (move (k), timestamp_unknown_rep));
+      if (!r.second)
+        return;
+
+      e = &*r.first;
+    }
+
+    mlock l (mutex_);
+
+    // Start the worker threads on first use. If we fail to start any, then
+    // the file will simply never be loaded, which is harmless.
+    //
+    if (workers_.empty ())
+    {
+      try
+      {
+        for (size_t i (0); i != threads_; ++i)
+          workers_.push_back (thread (&mtime_prefetcher::worker, this));
+      }
+      catch (const system_error& e)
+      {
+        tracer trace ("mtime_prefetcher::prefetch");
+        l5 ([&]{trace << "unable to start worker thread: " << e;});
+
+        if (workers_.empty ())
+          return;
+      }
+    }
+
+    queue_.push_back (item {&s, e});
+
+    l.unlock ();
+    cv_.notify_one ();
+  }
+
+  optional<timestamp> mtime_prefetcher::
+  find (const path& p) const
+  {
+    if (threads_ == 0)
+      return nullopt;
+
+    const string& k (p.string ());
+    const shard& s (find_shard (hash<string> () (k)));
+
+    slock l (s.mutex);
+
+    auto i (s.map.find (k));
+    if (i == s.map.end () || i->second == timestamp_unknown_rep)
+      return nullopt;
+
+    return timestamp (duration (i->second));
+  }
+
+  void mtime_prefetcher::
+  invalidate (const path& p)
+  {
+    if (threads_ == 0)
+      return;
+
+    const string& k (p.string ());
+    shard& s (find_shard (hash<string> () (k)));
+
+    // Note that we cannot erase the entry since it could be referenced from
+    // the queue. Instead we reset it to pending which will cause find() to
+    // return nullopt. If the worker loads it after that, then the value
+    // will be fresh.
+    //
+    ulock l (s.mutex);
+
+    auto i (s.map.find (k));
+    if (i != s.map.end ())
+      i->second = timestamp_unknown_rep;
+  }
+
+  void mtime_prefetcher::
+  worker ()
+  {
+    mlock l (mutex_);
+
+    // Note that on stop we don't bother loading the rest of the queue.
+    //
+    while (!stop_)
+    {
+      if (head_ == queue_.size ())
+      {
+        // Reclaim the queue storage while we are at it.
+        //
+        queue_.clear ();
+        head_ = 0;
+
+        cv_.wait (l);
+        continue;
+      }
+
+      item i (queue_[head_++]);
+
+      l.unlock ();
+
+      // Note that file_mtime() returns timestamp_nonexistent for the
+      // non-existent entries but throws for other errors in which case we
+      // leave the entry pending and let the caller load (and diagnose) it.
+      //
+      try
+      {
+        timestamp::rep r (file_mtime (i.e->first.c_str ()).
+                          time_since_epoch ().count ());
+
+        ulock sl (i.s->mutex);
+        i.e->second = r;
+      }
+      catch (const system_error&) {}
+
+      l.lock ();
+    }
+  }
+}
@@ -0,0 +1,132 @@
+// file      : libbuild2/mtime-prefetch.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_MTIME_PREFETCH_HXX
+#define LIBBUILD2_MTIME_PREFETCH_HXX
+
+#include <unordered_map>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Asynchronous file modification time prefetcher.
+  //
+  // When checking whether a target is up to date, rules often have to load
+  // the modification times of a large number of prerequisite files (for
+  // example, the header dependencies of a translation unit cached in depdb)
+  // with each load done serially as part of matching the corresponding
+  // prerequisite target. If the filesystem has high latency (for example,
+  // NFS), then this can dominate the no-op build time.
+  //
+  // The prefetcher allows such a rule to queue the files whose modification
+  // times it expects to need shortly so that they are loaded in parallel by
+  // a pool of background threads (see --mtime-prefetch). The fallback file
+  // rule (which is what loads the modification times of the source files)
+  // then uses the prefetched value if available.
+  //
+  // Each file is only loaded once per context (which matches the lifetime
+  // of the modification times cached in targets). Note that because of
+  // that only files that are not expected to change during the build (that
+  // is, source files as opposed to generated) should be prefetched, though
+  // since the prefetched value is only used by the fallback file rule, this
+  // is not a correctness issue.
+  //
+  // The nested module and update-during-load contexts share the prefetcher
+  // (and thus the worker threads) of the outer context, which outlives them
+  // (see context::mtime_prefetch).
+  //
+  // The prefetcher is MT-safe and is split into shards (by the path hash)
+  // to reduce contention.
+  //
+  class LIBBUILD2_SYMEXPORT mtime_prefetcher
+  {
+  public:
+    // Return true if prefetching is enabled.
+    //
+    bool
+    enabled () const {return threads_ != 0;}
+
+    // Queue the file unless it has already been queued. The path is expected
+    // to be absolute and normalized.
+    //
+    void
+    prefetch (const char* path, size_t size);
+
+    void
+    prefetch (const path& p) {prefetch (p.string ().c_str (), p.size ());}
+
+    // As above but with the path hash (std::hash<string>) precalculated.
+    //
+    void
+    prefetch (string path, size_t hash);
+
+    // Return the prefetched modification time or nullopt if the file was not
+    // queued or its modification time has not been loaded yet (in which case
+    // the caller is expected to load it itself).
+    //
+    optional<timestamp>
+    find (const path&) const;
+
+    // Forget the prefetched modification time, if any, for example, because
+    // the file has changed (see --watch). Note that the file won't be
+    // prefetched again.
+    //
+    void
+    invalidate (const path&);
+
+    mtime_prefetcher (size_t shards, size_t threads);
+    ~mtime_prefetcher ();
+
+    mtime_prefetcher (const mtime_prefetcher&) = delete;
+    mtime_prefetcher& operator= (const mtime_prefetcher&) = delete;
+
+  private:
+    void
+    worker ();
+
+    // Note that the pending entries have the timestamp_unknown value.
+    //
+    using map_type = std::unordered_map<string, timestamp::rep>;
+
+    struct shard
+    {
+      mutable shared_mutex mutex;
+      map_type map;
+    };
+
+    shard&
+    find_shard (size_t h) {return shards_[h % shard_count_];}
+
+    const shard&
+    find_shard (size_t h) const {return shards_[h % shard_count_];}
+
+  private:
+    unique_ptr<shard[]> shards_;
+    size_t shard_count_;
+
+    size_t threads_;
+
+    // Work queue. Note that we store pointers to the map entries which are
+    // stable.
+    //
+    struct item
+    {
+      shard*                s;
+      map_type::value_type* e;
+    };
+
+    mutex              mutex_;
+    condition_variable cv_;
+    vector<item>       queue_;
+    size_t             head_ = 0; // First unprocessed item in queue_.
+    bool               stop_ = false;
+    vector<thread>     workers_;
+  };
+}
+
+#endif // LIBBUILD2_MTIME_PREFETCH_HXX
@@ -14,6 +14,7 @@
 #include <libbuild2/module.hxx>
 #include <libbuild2/function.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/snapshot.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
@@ -381,6 +382,13 @@ namespace build2
     const buildfile* bf (enter && path_->path != nullptr
                          ? &enter_buildfile<buildfile> (*path_->path)
                          : nullptr);
+
+    if (build_snapshot* s = build_snapshot::instance)
+    {
+      if (path_->path != nullptr)
+        s->record (*path_->path);
+    }
+
     token t;
     type tt;
     next (t, tt);
@@ -3663,6 +3671,12 @@ namespace build2
                          ? &enter_buildfile<buildfile> (*in.path)
                          : nullptr);
 
+    if (build_snapshot* s = build_snapshot::instance)
+    {
+      if (in.path != nullptr)
+        s->record (*in.path);
+    }
+
     assert (path_ != nullptr);
 
     prev_path pp {path_, loc, allow_cycle, what, prev_path_};
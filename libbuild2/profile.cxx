@@ -0,0 +1,356 @@
+// file      : libbuild2/profile.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/profile.hxx>
+
+#ifndef _WIN32
+#  include <time.h> // clock_gettime()
+#else
+#  include <libbutl/win32-utility.hxx>
+#endif
+
+#include <cstring>   // strcmp()
+#include <algorithm> // sort()
+
+#include <libbuild2/target-type.hxx>
+
+using namespace std;
+
+namespace build2
+{
+  // Clocks.
+  //
+  static inline duration
+  wall_time ()
+  {
+    return chrono::duration_cast<duration> (
+      chrono::steady_clock::now ().time_since_epoch ());
+  }
+
+#ifndef _WIN32
+  static inline duration
+  cpu_time (clockid_t c)
+  {
+    timespec ts;
+    if (clock_gettime (c, &ts) != 0)
+      return duration::zero ();
+
+    return chrono::duration_cast<duration> (
+      chrono::seconds (ts.tv_sec) + chrono::nanoseconds (ts.tv_nsec));
+  }
+
+  static inline duration
+  thread_cpu_time ()
+  {
+    return cpu_time (CLOCK_THREAD_CPUTIME_ID);
+  }
+
+  static inline duration
+  process_cpu_time ()
+  {
+    return cpu_time (CLOCK_PROCESS_CPUTIME_ID);
+  }
+#else
+  static inline duration
+  cpu_time (const FILETIME& k, const FILETIME& u)
+  {
+    // Both are in 100ns units.
+    //
+    auto v = [] (const FILETIME& t)
+    {
+      return (static_cast<uint64_t> (t.dwHighDateTime) << 32) |
+        t.dwLowDateTime;
+    };
+
+    return chrono::duration_cast<duration> (
+      chrono::nanoseconds ((v (k) + v (u)) * 100));
+  }
+
+  static inline duration
+  thread_cpu_time ()
+  {
+    FILETIME c, e, k, u;
+    return GetThreadTimes (GetCurrentThread (), &c, &e, &k, &u)
+      ? cpu_time (k, u)
+      : duration::zero ();
+  }
+
+  static inline duration
+  process_cpu_time ()
+  {
+    FILETIME c, e, k, u;
+    return GetProcessTimes (GetCurrentProcess (), &c, &e, &k, &u)
+      ? cpu_time (k, u)
+      : duration::zero ();
+  }
+#endif
+
+  // Per-thread rule step table.
+  //
+  // To avoid allocating on lookup we use a transparent comparator with the
+  // lookup key referencing the rule name and the target type.
+  //
+  struct profile_key
+  {
+    profile::step step;
+    const string& rule;
+    const char*   type;
+  };
+
+  struct profile_compare
+  {
+    using is_transparent = void;
+
+    template <typename X, typename Y>
+    bool
+    operator() (const X& x, const Y& y) const
+    {
+      if (x.step != y.step)
+        return x.step < y.step;
+
+      if (int r = x.rule.compare (y.rule))
+        return r < 0;
+
+      return strcmp (c_str (x.type), c_str (y.type)) < 0;
+    }
+
+    static const char*
+    c_str (const string& s) {return s.c_str ();}
+
+    static const char*
+    c_str (const char* s) {return s;}
+  };
+
+  struct profile::thread_data
+  {
+    frame* top = nullptr;
+
+    // Note that only the key members participate in the ordering so we can
+    // update the times in place.
+    //
+    struct value
+    {
+      profile::step  step;
+      string         rule;
+      string         type;
+      mutable times  t;
+
+      value (profile::step s, string r, string tt)
+          : step (s), rule (move (r)), type (move (tt)) {}
+    };
+
+    set<value, profile_compare> table;
+  };
+
+  // Current thread's data for the profile instance with the specified id.
+  //
+  // Note that we cannot use the profile address since another instance could
+  // be allocated at the same address.
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  void* profile_thread_data = nullptr;
+
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  uint64_t profile_thread_id = 0;
+
+  static atomic<uint64_t> profile_next_id (1);
+
+  profile::
+  profile ()
+      : id_ (profile_next_id.fetch_add (1, memory_order_relaxed)),
+        phase_ (phase::load),
+        phase_wall_ (wall_time ()),
+        phase_cpu_ (process_cpu_time ())
+  {
+    phases_[static_cast<size_t> (phase_)].count = 1;
+  }
+
+  profile::
+  ~profile ()
+  {
+  }
+
+  profile::thread_data& profile::
+  data ()
+  {
+    if (profile_thread_id == id_)
+      return *static_cast<thread_data*> (profile_thread_data);
+
+    mlock l (mutex_);
+    threads_.push_back (unique_ptr<thread_data> (new thread_data));
+
+    profile_thread_data = threads_.back ().get ();
+    profile_thread_id = id_;
+
+    return *threads_.back ();
+  }
+
+  void profile::
+  switch_phase (phase p)
+  {
+    duration w (wall_time ());
+    duration c (process_cpu_time ());
+
+    mlock l (mutex_);
+
+    times& t (phases_[static_cast<size_t> (phase_)]);
+    t.wall += w - phase_wall_;
+    t.cpu  += c - phase_cpu_;
+
+    if (phase_ != p)
+    {
+      phase_ = p;
+      phases_[static_cast<size_t> (p)].count++;
+    }
+
+    phase_wall_ = w;
+    phase_cpu_ = c;
+  }
+
+  profile::phase profile::
+  current_phase () const
+  {
+    mlock l (mutex_);
+    return phase_;
+  }
+
+  void profile::
+  start (frame& f, step s, const string& r, const target_type& tt)
+  {
+    thread_data& d (data ());
+
+    f.prof_ = this;
+    f.prev_ = d.top;
+    f.step_ = s;
+    f.rule_ = &r;
+    f.type_ = &tt;
+    f.child_wall_ = duration::zero ();
+    f.child_cpu_ = duration::zero ();
+
+    d.top = &f;
+
+    // Query the clocks last to exclude our own overhead.
+    //
+    f.cpu_ = thread_cpu_time ();
+    f.wall_ = wall_time ();
+  }
+
+  void profile::
+  stop (frame& f)
+  {
+    duration w (wall_time () - f.wall_);
+    duration c (thread_cpu_time () - f.cpu_);
+
+    thread_data& d (data ());
+    assert (d.top == &f);
+
+    d.top = f.prev_;
+
+    if (frame* p = d.top)
+    {
+      p->child_wall_ += w;
+      p->child_cpu_ += c;
+    }
+
+    auto i (d.table.find (profile_key {f.step_, *f.rule_, f.type_->name}));
+
+    if (i == d.table.end ())
+      i = d.table.emplace (f.step_, *f.rule_, f.type_->name).first;
+
+    times& t (i->t);
+    t.wall += w - f.child_wall_;
+    t.cpu  += c - f.child_cpu_;
+    t.count++;
+  }
+
+  profile::times profile::
+  phase_times (phase p) const
+  {
+    mlock l (mutex_);
+
+    times r (phases_[static_cast<size_t> (p)]);
+
+    // Add the time spent in the current phase so far.
+    //
+    if (p == phase_)
+    {
+      r.wall += wall_time () - phase_wall_;
+      r.cpu  += process_cpu_time () - phase_cpu_;
+    }
+
+    return r;
+  }
+
+  vector<profile::entry> profile::
+  entries () const
+  {
+    set<thread_data::value, profile_compare> m;
+    {
+      mlock l (mutex_);
+
+      for (const unique_ptr<thread_data>& d: threads_)
+      {
+        for (const thread_data::value& v: d->table)
+        {
+          auto i (m.find (v));
+
+          if (i == m.end ())
+            i = m.emplace (v.step, v.rule, v.type).first;
+
+          i->t += v.t;
+        }
+      }
+    }
+
+    vector<entry> r;
+    r.reserve (m.size ());
+
+    for (const thread_data::value& v: m)
+      r.push_back (entry {v.step, v.rule, v.type, v.t});
+
+    sort (r.begin (), r.end (),
+          [] (const entry& x, const entry& y)
+          {
+            return x.time.wall > y.time.wall;
+          });
+
+    return r;
+  }
+
+  const char*
+  to_string (profile::phase p)
+  {
+    switch (p)
+    {
+    case profile::phase::bootstrap: return "bootstrap";
+    case profile::phase::load:      return "load";
+    case profile::phase::match:     return "match";
+    case profile::phase::execute:   return "execute";
+    }
+
+    return "";
+  }
+
+  const char*
+  to_string (profile::step s)
+  {
+    switch (s)
+    {
+    case profile::step::match:   return "match";
+    case profile::step::apply:   return "apply";
+    case profile::step::execute: return "execute";
+    }
+
+    return "";
+  }
+}
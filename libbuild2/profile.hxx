@@ -0,0 +1,211 @@
+// file      : libbuild2/profile.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_PROFILE_HXX
+#define LIBBUILD2_PROFILE_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Build time profile (see --stat).
+  //
+  // The profile accumulates the wall and CPU time spent in each build phase
+  // as well as in each rule step (match, apply, and execute) per rule name
+  // and target type. The same instance can be shared by multiple contexts,
+  // for example, by all the contexts in a meta-operation batch as well as
+  // the nested module and update-during-load contexts (see
+  // context::profile).
+  //
+  // The phase times are accumulated on each phase switch. The CPU time in
+  // this case is the process CPU time (that is, of all the threads) while
+  // in the phase. Note that the bootstrap "phase" is not a real run_phase
+  // and is switched into explicitly by the driver for the duration of the
+  // project bootstrap (which is part of the initial load).
+  //
+  // The rule step times are measured with the frame RAII helper below and
+  // the CPU time in this case is the calling thread's. Because steps can
+  // nest (for example, apply() matching prerequisites synchronously or a
+  // recipe executing prerequisites, including by way of the scheduler
+  // running queued tasks while waiting), the time of a nested step is
+  // excluded from that of its parent. In other words, the reported times
+  // are "self" rather than "total".
+  //
+  // The rule step times are accumulated in per-thread tables without any
+  // synchronization and are merged when the report is requested, which
+  // should only be done when the build is quiescent (for example, after
+  // scheduler shutdown).
+  //
+  class LIBBUILD2_SYMEXPORT profile
+  {
+  public:
+    enum class phase: uint8_t {bootstrap, load, match, execute};
+
+    static const size_t phase_count = 4;
+
+    enum class step: uint8_t {match, apply, execute};
+
+    struct times
+    {
+      duration wall  = duration::zero ();
+      duration cpu   = duration::zero ();
+      size_t   count = 0;
+
+      times&
+      operator+= (const times& x)
+      {
+        wall  += x.wall;
+        cpu   += x.cpu;
+        count += x.count;
+        return *this;
+      }
+    };
+
+    // Switch to the specified phase accumulating the time spent in the
+    // current phase. Calling this function for the current phase simply
+    // accumulates the time spent in it so far. The initial phase is load.
+    //
+    void
+    switch_phase (phase);
+
+    // Return the current phase.
+    //
+    phase
+    current_phase () const;
+
+    // Restore the current phase on destruction. If the profile is NULL, then
+    // the guard is a noop.
+    //
+    // This is used when building in a nested context (module, update during
+    // load) that shares the profile with the outer context. The nested
+    // context's phase switches leave the profile in its final phase (load)
+    // while the outer context is still in its own phase (for example, match
+    // if the build was triggered by an ad hoc C++ recipe).
+    //
+    class phase_guard
+    {
+    public:
+      explicit
+      phase_guard (profile* p)
+          : prof_ (p),
+            phase_ (p != nullptr ? p->current_phase () : phase::load) {}
+
+      ~phase_guard ()
+      {
+        if (prof_ != nullptr)
+          prof_->switch_phase (phase_);
+      }
+
+      phase_guard (const phase_guard&) = delete;
+      phase_guard& operator= (const phase_guard&) = delete;
+
+    private:
+      profile* prof_;
+      phase    phase_;
+    };
+
+    // Measure a rule step. Note that rule is the rule name as registered
+    // (or the special "<recipe>" name for a directly-assigned recipe). If
+    // the profile is NULL, then the frame is a noop.
+    //
+    class frame
+    {
+    public:
+      frame (profile* p, step s, const string& r, const target_type& tt)
+      {
+        if (p != nullptr)
+          p->start (*this, s, r, tt);
+      }
+
+      ~frame ()
+      {
+        if (prof_ != nullptr)
+          prof_->stop (*this);
+      }
+
+      frame (const frame&) = delete;
+      frame& operator= (const frame&) = delete;
+
+    private:
+      friend class profile;
+
+      profile* prof_ = nullptr;
+      frame* prev_;
+
+      step step_;
+      const string* rule_;
+      const target_type* type_;
+
+      duration wall_;        // Start time.
+      duration cpu_;         // Start time.
+      duration child_wall_;  // Time spent in nested frames.
+      duration child_cpu_;
+    };
+
+    // Report.
+    //
+    // The rule step entries are sorted in the descending wall time order.
+    //
+    struct entry
+    {
+      profile::step step;
+      string        rule;
+      string        type;  // Target type name.
+      times         time;
+    };
+
+    times
+    phase_times (phase) const;
+
+    vector<entry>
+    entries () const;
+
+  public:
+    profile ();
+    ~profile ();
+
+    profile (const profile&) = delete;
+    profile& operator= (const profile&) = delete;
+
+  private:
+    void
+    start (frame&, step, const string&, const target_type&);
+
+    void
+    stop (frame&);
+
+    struct thread_data;
+
+    thread_data&
+    data ();
+
+  private:
+    uint64_t id_; // Unique instance id (see data()).
+
+    mutable mutex mutex_;
+
+    // Phase accounting (protected by mutex_).
+    //
+    phase    phase_;
+    duration phase_wall_;  // Start time of the current phase.
+    duration phase_cpu_;
+
+    array<times, phase_count> phases_;
+
+    // Per-thread rule step tables (the vector is protected by mutex_).
+    //
+    vector<unique_ptr<thread_data>> threads_;
+  };
+
+  LIBBUILD2_SYMEXPORT const char*
+  to_string (profile::phase);
+
+  LIBBUILD2_SYMEXPORT const char*
+  to_string (profile::step);
+}
+
+#endif // LIBBUILD2_PROFILE_HXX
@@ -0,0 +1,109 @@
+// file      : libbuild2/regex-cache.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/regex-cache.hxx>
+
+#include <list>
+#include <unordered_map>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  // The maximum number of cached regexes. Note that a typical build uses
+  // a few dozen distinct patterns, so this is generous.
+  //
+  static const size_t regex_cache_capacity = 512;
+
+  using regex_key = pair<string, regex::flag_type>;
+
+  struct regex_key_hash
+  {
+    size_t
+    operator() (const regex_key& k) const
+    {
+      return combine_hash (hash<string> () (k.first),
+                           static_cast<size_t> (k.second));
+    }
+  };
+
+  // The entries are kept in the most recently used first order.
+  //
+  using regex_list = list<pair<regex_key, shared_ptr<const compiled_regex>>>;
+
+  static mutex regex_cache_mutex;
+  static regex_list regex_cache_list;
+  static unordered_map<regex_key,
+                       regex_list::iterator,
+                       regex_key_hash> regex_cache_map;
+
+  static atomic<size_t> regex_cache_hits (0);
+  static atomic<size_t> regex_cache_misses (0);
+
+  shared_ptr<const compiled_regex>
+  cached_regex (const string& s, regex::flag_type f)
+  {
+    regex_key k (s, f);
+
+    {
+      mlock l (regex_cache_mutex);
+
+      auto i (regex_cache_map.find (k));
+      if (i != regex_cache_map.end ())
+      {
+        regex_cache_list.splice (regex_cache_list.begin (),
+                                 regex_cache_list,
+                                 i->second);
+
+        regex_cache_hits.fetch_add (1, memory_order_relaxed);
+        return i->second->second;
+      }
+    }
+
+    regex_cache_misses.fetch_add (1, memory_order_relaxed);
+
+    // Compile outside the lock. If another thread beats us to it, then we
+    // just drop ours.
+    //
+    shared_ptr<compiled_regex> r (
+      make_shared<compiled_regex> (compiled_regex {regex (s, f), nullopt}));
+
+    if ((f & ~regex::icase) == regex::ECMAScript)
+      r->linear = linear_regex::compile (s, (f & regex::icase) != 0);
+
+    mlock l (regex_cache_mutex);
+
+    if (regex_cache_map.find (k) == regex_cache_map.end ())
+    {
+      regex_cache_list.emplace_front (k, r);
+
+      try
+      {
+        regex_cache_map.emplace (move (k), regex_cache_list.begin ());
+      }
+      catch (...)
+      {
+        regex_cache_list.pop_front ();
+        throw;
+      }
+
+      if (regex_cache_list.size () > regex_cache_capacity)
+      {
+        regex_cache_map.erase (regex_cache_list.back ().first);
+        regex_cache_list.pop_back ();
+      }
+    }
+
+    return r;
+  }
+
+  regex_cache_stat
+  regex_cache_statistics ()
+  {
+    regex_cache_stat r;
+    r.hits = regex_cache_hits.load (memory_order_relaxed);
+    r.misses = regex_cache_misses.load (memory_order_relaxed);
+    return r;
+  }
+}
@@ -0,0 +1,56 @@
+// file      : libbuild2/regex-cache.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_REGEX_CACHE_HXX
+#define LIBBUILD2_REGEX_CACHE_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/linear-regex.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Cache of compiled regular expressions.
+  //
+  // Constructing std::regex is expensive and buildfiles routinely call the
+  // $regex.*() functions with the same pattern in a loop. So these functions
+  // obtain their regexes from this cache, which is keyed by the pattern and
+  // the flags and holds a bounded number of the most recently used entries.
+  //
+  // The cache is MT-safe and process-wide: a compiled regex does not depend
+  // on the build context.
+  //
+  // Besides std::regex, the entry contains the linear-time equivalent if the
+  // pattern is supported by linear_regex (see linear-regex.hxx for details)
+  // and the flags are ECMAScript, optionally with icase. Note that
+  // linear_regex::exact_submatches() should be checked before relying on its
+  // submatches.
+  //
+  struct compiled_regex
+  {
+    regex                  re;
+    optional<linear_regex> linear;
+  };
+
+  // Throw regex_error if the pattern is invalid (such patterns are not
+  // cached).
+  //
+  LIBBUILD2_SYMEXPORT shared_ptr<const compiled_regex>
+  cached_regex (const string& pattern, regex::flag_type);
+
+  // Cache statistics (see --stat).
+  //
+  struct regex_cache_stat
+  {
+    size_t hits   = 0;
+    size_t misses = 0;
+  };
+
+  LIBBUILD2_SYMEXPORT regex_cache_stat
+  regex_cache_statistics ();
+}
+
+#endif // LIBBUILD2_REGEX_CACHE_HXX
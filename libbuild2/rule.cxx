@@ -9,6 +9,7 @@
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
+#include <libbuild2/mtime-prefetch.hxx>
 
 using namespace std;
 using namespace butl;
@@ -173,7 +174,12 @@ namespace build2
           }
         }
 
-        ts = mtime (*p);
+        // Use the prefetched modification time if available (see
+        // mtime_prefetcher for details).
+        //
+        optional<timestamp> pts (t.ctx.mtime_prefetch->find (*p));
+
+        ts = pts ? *pts : mtime (*p);
         pt->mtime (ts);
 
         if (ts != timestamp_nonexistent)
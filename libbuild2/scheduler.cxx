@@ -33,6 +33,8 @@
 
 #include <libbutl/filesystem.hxx> // try_rmfile()
 
+#include <libbuild2/timeline.hxx>
+
 using namespace std;
 using namespace butl;
 
@@ -78,14 +80,28 @@ namespace build2
       {
         size_t tc;
 
-        for (lock ql (tq->mutex); !tq->shutdown && !empty_back (*tq); )
+        if (tq->stealing)
         {
-          pop_back (*tq, ql);
-
-          if (wq == work_one)
+          while (!tq->shutdown && !empty_back_ws (*tq))
+          {
+            if (pop_back_ws (*tq) && wq == work_one)
+            {
+              if ((tc = task_count.load (memory_order_acquire)) <= start_count)
+                return tc;
+            }
+          }
+        }
+        else
+        {
+          for (lock ql (tq->mutex); !tq->shutdown && !empty_back (*tq); )
           {
-            if ((tc = task_count.load (memory_order_acquire)) <= start_count)
-              return tc;
+            pop_back (*tq, ql);
+
+            if (wq == work_one)
+            {
+              if ((tc = task_count.load (memory_order_acquire)) <= start_count)
+                return tc;
+            }
           }
         }
 
@@ -298,6 +314,8 @@ namespace build2
   {
     assert (max_active_ != 1); // Suspend during serial execution?
 
+    timeline::span ts ("suspend", "suspend");
+
     wait_slot& s (
       wait_queue_[
         hash<const atomic_count*> () (&task_count) % wait_queue_size_]);
@@ -459,7 +477,8 @@ namespace build2
            size_t init_active,
            size_t max_threads,
            size_t queue_depth,
-           size_t orig_max_active)
+           size_t orig_max_active,
+           bool work_stealing)
   {
     timestamp startup_begin (system_clock::now ());
 
@@ -494,6 +513,7 @@ namespace build2
     max_active_ = max_active;
     orig_max_active_ = orig_max_active;
     max_threads_ = max_threads;
+    work_stealing_ = work_stealing;
 
     // This value should be proportional to the amount of hardware concurrency
     // we have (no use queing things up if helpers cannot keep up). Note that
@@ -710,7 +730,6 @@ namespace build2
       for (task_queue& tq: task_queues_)
       {
         lock ql (tq.mutex);
-        r.task_queue_full += tq.stat_full;
         tq.shutdown = true;
       }
 
@@ -759,6 +778,16 @@ namespace build2
       if (jobserver_thread_.joinable ()) jobserver_thread_.join ();
       if (deadlock_thread_.joinable ())  deadlock_thread_.join ();
 
+      // Collect the task queue statistics. Note that in the work-stealing
+      // mode the counters are not protected by the queue mutex so we have to
+      // wait until all the helpers are gone.
+      //
+      for (task_queue& tq: task_queues_)
+      {
+        r.task_queue_full   += tq.stat_full;
+        r.task_queue_stolen += tq.stat_stolen.load (memory_order_relaxed);
+      }
+
       // Free the memory.
       //
       wait_queue_.reset ();
@@ -832,12 +861,24 @@ namespace build2
     phase_.emplace_back (task_queues_.size ());
     vector<task_queue_data>& ph (phase_.back ());
 
+    // In the work-stealing mode there could be helpers in the process of
+    // stealing from the queue so we hide it from them for the duration of
+    // the swap (they cannot be executing any tasks of the old phase past
+    // that point for the reasons described above).
+    //
     auto j (ph.begin ());
     for (auto i (task_queues_.begin ()); i != task_queues_.end (); ++i, ++j)
     {
       task_queue& tq (*i);
       lock ql (tq.mutex);
 
+      if (tq.stealing)
+      {
+        tq.hide ();
+        tq.size = (tq.bottom.load (memory_order_relaxed) -
+                   tq.top.load (memory_order_relaxed));
+      }
+
       if (tq.size != 0)
       {
         // Note that task_queue::data will be allocated lazily (there is a
@@ -846,6 +887,9 @@ namespace build2
         queued_task_count_.fetch_sub (tq.size, memory_order_release);
         tq.swap (*j);
       }
+
+      if (tq.stealing)
+        tq.unhide ();
     }
 
     assert (queued_task_count_.load (memory_order_consume) == 0);
@@ -891,8 +935,15 @@ namespace build2
       {
         task_queue& tq (*i);
         lock ql (tq.mutex);
+
+        if (tq.stealing)
+          tq.hide ();
+
         tq.swap (*j);
         queued_task_count_.fetch_add (tq.size, memory_order_release);
+
+        if (tq.stealing)
+          tq.unhide ();
       }
     }
 
@@ -1196,8 +1247,15 @@ namespace build2
           {
             task_queue& tq (*it);
 
-            for (lock ql (tq.mutex); !tq.shutdown && !s.empty_front (tq); )
-              s.pop_front (tq, ql);
+            if (tq.stealing)
+            {
+              while (!tq.shutdown && s.steal (tq)) ;
+            }
+            else
+            {
+              for (lock ql (tq.mutex); !tq.shutdown && !s.empty_front (tq); )
+                s.pop_front (tq, ql);
+            }
 
             if (++i == n)
               break;
@@ -1248,7 +1306,7 @@ namespace build2
     task_queue* tq;
     {
       lock l (mutex_);
-      task_queues_.emplace_back (task_queue_depth_);
+      task_queues_.emplace_back (task_queue_depth_, work_stealing_);
       tq = &task_queues_.back ();
       tq->shutdown = shutdown_;
     }
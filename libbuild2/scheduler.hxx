@@ -335,6 +335,10 @@ namespace build2
     // If the maximum threads or task queue depth arguments are unspecified,
     // then appropriate defaults are used.
     //
+    // If work_stealing is true, then use the lock-free work-stealing task
+    // queues instead of the mutex-protected ones (see the task queue
+    // description below for details).
+    //
     // Passing non-zero orig_max_active (normally the real max active) allows
     // starting up a pre-tuned scheduler. In particular, starting a pre-tuned
     // to serial scheduler is relatively cheap since starting of the auxiliary
@@ -347,14 +351,16 @@ namespace build2
                size_t init_active = 1,
                size_t max_threads = 0,
                size_t queue_depth = 0,
-               size_t orig_max_active = 0)
+               size_t orig_max_active = 0,
+               bool work_stealing = false)
     {
       startup (max_active,
                jobserver,
                init_active,
                max_threads,
                queue_depth,
-               orig_max_active);
+               orig_max_active,
+               work_stealing);
     }
 
     // Start the scheduler. Throw system_error on failure.
@@ -365,7 +371,8 @@ namespace build2
              size_t init_active = 1,
              size_t max_threads = 0,
              size_t queue_depth = 0,
-             size_t orig_max_active = 0);
+             size_t orig_max_active = 0,
+             bool work_stealing = false);
 
     // Return true if the scheduler was started up.
     //
@@ -378,6 +385,9 @@ namespace build2
     bool
     jobserver () const {return jobserver_ != nullptr;}
 
+    bool
+    work_stealing () const {return work_stealing_;}
+
     // Tune a started up scheduler.
     //
     // Currently one cannot increase the number of (initial) max_active, only
@@ -458,6 +468,7 @@ namespace build2
       size_t task_queue_depth      = 0; // # of entries in a queue (capacity).
       size_t task_queue_full       = 0; // # of times task queue was full.
       size_t task_queue_remain     = 0; // # of tasks remaining in queue.
+      size_t task_queue_stolen     = 0; // # of tasks taken by helpers.
 
       size_t wait_queue_slots      = 0; // # of wait slots (buckets).
       size_t wait_queue_collisions = 0; // # of times slot had been occupied.
@@ -596,6 +607,8 @@ namespace build2
 
     // Task encapsulation.
     //
+    struct task_data;
+
     template <typename F, typename... A>
     struct task_type
     {
@@ -617,7 +630,7 @@ namespace build2
 
     template <typename F, typename... A>
     static void
-    task_thunk (scheduler&, lock&, void*);
+    task_thunk (scheduler&, lock*, task_data&, atomic_count*);
 
     template <typename T>
     static std::decay_t<T>
@@ -647,6 +660,8 @@ namespace build2
     size_t max_active_  = 0; // Maximum number of active threads.
     size_t max_threads_ = 0; // Maximum number of total threads.
 
+    bool work_stealing_ = false; // Use work-stealing task queues.
+
     size_t helpers_     = 0; // Number of helper threads created so far.
 
     // Every thread that we manage (except for the special ones like the
@@ -755,6 +770,8 @@ namespace build2
 
     // For now we only support trivially-destructible tasks.
     //
+    // The busy flag is only used by the work-stealing queues (see below).
+    //
     struct task_data
     {
       static const size_t data_size = (sizeof (void*) == 4
@@ -762,7 +779,8 @@ namespace build2
                                        : sizeof (void*) * 8);
 
       alignas (std::max_align_t) unsigned char data[data_size];
-      void (*thunk) (scheduler&, lock&, void*);
+      void (*thunk) (scheduler&, lock*, task_data&, atomic_count*);
+      std::atomic<bool> busy {false};
     };
 
     // We have two requirements: Firstly, we want to keep the master thread
@@ -810,25 +828,115 @@ namespace build2
       unique_ptr<task_data[]> data;
     };
 
+    // Alternatively, the queue can operate in the lock-free work-stealing
+    // mode (see startup()), which is a bounded variant of the Chase-Lev
+    // deque. In this mode the owning thread pushes and pops at the back
+    // (bottom) without taking any locks (and only synchronizing with helpers
+    // when racing for the last task) while helpers steal from the front
+    // (top) with a single CAS.
+    //
+    // Unlike in the circular version, top and bottom are monotonically
+    // increasing indexes (with the actual slot being index % depth). This
+    // allows us to represent the mark as a plain index (below which the
+    // owner does not pop) that is only ever accessed by the owning thread:
+    // disabling the mark is setting it to the current bottom and there is no
+    // need to adjust it when the helpers take tasks past it.
+    //
+    // A task is too large to be read speculatively (which is what the
+    // original algorithm does before claiming the element). So a slot is
+    // first claimed (by CAS on top or, for the owner, by moving bottom) and
+    // only then is the task data moved out. To make sure the owner doesn't
+    // reuse a slot that has been claimed but not yet moved out, each slot has
+    // the busy flag which is set by the owner on push and cleared by whoever
+    // moves the task out. The owner treats a still-busy slot as a full queue.
+    //
+    // The only cases where the queue is accessed by other than the owning
+    // and helper threads are the sub-phase switches, which replace the queue
+    // state while no tasks are being pushed or popped by the owner. There we
+    // hide the queue from new helpers and wait for the ones that are in the
+    // process of stealing (see hide()). Note that a helper remains in this
+    // process until it has moved the task out of the slot (and accounted for
+    // it in the queued task count) since the slot array can be swapped out
+    // (and freed) by the sub-phase switch.
+    //
+    // In this mode the head and tail members of task_queue_data are only
+    // used to store the top and bottom values of a queue that is shadowed by
+    // a sub-phase.
+    //
     struct task_queue: task_queue_data
     {
       build2::mutex mutex;
-      bool shutdown = false;
+      std::atomic<bool> shutdown {false};
 
-      size_t stat_full = 0; // Number of times push() returned NULL.
+      size_t stat_full = 0;         // Number of times push() returned NULL.
+      atomic_count stat_stolen {0}; // Number of tasks taken by helpers.
 
-      task_queue (size_t depth) {data.reset (new task_data[depth]);}
+      // Work-stealing mode.
+      //
+      const bool stealing;
+
+      atomic_count top    {0}; // Index of the first task (stolen next).
+      atomic_count bottom {0}; // Index past the last task (pushed next).
+
+      atomic_count      thieves {0};     // Number of helpers stealing.
+      std::atomic<bool> hidden  {false}; // Don't steal (sub-phase switch).
+
+      task_queue (size_t depth, bool ws)
+          : stealing (ws)
+      {
+        data.reset (new task_data[depth]);
+      }
 
       void
       swap (task_queue_data& d)
       {
         using std::swap;
-        swap (head, d.head);
+
+        if (!stealing)
+        {
+          swap (head, d.head);
+          swap (tail, d.tail);
+          swap (size, d.size);
+        }
+        else
+        {
+          size_t t (top.load (memory_order_relaxed));
+          size_t b (bottom.load (memory_order_relaxed));
+
+          top.store (d.head, memory_order_relaxed);
+          bottom.store (d.tail, memory_order_relaxed);
+
+          size = d.tail - d.head;
+
+          d.head = t;
+          d.tail = b;
+          d.size = b - t;
+        }
+
         swap (mark, d.mark);
-        swap (tail, d.tail);
-        swap (size, d.size);
         swap (data, d.data);
       }
+
+      // Hide the work-stealing queue from helpers and wait for those that
+      // are already in the process of stealing to finish claiming and moving
+      // out their tasks. Note that the hidden flag and the thieves count form
+      // a Dekker-style handshake and so must use the sequentially-consistent
+      // ordering (see steal()).
+      //
+      void
+      hide ()
+      {
+        hidden.store (true, memory_order_seq_cst);
+
+        while (thieves.load (memory_order_seq_cst) != 0)
+          this_thread::yield ();
+      }
+
+      void
+      unhide ()
+      {
+        hidden.store (false, memory_order_release);
+      }
     };
 
     // Task queue API. Expects the queue mutex to be locked.
@@ -881,7 +989,9 @@ namespace build2
       if (--s == 0 || a)
         m = h; // Reset or adjust the mark.
 
-      execute (ql, td);
+      tq.stat_stolen.fetch_add (1, memory_order_relaxed);
+
+      execute (&ql, td);
     }
 
     bool
@@ -912,7 +1022,7 @@ namespace build2
       t = s != 1 ? (t != 0 ? t - 1 : task_queue_depth_ - 1) : t;
       --s;
 
-      execute (ql, td);
+      execute (&ql, td);
 
       // Restore the old mark (which we might have to adjust).
       //
@@ -939,15 +1049,179 @@ namespace build2
         m = om;
     }
 
+    // Work-stealing task queue API (see above). Expects the queue data to
+    // be allocated before calling push_ws().
+    //
+
+    // Return a pointer to the task data to be filled or NULL if the queue is
+    // full. Once filled, the task should be published with commit_ws().
+    //
+    task_data*
+    push_ws (task_queue& tq)
+    {
+      size_t b (tq.bottom.load (memory_order_relaxed));
+      size_t t (tq.top.load (memory_order_acquire));
+
+      if (b - t < task_queue_depth_)
+      {
+        task_data& td (tq.data[b % task_queue_depth_]);
+
+        // The previous occupant of this slot could have been claimed by a
+        // helper but not yet moved out.
+        //
+        if (!td.busy.load (memory_order_acquire))
+          return &td;
+      }
+
+      return nullptr;
+    }
+
+    void
+    commit_ws (task_queue& tq, task_data& td)
+    {
+      td.busy.store (true, memory_order_relaxed);
+
+      // Increment the queued count before the task becomes visible to the
+      // helpers not to have it go (temporarily) negative.
+      //
+      queued_task_count_.fetch_add (1, memory_order_release);
+
+      tq.bottom.store (tq.bottom.load (memory_order_relaxed) + 1,
+                       memory_order_release);
+    }
+
+    bool
+    empty_back_ws (task_queue& tq) const
+    {
+      size_t b (tq.bottom.load (memory_order_relaxed));
+
+      size_t t (tq.top.load (memory_order_acquire));
+
+      return b == tq.mark || static_cast<std::ptrdiff_t> (b - t) <= 0;
+    }
+
+    // Pop and execute the task from the back returning false if there was
+    // none (which can happen even if empty_back_ws() returned false since
+    // the helpers could have taken the remaining tasks).
+    //
+    bool
+    pop_back_ws (task_queue& tq)
+    {
+      size_t b (tq.bottom.load (memory_order_relaxed) - 1);
+      tq.bottom.store (b, memory_order_relaxed);
+
+      // Make sure our bottom update is visible to the helpers before we
+      // examine top (see steal() for the other half).
+      //
+      std::atomic_thread_fence (memory_order_seq_cst);
+
+      size_t t (tq.top.load (memory_order_relaxed));
+
+      if (static_cast<std::ptrdiff_t> (b - t) < 0) // Empty.
+      {
+        tq.bottom.store (b + 1, memory_order_relaxed);
+        return false;
+      }
+
+      // Save the old queue mark and disable it in case the task we are about
+      // to run adds sub-tasks (see pop_back() for details).
+      //
+      size_t om (tq.mark);
+
+      if (b == t)
+      {
+        // Last task: race with the helpers for it.
+        //
+        bool r (tq.top.compare_exchange_strong (t, t + 1,
+                                                memory_order_seq_cst,
+                                                memory_order_relaxed));
+        tq.bottom.store (b + 1, memory_order_relaxed);
+
+        if (!r)
+          return false;
+
+        tq.mark = b + 1;
+      }
+      else
+        tq.mark = b;
+
+      execute (nullptr, tq.data[b % task_queue_depth_]);
+
+      // Restore the old mark. Since the indexes are monotonic, there is
+      // nothing to adjust: if the task was at the mark, then bottom is now
+      // back at the mark and if helpers went past the mark, then top is past
+      // it.
+      //
+      tq.mark = om;
+      return true;
+    }
+
+    // Steal and execute the task from the front returning false if there was
+    // none (or the queue is hidden).
+    //
+    bool
+    steal (task_queue& tq)
+    {
+      // Register ourselves as a thief so that hide() can wait us out. Note
+      // that this and the hidden flag check must be sequentially-consistent
+      // (see task_queue::hide()).
+      //
+      tq.thieves.fetch_add (1, memory_order_seq_cst);
+
+      task_data* td (nullptr);
+      while (!tq.hidden.load (memory_order_seq_cst))
+      {
+        size_t t (tq.top.load (memory_order_acquire));
+        std::atomic_thread_fence (memory_order_seq_cst);
+        size_t b (tq.bottom.load (memory_order_acquire));
+
+        if (static_cast<std::ptrdiff_t> (b - t) <= 0)
+          break;
+
+        // If we lose the race (to the owner or another helper), then try
+        // again.
+        //
+        if (tq.top.compare_exchange_strong (t, t + 1,
+                                            memory_order_seq_cst,
+                                            memory_order_relaxed))
+        {
+          td = &tq.data[t % task_queue_depth_];
+          break;
+        }
+      }
+
+      if (td == nullptr)
+      {
+        tq.thieves.fetch_sub (1, memory_order_release);
+        return false;
+      }
+
+      tq.stat_stolen.fetch_add (1, memory_order_relaxed);
+
+      // Note that we remain registered as a thief until the task data has
+      // been moved out of the slot (see task_thunk()). Otherwise, a sub-phase
+      // switch could swap out (and free) the slot array from under us and
+      // observe the claimed task as still queued.
+      //
+      execute (nullptr, *td, &tq.thieves);
+      return true;
+    }
+
+    // Execute the task. If the queue lock is not NULL, then it is released
+    // while executing the task and re-acquired afterwards. If the thieves
+    // count is not NULL, then it is decremented once the task data has been
+    // moved out of the (stolen) slot.
+    //
     void
-    execute (lock& ql, task_data& td)
+    execute (lock* ql, task_data& td, atomic_count* thieves = nullptr)
     {
       queued_task_count_.fetch_sub (1, std::memory_order_release);
 
-      // The thunk moves the task data to its stack, releases the lock,
-      // and continues to execute the task.
+      // The thunk moves the task data to its stack, releases the lock (or
+      // the slot in the work-stealing mode), and continues to execute the
+      // task.
       //
-      td.thunk (*this, ql, &td.data);
+      td.thunk (*this, ql, td, thieves);
 
       // See if we need to call the monitor (see also the serial version
       // in async()).
@@ -984,7 +1258,8 @@ namespace build2
         }
       }
 
-      ql.lock ();
+      if (ql != nullptr)
+        ql->lock ();
     }
 
     // Each thread has its own queue which are stored in this list.
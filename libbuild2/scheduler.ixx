@@ -64,6 +64,17 @@ namespace build2
   {
     if (tq_ != nullptr)
     {
+      // In the work-stealing mode the mark is only accessed by the owning
+      // thread and disabling it is setting it to the current bottom (see the
+      // task queue description for details).
+      //
+      if (tq_->stealing)
+      {
+        om_ = tq_->mark;
+        tq_->mark = tq_->bottom.load (memory_order_relaxed);
+        return;
+      }
+
       lock ql (tq_->mutex);
 
       if (tq_->mark != s.task_queue_depth_)
@@ -81,6 +92,12 @@ namespace build2
   {
     if (tq_ != nullptr)
     {
+      if (tq_->stealing)
+      {
+        tq_->mark = om_;
+        return;
+      }
+
       lock ql (tq_->mutex);
       tq_->mark = tq_->size == 0 ? tq_->tail : om_;
     }
@@ -18,14 +18,16 @@ using namespace std;
 namespace build2
 {
   // Usage argv[0] [-v <volume>] [-d <difficulty>] [-c <concurrency>]
-  //               [-q <queue-depth>]
+  //               [-q <queue-depth>] [-w]
   //
   // -v  task tree volume (affects both depth and width), for example 100
   // -d  computational difficulty of each task, for example 10
   // -c  max active threads, if unspecified or 0, then hardware concurrency
   // -q  task queue depth, if unspecified or 0, then appropriate default used
+  // -w  use work-stealing task queues
   //
-  // Specifying any option also turns on the verbose mode.
+  // Specifying any option also turns on the verbose mode. If no options are
+  // specified, then test both task queue implementations.
   //
   // Notes on testing:
   //
@@ -65,6 +67,7 @@ namespace build2
 
     size_t max_active (0);
     size_t queue_depth (0);
+    bool work_stealing (false);
 
     for (int i (1); i != argc; ++i)
     {
@@ -78,6 +81,8 @@ namespace build2
         max_active = stoul (argv[++i]);
       else if (a == "-q")
         queue_depth = stoul (argv[++i]);
+      else if (a == "-w")
+        work_stealing = true;
       else
         assert (false);
 
@@ -87,77 +92,89 @@ namespace build2
     if (max_active == 0)
       max_active = scheduler::hardware_concurrency ();
 
-    scheduler s (max_active, nullptr, 1, 0, queue_depth);
-
-    // Find # prime counts of primes in [i, d*i*i) ranges for i in (0, n].
-    //
-    auto outer = [difficulty, &s] (size_t n, vector<uint64_t>& o, uint64_t& r)
+    auto run = [volume, difficulty, max_active, queue_depth, verb] (bool ws)
     {
+      scheduler s (max_active, nullptr, 1, 0, queue_depth, 0, ws);
+
+      // Find # prime counts of primes in [i, d*i*i) ranges for i in (0, n].
+      //
+      auto outer = [difficulty, &s] (size_t n,
+                                     vector<uint64_t>& o,
+                                     uint64_t& r)
+      {
+        scheduler::atomic_count task_count (0);
+
+        for (size_t i (1); i <= n; ++i)
+        {
+          o[i - 1] = 0;
+          s.async (task_count,
+                   inner,
+                   i,
+                   i * i * difficulty,
+                   ref (o[i - 1]));
+        }
+
+        s.wait (task_count);
+        assert (task_count == 0);
+
+        for (uint64_t v: o)
+          r += prime (v) ? 1 : 0;
+      };
+
+      vector<uint64_t> r (volume, 0);
+      vector<vector<uint64_t>> o (volume, vector<uint64_t> ());
+
       scheduler::atomic_count task_count (0);
 
-      for (size_t i (1); i <= n; ++i)
+      for (size_t i (0); i != volume; ++i)
       {
-        o[i - 1] = 0;
+        o[i].resize (i);
         s.async (task_count,
-                 inner,
+                 outer,
                  i,
-                 i * i * difficulty,
-                 ref (o[i - 1]));
+                 ref (o[i]),
+                 ref (r[i]));
       }
 
       s.wait (task_count);
       assert (task_count == 0);
 
-      for (uint64_t v: o)
-        r += prime (v) ? 1 : 0;
-    };
-
-    vector<uint64_t> r (volume, 0);
-    vector<vector<uint64_t>> o (volume, vector<uint64_t> ());
-
-    scheduler::atomic_count task_count (0);
-
-    for (size_t i (0); i != volume; ++i)
-    {
-      o[i].resize (i);
-      s.async (task_count,
-               outer,
-               i,
-               ref (o[i]),
-               ref (r[i]));
-    }
+      uint64_t n (0);
+      for (uint64_t v: r)
+        n += v;
 
-    s.wait (task_count);
-    assert (task_count == 0);
+      if (volume == 100 && difficulty == 10)
+        assert (n == 580);
 
-    uint64_t n (0);
-    for (uint64_t v: r)
-      n += v;
+      scheduler::stat st (s.shutdown ());
+      s.leave (); // We may join another scheduler session.
 
-    if (volume == 100 && difficulty == 10)
-      assert (n == 580);
+      if (verb)
+      {
+        cerr << "result                 " << n                       << endl
+             << endl;
+
+        cerr << "thread_max_active       " << st.thread_max_active     << endl
+             << "thread_max_total        " << st.thread_max_total      << endl
+             << "thread_helpers          " << st.thread_helpers        << endl
+             << "thread_max_waiting      " << st.thread_max_waiting    << endl
+             << endl
+             << "task_queue_depth        " << st.task_queue_depth      << endl
+             << "task_queue_full         " << st.task_queue_full       << endl
+             << "task_queue_stolen       " << st.task_queue_stolen     << endl
+             << endl
+             << "wait_queue_slots        " << st.wait_queue_slots      << endl
+             << "wait_queue_collisions   " << st.wait_queue_collisions << endl
+             << endl
+             << "scheduler_startup_time  " << st.startup_time          << endl
+             << "scheduler_shutdown_time " << st.shutdown_time         << endl;
+      }
+    };
 
-    scheduler::stat st (s.shutdown ());
+    run (work_stealing);
 
-    if (verb)
-    {
-      cerr << "result                 " << n                       << endl
-           << endl;
-
-      cerr << "thread_max_active       " << st.thread_max_active     << endl
-           << "thread_max_total        " << st.thread_max_total      << endl
-           << "thread_helpers          " << st.thread_helpers        << endl
-           << "thread_max_waiting      " << st.thread_max_waiting    << endl
-           << endl
-           << "task_queue_depth        " << st.task_queue_depth      << endl
-           << "task_queue_full         " << st.task_queue_full       << endl
-           << endl
-           << "wait_queue_slots        " << st.wait_queue_slots      << endl
-           << "wait_queue_collisions   " << st.wait_queue_collisions << endl
-           << endl
-           << "scheduler_startup_time  " << st.startup_time          << endl
-           << "scheduler_shutdown_time " << st.shutdown_time         << endl;
-    }
+    if (!verb)
+      run (true);
 
     return 0;
   }
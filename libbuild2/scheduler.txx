@@ -49,6 +49,52 @@ namespace build2
     if (tq == nullptr)
       tq = &create_queue ();
 
+    if (tq->stealing)
+    {
+      // Lock-free version of the below logic (see the task queue description
+      // for details).
+      //
+      if (tq->shutdown)
+        throw_generic_error (ECANCELED);
+
+      if (tq->data == nullptr)
+        tq->data.reset (new task_data[task_queue_depth_]);
+
+      if (task_data* td = push_ws (*tq))
+      {
+        new (&td->data) task {
+          &task_count,
+          start_count,
+          typename task::args_type (decay_copy (forward<A> (a))...),
+          decay_copy (forward<F> (f))};
+
+        td->thunk = &task_thunk<F, A...>;
+
+        // Increment the task count before publishing the task to prevent it
+        // from decrementing the count before we had a chance to increment
+        // it.
+        //
+        task_count.fetch_add (1, std::memory_order_release);
+
+        commit_ws (*tq, *td);
+      }
+      else
+      {
+        tq->stat_full++;
+
+        // Disable the mark for the duration of the synchronous execution
+        // (see below).
+        //
+        size_t om (tq->mark);
+        tq->mark = tq->bottom.load (memory_order_relaxed);
+
+        forward<F> (f) (forward<A> (a)...); // Should not throw.
+
+        tq->mark = om;
+        return false;
+      }
+    }
+    else
     {
       lock ql (tq->mutex);
 
@@ -123,14 +169,26 @@ namespace build2
 
   template <typename F, typename... A>
   void scheduler::
-  task_thunk (scheduler& s, lock& ql, void* td)
+  task_thunk (scheduler& s, lock* ql, task_data& td, atomic_count* thieves)
   {
     using task = task_type<F, A...>;
 
-    // Move the data and release the lock.
+    // Move the data and release the lock or, if there is none (work-stealing
+    // queue), the slot. In the latter case also deregister the thief, if
+    // any, which we can only do once we no longer access the slot (see
+    // steal()).
     //
-    task t (move (*static_cast<task*> (td)));
-    ql.unlock ();
+    task t (move (*reinterpret_cast<task*> (&td.data)));
+
+    if (ql != nullptr)
+      ql->unlock ();
+    else
+    {
+      td.busy.store (false, memory_order_release);
+
+      if (thieves != nullptr)
+        thieves->fetch_sub (1, memory_order_release);
+    }
 
     t.thunk (std::index_sequence_for<A...> ());
 
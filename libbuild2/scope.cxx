@@ -61,6 +61,50 @@ namespace build2
     if (var.visibility == variable_visibility::prereq)
       return make_pair (lookup_type (), d);
 
+    // Lookups without a target only depend on the scope variable maps and so
+    // we can cache their results until any of them change (see
+    // lookup_cache_ for details). Note that we don't bother during load
+    // where things are in flux.
+    //
+    bool cache (tk == nullptr && start_d == 1 && ctx.phase != run_phase::load);
+    size_t gen (0);
+
+    shared_mutex* cm (nullptr);
+    if (cache)
+    {
+      gen = ctx.var_generation;
+
+      cm = &ctx.mutexes->variable_cache[
+        hash<const scope*> () (this) % ctx.mutexes->variable_cache_size];
+
+      slock l (*cm);
+
+      auto i (lookup_cache_.find (&var));
+      if (i != lookup_cache_.end () && i->second.generation == gen)
+      {
+        const lookup_cache_entry& e (i->second);
+
+        // Check if this is the first access after being assigned a type, in
+        // which case fall through to the lookup below that will typify it.
+        //
+        const lookup_type& r (e.lookup);
+        if (!r.defined () || r.var->type == nullptr || r->type == r.var->type)
+          return make_pair (r, e.depth);
+      }
+    }
+
+    auto cache_result = [cache, gen, cm, &var, this] (
+      pair<lookup_type, size_t>&& r)
+    {
+      if (cache)
+      {
+        ulock l (*cm);
+        lookup_cache_[&var] = lookup_cache_entry {r.first, r.second, gen};
+      }
+
+      return move (r);
+    };
+
     // Process target type/pattern-specific prepend/append values.
     //
     auto pre_app = [&var, this] (lookup_type& l,
@@ -216,7 +260,8 @@ namespace build2
       {
         auto p (s->vars.lookup (var));
         if (p.first != nullptr)
-          return make_pair (lookup_type (*p.first, p.second, s->vars), d);
+          return cache_result (
+            make_pair (lookup_type (*p.first, p.second, s->vars), d));
       }
 
       switch (var.visibility)
@@ -236,7 +281,7 @@ namespace build2
       }
     }
 
-    return make_pair (lookup_type (), size_t (~0));
+    return cache_result (make_pair (lookup_type (), size_t (~0)));
   }
 
   scope::override_info scope::
@@ -1116,6 +1161,9 @@ namespace build2
 
     scope& s (*er.first->second.front ());
 
+    if (er.second)
+      ctx.dirs.insert (k).out_scope = &s;
+
     // If this is a new scope, update the parent chain.
     //
     if (er.second)
@@ -1200,6 +1248,19 @@ namespace build2
   {
     assert (k.normalized (false)); // Allow non-canonical dir separators.
 
+    // If the path is interned (which is the case for all the scope and
+    // target directories), then we can just chase the parent links.
+    //
+    // Note that during load nothing can be interned concurrently so we skip
+    // locking the pool (see target_set::find() for details).
+    //
+    if (const interned_dir* d = ctx.dirs.find (
+          k, ctx.phase == run_phase::load))
+    {
+      for (; d->out_scope == nullptr; d = d->parent) ;
+      return *d->out_scope;
+    }
+
     // This one is tricky: if we found an entry that doesn't contain the
     // out path scope, then we need to consider outer scopes.
     //
@@ -4,12 +4,15 @@
 #ifndef LIBBUILD2_SCOPE_HXX
 #define LIBBUILD2_SCOPE_HXX
 
+#include <unordered_map>
+
 #include <libbuild2/types.hxx>
 #include <libbuild2/forward.hxx>
 #include <libbuild2/utility.hxx>
 
 #include <libbuild2/module.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/dir-pool.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/rule-map.hxx>
 #include <libbuild2/operation.hxx>
@@ -757,6 +760,23 @@ namespace build2
                               // NULL means no strong amalgamtion.
 
     variable_pool* var_pool_ = nullptr; // For temp_scope override.
+
+    // Cache of the lookup_original() results for lookups without a target.
+    //
+    // Such lookups often miss in most scopes and so end up walking all the
+    // way to the global scope. The cached result is only valid for the
+    // variable generation in which it was calculated (see
+    // context::var_generation). Protected by the variable cache mutex shard.
+    //
+    struct lookup_cache_entry
+    {
+      lookup_type lookup;
+      size_t      depth;
+      size_t      generation;
+    };
+
+    mutable std::unordered_map<const variable*,
+                               lookup_cache_entry> lookup_cache_;
   };
 
   inline bool
@@ -901,6 +921,17 @@ namespace build2
       return const_cast<scope_map*> (this)->find_out (d);
     }
 
+    // As above but for an interned directory (see dir_pool), in which case
+    // the lookup is just chasing the parent links.
+    //
+    const scope&
+    find_out (const interned_dir& d) const
+    {
+      const interned_dir* p (&d);
+      for (; p->out_scope == nullptr; p = p->parent) ;
+      return *p->out_scope;
+    }
+
     // Find all the scopes that encompass this path (out or src).
     //
     // If skip_null_out is false, then the first element always corresponds to
@@ -0,0 +1,431 @@
+// file      : libbuild2/script/diff.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/script/diff.hxx>
+
+#include <cstring>       // memcmp()
+#include <unordered_map>
+
+using namespace std;
+
+namespace build2
+{
+  namespace script
+  {
+    namespace
+    {
+      // Line text excluding the newline (and the stripped carriage return).
+      //
+      struct line
+      {
+        const char* data;
+        size_t      size;
+        bool        newline;
+      };
+
+      inline bool
+      operator== (const line& x, const line& y)
+      {
+        return x.size == y.size       &&
+               x.newline == y.newline &&
+               memcmp (x.data, y.data, x.size) == 0;
+      }
+
+      vector<line>
+      split (const string& s, bool strip_cr)
+      {
+        vector<line> r;
+
+        const char* b (s.c_str ());
+        const char* e (b + s.size ());
+
+        while (b != e)
+        {
+          const char* p (static_cast<const char*> (memchr (b, '\n', e - b)));
+
+          if (p == nullptr)
+          {
+            r.push_back (line {b, static_cast<size_t> (e - b), false});
+            break;
+          }
+
+          size_t n (p - b);
+
+          if (strip_cr && n != 0 && b[n - 1] == '\r')
+            --n;
+
+          r.push_back (line {b, n, true});
+          b = p + 1;
+        }
+
+        return r;
+      }
+
+      // Myers' difference algorithm, linear space variant (see "An O(ND)
+      // Difference Algorithm and Its Variations" by Eugene W. Myers). The
+      // lines are represented by integer ids with equal lines having equal
+      // ids.
+      //
+      class myers
+      {
+      public:
+        myers (const vector<size_t>& a, const vector<size_t>& b)
+            : del (a.size (), false), ins (b.size (), false), a_ (a), b_ (b) {}
+
+        // Mark the deleted lines in a[a0, a1) and inserted lines in
+        // b[b0, b1).
+        //
+        void
+        compare (size_t a0, size_t a1, size_t b0, size_t b1);
+
+        vector<bool> del;
+        vector<bool> ins;
+
+      private:
+        // Find the middle snake of the shortest edit script for a[a0, a0+n)
+        // and b[b0, b0+m) returning its end point (relative to a0 and b0)
+        // or false if there is none (which can only happen if there are no
+        // common lines).
+        //
+        bool
+        bisect (size_t a0, size_t n, size_t b0, size_t m,
+                size_t& x, size_t& y);
+
+      private:
+        const vector<size_t>& a_;
+        const vector<size_t>& b_;
+
+        vector<ptrdiff_t> v1_; // Forward furthest reaching x by diagonal.
+        vector<ptrdiff_t> v2_; // Reverse furthest reaching x by diagonal.
+      };
+
+      void myers::
+      compare (size_t a0, size_t a1, size_t b0, size_t b1)
+      {
+        // Skip the common prefix and suffix.
+        //
+        for (; a0 != a1 && b0 != b1 && a_[a0] == b_[b0]; ++a0, ++b0) ;
+        for (; a0 != a1 && b0 != b1 && a_[a1 - 1] == b_[b1 - 1]; --a1, --b1) ;
+
+        size_t n (a1 - a0);
+        size_t m (b1 - b0);
+
+        size_t x, y;
+        if (n != 0 && m != 0            &&
+            bisect (a0, n, b0, m, x, y) &&
+            !(x == 0 && y == 0)         &&
+            !(x == n && y == m))
+        {
+          compare (a0, a0 + x, b0, b0 + y);
+          compare (a0 + x, a1, b0 + y, b1);
+          return;
+        }
+
+        // Everything left is either deleted or inserted (or we failed to
+        // split, which is not expected but is still correct).
+        //
+        for (size_t i (a0); i != a1; ++i) del[i] = true;
+        for (size_t j (b0); j != b1; ++j) ins[j] = true;
+      }
+
+      bool myers::
+      bisect (size_t a0, size_t un, size_t b0, size_t um,
+              size_t& rx, size_t& ry)
+      {
+        ptrdiff_t n (static_cast<ptrdiff_t> (un));
+        ptrdiff_t m (static_cast<ptrdiff_t> (um));
+
+        ptrdiff_t max_d ((n + m + 1) / 2);
+        ptrdiff_t off (max_d);
+        ptrdiff_t size (2 * max_d + 2);
+
+        v1_.assign (static_cast<size_t> (size), -1);
+        v2_.assign (static_cast<size_t> (size), -1);
+        v1_[off + 1] = 0;
+        v2_[off + 1] = 0;
+
+        // If the total number of lines is odd, then the forward path will
+        // collide with the reverse path and the other way around otherwise.
+        //
+        ptrdiff_t delta (n - m);
+        bool front (delta % 2 != 0);
+
+        // Offsets for the start and end of the diagonals range that went off
+        // the edge of the edit graph.
+        //
+        ptrdiff_t k1s (0), k1e (0), k2s (0), k2e (0);
+
+        for (ptrdiff_t d (0); d < max_d; ++d)
+        {
+          // Walk the forward path one step.
+          //
+          for (ptrdiff_t k1 (-d + k1s); k1 <= d - k1e; k1 += 2)
+          {
+            ptrdiff_t k1o (off + k1);
+            ptrdiff_t x1 (
+              k1 == -d || (k1 != d && v1_[k1o - 1] < v1_[k1o + 1])
+              ? v1_[k1o + 1]
+              : v1_[k1o - 1] + 1);
+            ptrdiff_t y1 (x1 - k1);
+
+            for (;
+                 x1 < n && y1 < m &&
+                 a_[a0 + x1] == b_[b0 + y1];
+                 ++x1, ++y1) ;
+
+            v1_[k1o] = x1;
+
+            if (x1 > n)
+              k1e += 2; // Ran off the right of the graph.
+            else if (y1 > m)
+              k1s += 2; // Ran off the bottom of the graph.
+            else if (front)
+            {
+              ptrdiff_t k2o (off + delta - k1);
+              if (k2o >= 0 && k2o < size && v2_[k2o] != -1)
+              {
+                // Mirror x2 onto the top-left coordinate system.
+                //
+                if (x1 >= n - v2_[k2o])
+                {
+                  rx = static_cast<size_t> (x1);
+                  ry = static_cast<size_t> (y1);
+                  return true;
+                }
+              }
+            }
+          }
+
+          // Walk the reverse path one step.
+          //
+          for (ptrdiff_t k2 (-d + k2s); k2 <= d - k2e; k2 += 2)
+          {
+            ptrdiff_t k2o (off + k2);
+            ptrdiff_t x2 (
+              k2 == -d || (k2 != d && v2_[k2o - 1] < v2_[k2o + 1])
+              ? v2_[k2o + 1]
+              : v2_[k2o - 1] + 1);
+            ptrdiff_t y2 (x2 - k2);
+
+            for (;
+                 x2 < n && y2 < m &&
+                 a_[a0 + n - x2 - 1] == b_[b0 + m - y2 - 1];
+                 ++x2, ++y2) ;
+
+            v2_[k2o] = x2;
+
+            if (x2 > n)
+              k2e += 2;
+            else if (y2 > m)
+              k2s += 2;
+            else if (!front)
+            {
+              ptrdiff_t k1o (off + delta - k2);
+              if (k1o >= 0 && k1o < size && v1_[k1o] != -1)
+              {
+                ptrdiff_t x1 (v1_[k1o]);
+                ptrdiff_t y1 (off + x1 - k1o);
+
+                if (x1 >= n - x2)
+                {
+                  rx = static_cast<size_t> (x1);
+                  ry = static_cast<size_t> (y1);
+                  return true;
+                }
+              }
+            }
+          }
+        }
+
+        return false;
+      }
+    }
+
+    bool
+    text_equal (const string& x, const string& y, bool strip_cr)
+    {
+      if (!strip_cr)
+        return x == y;
+
+      vector<line> xs (split (x, true));
+      vector<line> ys (split (y, true));
+
+      return xs.size () == ys.size () && equal (xs.begin (), xs.end (),
+                                                ys.begin ());
+    }
+
+    void
+    text_diff (ostream& os,
+               const string& from, const string& to,
+               const string& from_label, const string& to_label,
+               bool strip_cr,
+               size_t context)
+    {
+      vector<line> ls[2] {split (from, strip_cr), split (to, strip_cr)};
+
+      // Map lines to ids so that the comparison is cheap.
+      //
+      vector<size_t> ids[2];
+      size_t idn;
+      {
+        unordered_map<string, size_t> m;
+
+        for (size_t i (0); i != 2; ++i)
+        {
+          ids[i].reserve (ls[i].size ());
+
+          for (const line& l: ls[i])
+          {
+            string k (l.data, l.size);
+
+            if (l.newline)
+              k += '\n';
+
+            ids[i].push_back (
+              m.emplace (move (k), m.size ()).first->second);
+          }
+        }
+
+        idn = m.size ();
+      }
+
+      const vector<size_t>& a (ids[0]);
+      const vector<size_t>& b (ids[1]);
+
+      vector<bool> del (a.size (), false);
+      vector<bool> ins (b.size (), false);
+
+      // Lines that don't occur in the other text are always deleted or
+      // inserted and so we exclude them from the comparison. Besides
+      // reducing the input size, this helps with the worst case of
+      // completely different texts (which would otherwise be quadratic).
+      //
+      {
+        vector<bool> in[2] {vector<bool> (idn, false),
+                            vector<bool> (idn, false)};
+
+        for (size_t i (0); i != 2; ++i)
+          for (size_t id: ids[i])
+            in[i][id] = true;
+
+        vector<size_t> fs[2]; // Filtered ids.
+        vector<size_t> ps[2]; // Their positions in the original ids.
+
+        for (size_t i (0); i != 2; ++i)
+        {
+          const vector<size_t>& is (ids[i]);
+          vector<bool>& r (i == 0 ? del : ins);
+
+          for (size_t k (0); k != is.size (); ++k)
+          {
+            if (in[i == 0 ? 1 : 0][is[k]])
+            {
+              fs[i].push_back (is[k]);
+              ps[i].push_back (k);
+            }
+            else
+              r[k] = true;
+          }
+        }
+
+        myers md (fs[0], fs[1]);
+        md.compare (0, fs[0].size (), 0, fs[1].size ());
+
+        for (size_t k (0); k != md.del.size (); ++k)
+          if (md.del[k]) del[ps[0][k]] = true;
+
+        for (size_t k (0); k != md.ins.size (); ++k)
+          if (md.ins[k]) ins[ps[1][k]] = true;
+      }
+
+      // Convert the result into the edit script with deletions preceding
+      // insertions in each changed region.
+      //
+      struct op
+      {
+        char   c; // ' ', '-', or '+'.
+        size_t i; // Position in a.
+        size_t j; // Position in b.
+      };
+
+      vector<op> ops;
+      ops.reserve (max (a.size (), b.size ()));
+
+      for (size_t i (0), j (0); i != a.size () || j != b.size (); )
+      {
+        if (i != a.size () && del[i])
+          ops.push_back (op {'-', i++, j});
+        else if (j != b.size () && ins[j])
+          ops.push_back (op {'+', i, j++});
+        else
+          ops.push_back (op {' ', i++, j++});
+      }
+
+      // Print the hunks merging those separated by no more than twice the
+      // context lines.
+      //
+      auto range = [] (size_t s, size_t n) -> string
+      {
+        // Note that for an empty range the start is the line before.
+        //
+        return n == 0 ? to_string (s) + ",0" :
+               n == 1 ? to_string (s + 1)    :
+               to_string (s + 1) + ',' + to_string (n);
+      };
+
+      bool header (false);
+      for (size_t k (0), n (ops.size ()); k != n; )
+      {
+        if (ops[k].c == ' ')
+        {
+          ++k;
+          continue;
+        }
+
+        size_t s (k > context ? k - context : 0);
+        size_t l (k);
+
+        for (++k; k != n; ++k)
+        {
+          if (ops[k].c != ' ')
+            l = k;
+          else if (k - l > 2 * context)
+            break;
+        }
+
+        size_t e (min (l + 1 + context, n));
+        k = e;
+
+        if (!header)
+        {
+          os << "--- " << from_label << '\n'
+             << "+++ " << to_label << '\n';
+          header = true;
+        }
+
+        size_t an (0), bn (0);
+        for (size_t i (s); i != e; ++i)
+        {
+          if (ops[i].c != '+') ++an;
+          if (ops[i].c != '-') ++bn;
+        }
+
+        os << "@@ -" << range (ops[s].i, an)
+           << " +" << range (ops[s].j, bn) << " @@" << '\n';
+
+        for (size_t i (s); i != e; ++i)
+        {
+          const op& o (ops[i]);
+          const line& ln (o.c == '+' ? ls[1][o.j] : ls[0][o.i]);
+
+          os << o.c;
+          os.write (ln.data, static_cast<streamsize> (ln.size));
+          os << '\n';
+
+          if (!ln.newline)
+            os << "\\ No newline at end of file" << '\n';
+        }
+      }
+    }
+  }
+}
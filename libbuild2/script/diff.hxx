@@ -0,0 +1,44 @@
+// file      : libbuild2/script/diff.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_SCRIPT_DIFF_HXX
+#define LIBBUILD2_SCRIPT_DIFF_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+namespace build2
+{
+  namespace script
+  {
+    // Built-in text comparison (used instead of the diff utility for
+    // checking the script command output).
+    //
+    // The texts are compared line by line with the last line without the
+    // trailing newline being different from the same line with the newline.
+    // If strip_cr is true, then the carriage returns before newlines are
+    // ignored (similar to diff --strip-trailing-cr).
+
+    // Return true if the texts are equal.
+    //
+    bool
+    text_equal (const string&, const string&, bool strip_cr);
+
+    // Write the differences between the texts to the stream in the unified
+    // format with the specified number of context lines (similar to diff -u
+    // -L <from_label> -L <to_label>). Write nothing if the texts are equal.
+    //
+    // The differences are calculated using the Myers' O(ND) algorithm (in
+    // its linear space variant). Note that while the result is minimal, it
+    // may differ from that of GNU diff in how the changes are aligned.
+    //
+    void
+    text_diff (ostream&,
+               const string& from, const string& to,
+               const string& from_label, const string& to_label,
+               bool strip_cr,
+               size_t context = 3);
+  }
+}
+
+#endif // LIBBUILD2_SCRIPT_DIFF_HXX
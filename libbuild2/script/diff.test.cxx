@@ -0,0 +1,76 @@
+// file      : libbuild2/script/diff.test.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <iostream>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/script/diff.hxx>
+
+#undef NDEBUG
+#include <cassert>
+
+using namespace std;
+
+namespace build2
+{
+  namespace script
+  {
+    // Usage: argv[0] [--strip-cr] <file>
+    //
+    // Compare the file contents with stdin printing the differences to
+    // stdout. Exit with the zero code if they are equal and one otherwise.
+    //
+    int
+    main (int argc, char* argv[])
+    {
+      bool strip_cr (false);
+      path f;
+      {
+        int i (1);
+        if (i != argc && argv[i] == string ("--strip-cr"))
+        {
+          strip_cr = true;
+          ++i;
+        }
+
+        assert (i + 1 == argc);
+        f = path (argv[i]);
+      }
+
+      try
+      {
+        string x;
+        {
+          ifdstream is (f);
+          x = is.read_text ();
+        }
+
+        string y;
+        {
+          ifdstream is (fddup (stdin_fd ()));
+          y = is.read_text ();
+        }
+
+        bool r (text_equal (x, y, strip_cr));
+
+        if (!r)
+          text_diff (cout, x, y, f.string (), "-", strip_cr);
+
+        return r ? 0 : 1;
+      }
+      catch (const io_error& e)
+      {
+        cerr << "error: " << e << endl;
+        return 2;
+      }
+    }
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  return build2::script::main (argc, argv);
+}
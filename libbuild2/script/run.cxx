@@ -20,6 +20,7 @@
 #include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
 
+#include <libbuild2/script/diff.hxx>
 #include <libbuild2/script/regex.hxx>
 #include <libbuild2/script/timeout.hxx>
 #include <libbuild2/script/builtin-options.hxx>
@@ -187,6 +188,25 @@ namespace build2
       }
     }
 
+    // Load the file into a string. Fail if exception is thrown by underlying
+    // operations.
+    //
+    static string
+    load (const path& p, const location& ll)
+    {
+      try
+      {
+        ifdstream is (p);
+        string r (is.read_text ());
+        is.close ();
+        return r;
+      }
+      catch (const io_error& e)
+      {
+        fail (ll) << "unable to read " << p << ": " << e << endf;
+      }
+    }
+
     // Transform string according to here-* redirect modifiers from the {/}
     // set.
     //
@@ -305,147 +325,87 @@ namespace build2
                (rd.type == redirect_type::file &&
                 rd.file.mode == redirect_fmode::compare))
       {
-        // The expected output is provided as a file or as a string. Save the
-        // string to a file in the later case.
+        // The expected output is provided as a file or as a string.
+        //
+        // Note that while we used to compare the output using the diff
+        // utility, this is quite expensive for the common case of the
+        // matching output. So now we compare it in-process and only save the
+        // expected output (if provided as a string) and the differences to
+        // files on mismatch.
         //
         assert (!op.empty ());
 
         path eop;
+        string es;
 
         if (rd.type == redirect_type::file)
+        {
           eop = normalize (rd.file.path, *env.work_dir.path, ll);
+          es = load (eop, ll);
+        }
         else
-        {
-          eop = path (op + ".orig");
+          es = transform (rd.str, false /* regex */, rd.modifiers (), env);
 
-          save (eop,
-                transform (rd.str, false /* regex */, rd.modifiers (), env),
-                ll);
+        string os (load (op, ll));
 
-          env.clean_special (eop);
-        }
-
-        // Use the diff utility for comparison.
+        // Ignore Windows newline fluff if that's what we are running on
+        // (similar to diff --strip-trailing-cr).
         //
-        path dp ("diff");
-        process_path pp (run_search (dp, true));
+        bool strip_cr (env.host.class_ == "windows");
 
-        cstrings args {pp.recall_string (), "-u"};
+        if (text_equal (es, os, strip_cr))
+          return true;
 
-        // Ignore Windows newline fluff if that's what we are running on.
-        //
-        if (env.host.class_ == "windows")
-          args.push_back ("--strip-trailing-cr");
+        if (rd.type != redirect_type::file)
+        {
+          eop = path (op + ".orig");
+          save (eop, es, ll);
+          env.clean_special (eop);
+        }
 
-        // Instruct diff not to print the file paths that won't be available
-        // on failure.
+        // Save the differences to a file for troubleshooting and for the
+        // optional (if not too large) printing (at the end of diagnostics).
         //
-        // It seems that the only portable way to achieve this is to abandon
-        // the output unified format in the favor of the minimal output.
-        // However, the FreeBSD's, OpenBSD's and GNU's (used on Linux, MacOS,
-        // Windows, and NetBSD) diff utilities support the -L option that
-        // allows to replace the compared file path(s) with custom string(s)
-        // in the utility output. We will use this option for both files if
-        // any of them won't be available on failure (note that we can't
-        // assign a label only for the second file).
+        // Use the file path as a label if it will be available on failure
+        // and its name otherwise.
         //
-        // Add the -L option using the file name as its value if it won't be
-        // available on failure and its full path otherwise.
-        //
-        auto add_label = [&args, &env] (const path& p)
+        auto label = [&env] (const path& p)
         {
-          const char* s (p.string ().c_str ());
-
-          args.push_back ("-L");
-          args.push_back (avail_on_failure (p, env)
-                          ? s
-                          : path::traits_type::find_leaf (s));
+          return avail_on_failure (p, env) ? p.string () : p.leaf ().string ();
         };
 
-        if (!avail_on_failure (eop, env) || !avail_on_failure (op, env))
-        {
-          add_label (eop);
-          add_label (op);
-        }
-
-        args.push_back (eop.string ().c_str ());
-        args.push_back (op.string ().c_str ());
-        args.push_back (nullptr);
-
-        if (verb >= 2)
-          print_process (args);
+        path ep (op + ".diff");
 
         try
         {
-          // Save diff's stdout to a file for troubleshooting and for the
-          // optional (if not too large) printing (at the end of
-          // diagnostics).
-          //
-          path ep (op + ".diff");
-          auto_fd efd;
+          ofdstream ofs (ep);
+          text_diff (ofs, es, os, label (eop), label (op), strip_cr);
+          ofs.close ();
 
-          try
-          {
-            efd = fdopen (ep, fdopen_mode::out | fdopen_mode::create);
-            env.clean_special (ep);
-          }
-          catch (const io_error& e)
-          {
-            fail (ll) << "unable to write to " << ep << ": " << e;
-          }
-
-          // Diff utility prints the differences to stdout. But for the
-          // user it is a part of the script failure diagnostics so let's
-          // redirect stdout to stderr.
-          //
-          process p (pp, args.data (), 0, 2, efd.get ());
-          efd.reset ();
-
-          if (p.wait ())
-            return true;
-
-          assert (p.exit);
-          const process_exit& pe (*p.exit);
-
-          // Note that both POSIX and GNU diff report error by exiting with
-          // the code > 1.
-          //
-          if (!pe.normal () || pe.code () > 1)
-          {
-            diag_record d (fail (ll));
-            print_process (d, args);
-            d << " " << pe;
-
-            print_file (d, ep, ll);
-          }
-
-          // Output doesn't match the expected result.
-          //
-          if (diag)
-          {
-            diag_record d (error (ll));
-            d << pr << " " << what << " doesn't match expected";
-
-            output_info (d, op);
-            output_info (d, eop, "expected ");
-            output_info (d, ep, "", " diff");
-            input_info  (d);
-
-            print_file (d, ep, ll);
-          }
-
-          // Fall through (to return false).
-          //
+          env.clean_special (ep);
         }
-        catch (const process_error& e)
+        catch (const io_error& e)
         {
-          error (ll) << "unable to execute " << pp << ": " << e;
+          fail (ll) << "unable to write to " << ep << ": " << e;
+        }
 
-          if (e.child)
-            exit (1);
+        // Output doesn't match the expected result.
+        //
+        if (diag)
+        {
+          diag_record d (error (ll));
+          d << pr << " " << what << " doesn't match expected";
 
-          throw failed ();
+          output_info (d, op);
+          output_info (d, eop, "expected ");
+          output_info (d, ep, "", " diff");
+          input_info  (d);
+
+          print_file (d, ep, ll);
         }
+
+        // Fall through (to return false).
+        //
       }
       else if (rd.type == redirect_type::here_str_regex ||
                rd.type == redirect_type::here_doc_regex)
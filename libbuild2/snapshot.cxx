@@ -0,0 +1,486 @@
+// file      : libbuild2/snapshot.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/snapshot.hxx>
+
+#include <cerrno>
+#include <cstdlib>   // environ, _environ, strtoll()
+#include <cstring>   // strlen()
+
+#include <libbutl/filesystem.hxx> // file_mtime(), dir_mtime(), dir_iterator,
+                                  // mvfile()
+
+#include <libbuild2/target.hxx>
+#include <libbuild2/context.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#ifndef _WIN32
+extern char** environ;
+#endif
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  build_snapshot* build_snapshot::instance = nullptr;
+
+  // Snapshot file header. Increment the format version if changing anything
+  // in the layout.
+  //
+  static const char snapshot_header[] = "build2 snapshot 1\n";
+
+  namespace
+  {
+    struct entry
+    {
+      char           kind; // 'f' (file) or 'd' (directory).
+      string         path;
+      timestamp::rep mtime;
+    };
+  }
+
+  // Return the entry modification time or timestamp_unknown if unable to
+  // obtain it (which is never considered a match).
+  //
+  static timestamp::rep
+  entry_mtime (char k, const char* p)
+  {
+    try
+    {
+      return (k == 'd'
+              ? dir_mtime (p)
+              : file_mtime (p)).time_since_epoch ().count ();
+    }
+    catch (const system_error&)
+    {
+      return timestamp_unknown_rep;
+    }
+  }
+
+  static inline timestamp::rep
+  entry_mtime (const entry& e)
+  {
+    return entry_mtime (e.kind, e.path.c_str ());
+  }
+
+  // Call f(i) for each i in [0, n) using up to the specified number of
+  // threads (including the calling one) and stop as soon as f() returns
+  // false, in which case return false as well.
+  //
+  template <typename F>
+  static bool
+  parallel (size_t n, size_t threads, const F& f)
+  {
+    atomic<size_t> next (0);
+    atomic<bool> r (true);
+
+    auto work = [n, &f, &next, &r] ()
+    {
+      for (size_t i;
+           r.load (memory_order_relaxed) &&
+             (i = next.fetch_add (1, memory_order_relaxed)) < n; )
+      {
+        if (!f (i))
+          r.store (false, memory_order_relaxed);
+      }
+    };
+
+    // Don't bother with threads unless there is a reasonable amount of work
+    // for each. If we fail to start some, then proceed with those we have.
+    //
+    vector<thread> ts;
+    try
+    {
+      for (size_t i (1), m (min (threads, n / 64)); i < m; ++i)
+        ts.push_back (thread (work));
+    }
+    catch (const system_error&) {}
+
+    work ();
+
+    for (thread& t: ts)
+      t.join ();
+
+    return r.load (memory_order_relaxed);
+  }
+
+  build_snapshot::
+  build_snapshot (size_t shards)
+      : shards_ (new shard[shards]), shard_count_ (shards)
+  {
+  }
+
+  void build_snapshot::
+  record (const char* p, size_t n, timestamp mt)
+  {
+    string k (p, n);
+    shard& s (shards_[hash<string> () (k) % shard_count_]);
+
+    {
+      mlock l (s.mutex);
+      if (s.map.find (k) != s.map.end ())
+        return;
+    }
+
+    // Query the modification time without holding the lock. If another
+    // thread records the same file in the meantime, then whichever of the
+    // two values ends up in the map is as good as the other.
+    //
+    timestamp::rep m (mt != timestamp_unknown
+                      ? mt.time_since_epoch ().count ()
+                      : entry_mtime ('f', k.c_str ()));
+
+    mlock l (s.mutex);
+    s.map.emplace (move (k), file_state {m, false});
+  }
+
+  void build_snapshot::
+  record_output (const path& p)
+  {
+    const string& k (p.string ());
+    shard& s (shards_[hash<string> () (k) % shard_count_]);
+
+    mlock l (s.mutex);
+    s.map[k].output = true;
+  }
+
+  void build_snapshot::
+  record_root (const dir_path& d)
+  {
+    mlock l (mutex_);
+
+    if (find (roots_.begin (), roots_.end (), d) == roots_.end ())
+      roots_.push_back (d);
+  }
+
+  void build_snapshot::
+  record_targets (const context& ctx)
+  {
+    for (const auto& t: ctx.targets)
+    {
+      const path_target* pt (t->is_a<path_target> ());
+      if (pt == nullptr)
+        continue;
+
+      const path& p (pt->path ());
+      if (p.empty ())
+        continue;
+
+      const string& k (p.string ());
+      shard& s (shards_[hash<string> () (k) % shard_count_]);
+
+      // If the cached target modification time differs from the one
+      // recorded when the build first looked at the file, then the target
+      // has been updated by the build. Otherwise it is either up to date or
+      // a source file, in which case we keep the recorded modification time
+      // (see write() for details).
+      //
+      timestamp mt (pt->mtime ());
+      {
+        mlock l (s.mutex);
+        auto i (s.map.find (k));
+
+        if (i != s.map.end ())
+        {
+          if (mt != timestamp_unknown     &&
+              mt != timestamp_nonexistent &&
+              mt.time_since_epoch ().count () != i->second.mtime)
+            i->second.output = true;
+
+          continue;
+        }
+      }
+
+      record (p);
+    }
+
+    // Nested contexts normally point to themselves.
+    //
+    if (ctx.module_context != nullptr && ctx.module_context != &ctx)
+      record_targets (*ctx.module_context);
+
+    if (ctx.update_during_load_context != nullptr &&
+        ctx.update_during_load_context != &ctx)
+      record_targets (*ctx.update_during_load_context);
+  }
+
+  // Add the directory and all its non-hidden subdirectories.
+  //
+  static void
+  walk (const dir_path& d, vector<entry>& es)
+  {
+    es.push_back (entry {'d', d.string (), 0});
+
+    for (const dir_entry& de: dir_iterator (d, dir_iterator::no_follow))
+    {
+      if (de.ltype () != entry_type::directory)
+        continue;
+
+      const path& n (de.path ());
+
+      if (n.string ().front () == '.')
+        continue;
+
+      walk (d / path_cast<dir_path> (n), es);
+    }
+  }
+
+  void build_snapshot::
+  write (const path& f, const string& key, size_t threads) const
+  {
+    tracer trace ("build_snapshot::write");
+
+    path t (f + ('.' + to_string (process::current_id ()) + ".tmp"));
+
+    try
+    {
+      // For outputs we query the modification times below, along with the
+      // directories. For the rest we make sure they haven't changed since
+      // the build looked at them. If any did, then this snapshot would hide
+      // the change from the next invocation. Instead, we remove any existing
+      // snapshot and let the next invocation perform the build.
+      //
+      vector<entry> es;
+      vector<entry> is;
+
+      for (size_t i (0); i != shard_count_; ++i)
+      {
+        for (const auto& p: shards_[i].map)
+        {
+          const file_state& s (p.second);
+
+          if (s.output)
+            es.push_back (entry {'f', p.first, 0});
+          else
+            is.push_back (entry {'f', p.first, s.mtime});
+        }
+      }
+
+      if (!parallel (is.size (),
+                     threads,
+                     [&is, &trace] (size_t i)
+                     {
+                       const entry& e (is[i]);
+
+                       if (entry_mtime (e) == e.mtime)
+                         return true;
+
+                       l4 ([&]{trace << "changed during build " << e.path;});
+                       return false;
+                     }))
+      {
+        try_rmfile_ignore_error (f);
+        return;
+      }
+
+      // Create the snapshot directory before querying the directory
+      // modification times (it could be in one of them). Note, however,
+      // that if the snapshot file itself is in one of the project source
+      // directories (as opposed to a hidden subdirectory), then it will
+      // never be valid.
+      //
+      if (!f.directory ().empty ())
+        try_mkdir_p (f.directory ());
+
+      // Skip roots that are inside other roots (subprojects).
+      //
+      {
+        dir_paths rs (roots_);
+        sort (rs.begin (), rs.end ());
+
+        const dir_path* pr (nullptr);
+        for (const dir_path& r: rs)
+        {
+          if (pr != nullptr && r.sub (*pr))
+            continue;
+
+          walk (r, es);
+          pr = &r;
+        }
+      }
+
+      parallel (es.size (),
+                threads,
+                [&es] (size_t i)
+                {
+                  entry& e (es[i]);
+                  e.mtime = entry_mtime (e);
+                  return true;
+                });
+
+      // Write to a temporary file in the same directory and then move it
+      // into place so that a partially-written snapshot is never used.
+      //
+      {
+        ofdstream ofs (t);
+        ofs << snapshot_header << key << '\n';
+
+        for (const entry& e: is)
+          ofs << e.kind << ' ' << e.mtime << ' ' << e.path << '\n';
+
+        for (const entry& e: es)
+          ofs << e.kind << ' ' << e.mtime << ' ' << e.path << '\n';
+
+        ofs.close ();
+      }
+
+      butl::mvfile (
+        t, f, cpflags::overwrite_content | cpflags::overwrite_permissions);
+
+      l5 ([&]{trace << "wrote " << is.size () + es.size () << " entries to "
+                    << f;});
+    }
+    catch (const io_error& e)
+    {
+      warn << "unable to write snapshot " << f << ": " << e;
+      try_rmfile_ignore_error (t);
+    }
+    catch (const system_error& e)
+    {
+      warn << "unable to save snapshot " << f << ": " << e;
+      try_rmfile_ignore_error (t);
+    }
+  }
+
+  bool build_snapshot::
+  verify (const path& f, const string& key, size_t threads)
+  {
+    tracer trace ("build_snapshot::verify");
+
+    string s;
+    try
+    {
+      ifdstream ifs (f);
+      s = ifs.read_text ();
+      ifs.close ();
+    }
+    catch (const io_error& e)
+    {
+      // Note that this includes the non-existent file, which is the common
+      // case of the first build, so we only trace at the higher verbosity
+      // level.
+      //
+      l5 ([&]{trace << "unable to read snapshot " << f << ": " << e;});
+      return false;
+    }
+
+    // Get the next line returning false if there is none.
+    //
+    size_t b (0);
+    auto next = [&s, &b] (string& l)
+    {
+      size_t e (s.find ('\n', b));
+
+      if (e == string::npos)
+        return false;
+
+      l.assign (s, b, e - b);
+      b = e + 1;
+      return true;
+    };
+
+    string l;
+
+    if (!next (l) || l + '\n' != snapshot_header)
+    {
+      l4 ([&]{trace << "invalid snapshot " << f;});
+      return false;
+    }
+
+    if (!next (l) || l != key)
+    {
+      l4 ([&]{trace << "key mismatch in snapshot " << f;});
+      return false;
+    }
+
+    vector<entry> es;
+    while (next (l))
+    {
+      // <kind> <mtime> <path>
+      //
+      size_t p;
+      if (l.size () < 5                          ||
+          (l[0] != 'f' && l[0] != 'd')           ||
+          l[1] != ' '                            ||
+          (p = l.find (' ', 2)) == string::npos   ||
+          p + 1 == l.size ())
+      {
+        l4 ([&]{trace << "invalid entry in snapshot " << f;});
+        return false;
+      }
+
+      const char* lb (l.c_str ());
+      char* le;
+
+      errno = 0;
+      long long m (strtoll (lb + 2, &le, 10));
+
+      if (errno != 0 || le != lb + p)
+      {
+        l4 ([&]{trace << "invalid entry in snapshot " << f;});
+        return false;
+      }
+
+      es.push_back (
+        entry {l[0], string (l, p + 1), static_cast<timestamp::rep> (m)});
+    }
+
+    if (b != s.size ())
+    {
+      l4 ([&]{trace << "truncated snapshot " << f;});
+      return false;
+    }
+
+    bool r (parallel (es.size (),
+                      threads,
+                      [&es, &trace] (size_t i)
+                      {
+                        const entry& e (es[i]);
+                        timestamp::rep m (entry_mtime (e));
+
+                        if (m != timestamp_unknown_rep && m == e.mtime)
+                          return true;
+
+                        l4 ([&]{trace << "changed " << e.path;});
+                        return false;
+                      }));
+
+    l5 ([&]{trace << "verified " << es.size () << " entries in " << f
+                  << (r ? "" : ": mismatch");});
+
+    return r;
+  }
+
+  string build_snapshot::
+  key (int argc, char* argv[])
+  {
+    // Note that we include the terminating '\0' to separate the values.
+    //
+    xxh64 cs;
+    cs.append (build_version.string ());
+    cs.append (work.string ());
+
+    for (int i (0); i != argc; ++i)
+      cs.append (argv[i], strlen (argv[i]) + 1);
+
+    // Sort the environment so that the key doesn't depend on the order.
+    //
+#ifdef _WIN32
+    char** env (_environ);
+#else
+    char** env (environ);
+#endif
+
+    strings vs;
+    for (; env != nullptr && *env != nullptr; ++env)
+      vs.push_back (*env);
+
+    sort (vs.begin (), vs.end ());
+
+    for (const string& v: vs)
+      cs.append (v.c_str (), v.size () + 1);
+
+    return cs.string ();
+  }
+}
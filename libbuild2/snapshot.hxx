@@ -0,0 +1,156 @@
+// file      : libbuild2/snapshot.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_SNAPSHOT_HXX
+#define LIBBUILD2_SNAPSHOT_HXX
+
+#include <unordered_map>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Build state snapshot (see --snapshot).
+  //
+  // For a no-op update of a large tree most of the time is spent loading the
+  // buildfiles and matching the rules (which includes loading the auxiliary
+  // dependency databases) only to conclude that nothing has changed. The
+  // snapshot allows short-circuiting this by recording, after a successful
+  // update, the modification times of everything the build has looked at
+  // and then, on the next invocation with the same key (command line,
+  // working directory, and environment), checking these modification times
+  // instead of performing the build.
+  //
+  // The following filesystem entries are recorded:
+  //
+  // file  -- every file whose modification time was queried with mtime()
+  //          (target files, auxiliary dependency databases, etc), every
+  //          buildfile parsed, and every program searched for
+  //
+  // file  -- every path target file (in case its modification time was not
+  //          queried, for example, because the target was just updated)
+  //
+  // dir   -- every directory in project source roots (excluding hidden) to
+  //          detect added and removed files (think globs)
+  //
+  // The modification time of a file is taken when it is first recorded
+  // (that is, when the build first looks at it) rather than when the
+  // snapshot is written. Otherwise, a source file changed during the build
+  // after it was used (for example, edited after its object file has been
+  // compiled) would be recorded with its new modification time and the next
+  // invocation would consider the stale output up to date. The exception are
+  // files written by the build (updated path targets and auxiliary
+  // dependency databases) which are recorded as outputs and for which the
+  // modification time is queried when the snapshot is written so that it
+  // reflects the state after the build. If, at that point, any other file
+  // has a different modification time, then the snapshot is not written.
+  //
+  // Note, however, that the directory modification times are still queried
+  // when the snapshot is written since with an in source build the build
+  // itself adds files to the source directories.
+  //
+  // Because the places that record the entries don't necessarily have access
+  // to the build context (for example, mtime() or run_search()) and the
+  // snapshot needs to span all the contexts of a build, the recorder is
+  // process-wide with the instance pointer being set by the driver. The
+  // recording is MT-safe and the recorder is split into shards (by the path
+  // hash) to reduce contention.
+  //
+  class LIBBUILD2_SYMEXPORT build_snapshot
+  {
+  public:
+    // The global instance or NULL if not recording.
+    //
+    static build_snapshot* instance;
+
+    // Record a file whose modification time the build depends on. Relative
+    // paths are relative to the current working directory (which is part of
+    // the key). If the modification time is not specified, then query it.
+    // Note that if the file has already been recorded, then the modification
+    // time from the first call is retained.
+    //
+    void
+    record (const char* path, size_t size, timestamp = timestamp_unknown);
+
+    void
+    record (const path& p, timestamp mt = timestamp_unknown)
+    {
+      record (p.string ().c_str (), p.size (), mt);
+    }
+
+    // Record a file written by the build.
+    //
+    void
+    record_output (const path&);
+
+    // Record a project source root directory.
+    //
+    void
+    record_root (const dir_path&);
+
+    // Record the path target files of the specified context and its nested
+    // contexts, treating those that were updated as outputs. Note that this
+    // function should only be called during serial execution.
+    //
+    void
+    record_targets (const context&);
+
+    // Write the snapshot with the specified key to the specified file
+    // querying the modification times with up to the specified number of
+    // threads. Issue a warning if unable to write. If any file other than an
+    // output has changed since it was recorded, then remove the snapshot
+    // instead. Note that this function should only be called during serial
+    // execution.
+    //
+    void
+    write (const path& file, const string& key, size_t threads) const;
+
+    // Return true if the snapshot with the specified key in the specified
+    // file exists and all the modification times it contains match the
+    // filesystem state. Any failure to load the snapshot is treated as a
+    // mismatch (and traced at verbosity level 4).
+    //
+    static bool
+    verify (const path& file, const string& key, size_t threads);
+
+    // Return the snapshot key for the specified command line, the build
+    // system version, the current working directory, and the environment.
+    //
+    static string
+    key (int argc, char* argv[]);
+
+  public:
+    explicit
+    build_snapshot (size_t shards);
+
+    build_snapshot (const build_snapshot&) = delete;
+    build_snapshot& operator= (const build_snapshot&) = delete;
+
+  private:
+    struct file_state
+    {
+      timestamp::rep mtime;  // When first recorded.
+      bool           output;
+    };
+
+    using map_type = std::unordered_map<string, file_state>;
+
+    struct shard
+    {
+      build2::mutex mutex;
+      map_type map;
+    };
+
+    unique_ptr<shard[]> shards_;
+    size_t shard_count_;
+
+    mutex mutex_;
+    dir_paths roots_; // Protected by mutex_.
+  };
+}
+
+#endif // LIBBUILD2_SNAPSHOT_HXX
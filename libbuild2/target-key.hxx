@@ -56,9 +56,12 @@ namespace build2
   inline bool
   operator== (const target_key& x, const target_key& y)
   {
-    if (x.type  != y.type ||
-        *x.dir  != *y.dir ||
-        *x.out  != *y.out ||
+    // Note that the directories are normally interned (see dir_pool) so we
+    // first compare them as pointers.
+    //
+    if (x.type  != y.type                      ||
+        (x.dir  != y.dir && *x.dir != *y.dir)  ||
+        (x.out  != y.out && *x.out != *y.out)  ||
         *x.name != *y.name)
       return false;
 
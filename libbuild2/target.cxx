@@ -81,10 +81,76 @@ namespace build2
   {
   }
 
+  // Each target allocation is prefixed with a header that records whether
+  // it came from the arena. The header size preserves the alignment (and
+  // the low pointer bits used for marking; see mark()).
+  //
+  static const size_t target_header_size (alignof (max_align_t));
+
+  static inline void*
+  target_header (void* p)
+  {
+    return static_cast<char*> (p) - target_header_size;
+  }
+
+  void* target::
+  operator new (size_t n)
+  {
+    char* p (static_cast<char*> (::operator new (n + target_header_size)));
+    *reinterpret_cast<bool*> (p) = false;
+    return p + target_header_size;
+  }
+
+  // The target arena slot of the current thread (see target_set::allocate()).
+  // Assigned round-robin on the first allocation with 0 meaning unassigned.
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  size_t target_arena_slot = 0;
+
+  static atomic<size_t> target_arena_slots (0);
+
+  void* target::
+  operator new (size_t n, context& ctx)
+  {
+    size_t& s (target_arena_slot);
+    if (s == 0)
+      s = target_arena_slots.fetch_add (1, memory_order_relaxed) + 1;
+
+    char* p (static_cast<char*> (
+               ctx.targets.allocate (n + target_header_size, s)));
+    *reinterpret_cast<bool*> (p) = true;
+    return p + target_header_size;
+  }
+
+  void target::
+  operator delete (void* p)
+  {
+    if (p != nullptr)
+    {
+      void* h (target_header (p));
+
+      // Arena memory is released all at once by the target set.
+      //
+      if (!*static_cast<bool*> (h))
+        ::operator delete (h);
+    }
+  }
+
+  void target::
+  operator delete (void* p, context&)
+  {
+    operator delete (p);
+  }
+
   const string& target::
   ext (string v)
   {
-    ulock l (ctx.targets.mutex_);
+    ulock l (*ext_mutex_);
 
     // Once the extension is set, it is immutable. However, it is possible
     // that someone has already "branded" this target with a different
@@ -118,9 +184,10 @@ namespace build2
   base_scope_impl () const
   {
     // If this target is from the src tree, use its out directory to find
-    // the scope.
+    // the scope. Note that target directories are interned.
     //
-    const scope& s (ctx.scopes.find_out (out_dir ()));
+    const scope& s (
+      ctx.scopes.find_out (static_cast<const interned_dir&> (out_dir ())));
 
     // Cache unless we are in the load phase.
     //
@@ -715,10 +782,29 @@ namespace build2
   {
     bool load (ctx.phase == run_phase::load);
 
-    slock sl (mutex_, defer_lock); if (!load) sl.lock ();
-    map_type::const_iterator i (map_.find (k));
+    // All the target directories are interned so if either is not, then
+    // there is no such target. Otherwise, switch to the interned key (see
+    // key_hash for details).
+    //
+    // Note that during load nothing can be interned concurrently (similar
+    // to the target map) so we skip locking the pool.
+    //
+    const interned_dir* d (ctx.dirs.find (*k.dir, load));
+    const interned_dir* o (d != nullptr
+                           ? ctx.dirs.find (*k.out, load)
+                           : nullptr);
 
-    if (i == map_.end ())
+    if (o == nullptr)
+      return nullptr;
+
+    target_key ik {k.type, d, o, k.name, k.ext};
+
+    const shard& s (find_shard (ik));
+
+    slock sl (s.mutex, defer_lock); if (!load) sl.lock ();
+    map_type::const_iterator i (s.map.find (ik));
+
+    if (i == s.map.end ())
       return nullptr;
 
     const target& t (*i->second);
@@ -739,7 +825,7 @@ namespace build2
         if (!load)
         {
           sl.unlock ();
-          ul = ulock (mutex_);
+          ul = ulock (s.mutex);
 
           if (ext) // Someone set the extension.
           {
@@ -800,17 +886,21 @@ namespace build2
 
       t = tt.factory (ctx, tt, move (dir), move (out), move (name));
 
-      // Re-lock for exclusive access. In the meantime, someone could have
-      // inserted this target so emplace() below could return false, in which
-      // case we proceed pretty much like find() except already under the
-      // exclusive lock.
+      // Note that the new target's directories are interned.
+      //
+      target_key k {&tt, &t->dir, &t->out, &t->name, e};
+      shard& s (find_shard (k));
+
+      // Re-lock the shard for exclusive access. In the meantime, someone
+      // could have inserted this target so emplace() below could return
+      // false, in which case we proceed pretty much like find() except
+      // already under the exclusive lock.
       //
-      ulock ul (mutex_, defer_lock);
+      ulock ul (s.mutex, defer_lock);
       if (ctx.phase != run_phase::load || need_lock)
         ul.lock ();
 
-      auto p (map_.emplace (target_key {&tt, &t->dir, &t->out, &t->name, e},
-                            unique_ptr<target> (t)));
+      auto p (s.map.emplace (move (k), unique_ptr<target> (t)));
 
       map_type::iterator i (p.first);
 
@@ -818,17 +908,18 @@ namespace build2
       {
 #if 0
         {
-          size_t n (map_.bucket_count ());
+          size_t n (s.map.bucket_count ());
           if (n > buckets_)
           {
             text << "target_set buckets: " << buckets_ << " -> " << n
-                 << " (" << map_.size () << ")";
+                 << " (" << s.map.size () << ")";
             buckets_ = n;
           }
         }
 #endif
 
         t->ext_ = &i->first.ext;
+        t->ext_mutex_ = &s.mutex;
         t->decl = decl;
         t->state.inner.target_ = t;
         t->state.outer.target_ = t;
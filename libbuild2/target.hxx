@@ -9,13 +9,13 @@
 #include <type_traits>  // is_*
 #include <unordered_map>
 
-#include <libbutl/multi-index.hxx> // map_iterator_adapter
-
 #include <libbuild2/types.hxx>
 #include <libbuild2/forward.hxx>
 #include <libbuild2/utility.hxx>
 
+#include <libbuild2/arena.hxx>
 #include <libbuild2/scope.hxx>
+#include <libbuild2/dir-pool.hxx>
 #include <libbuild2/action.hxx>
 #include <libbuild2/recipe.hxx>
 #include <libbuild2/context.hxx>
@@ -440,15 +440,23 @@ namespace build2
     // when src == out). We also treat out of project targets as being in the
     // out tree.
     //
-    const dir_path    dir;  // Absolute and normalized.
-    const dir_path    out;  // Empty or absolute and normalized.
+    // Note that dir and out are interned in the context's directory pool
+    // (see dir_pool for details).
+    //
+    const dir_path&   dir;  // Absolute and normalized.
+    const dir_path&   out;  // Empty or absolute and normalized.
     const string      name; // Empty for dir{} and fsdir{} targets.
     optional<string>* ext_; // Reference to value in target_key.
 
+    // Mutex of the target_set shard that contains this target (and thus
+    // protects ext_).
+    //
+    shared_mutex* ext_mutex_;
+
     const string* ext () const; // Return NULL if not specified.
     const string& ext (string);
 
-    // As above but assume targets mutex is locked.
+    // As above but assume the targets shard mutex is locked.
     //
     const string* ext_locked () const;
 
@@ -1416,7 +1424,9 @@ namespace build2
 
     target (context& c, dir_path d, dir_path o, string n)
         : ctx (c),
-          dir (move (d)), out (move (o)), name (move (n)),
+          dir (c.dirs.insert (move (d))),
+          out (c.dirs.insert (move (o))),
+          name (move (n)),
           vars (*this, false /* shared */),
           state (c)
     {
@@ -1432,6 +1442,29 @@ namespace build2
 
     virtual
     ~target ();
+
+    // Targets are normally allocated in the context's target arena (see
+    // target_set) with the target factories doing:
+    //
+    // return new (ctx) T (ctx, move (d), move (o), move (n));
+    //
+    // Such targets are freed all at once when the context is destroyed and
+    // deleting them only calls the destructor. Targets allocated with the
+    // plain new (for example, by factories of third-party modules) are
+    // allocated and freed individually, as usual.
+    //
+  public:
+    static void*
+    operator new (size_t);
+
+    static void*
+    operator new (size_t, context&);
+
+    static void
+    operator delete (void*);
+
+    static void
+    operator delete (void*, context&);
   };
 
   // All targets are from the targets set below.
@@ -1946,7 +1979,35 @@ namespace build2
   class LIBBUILD2_SYMEXPORT target_set
   {
   public:
-    using map_type = std::unordered_map<target_key, unique_ptr<target>>;
+    // The map keys always point to interned directories (see dir_pool) so
+    // we can use their precomputed hashes and compare them as pointers.
+    //
+    struct key_hash
+    {
+      size_t
+      operator() (const target_key& k) const noexcept
+      {
+        return combine_hash (
+          hash<const target_type*> () (k.type),
+          static_cast<const interned_dir*> (k.dir)->hash,
+          static_cast<const interned_dir*> (k.out)->hash,
+          hash<string> () (*k.name));
+      }
+    };
+
+    struct key_equal
+    {
+      bool
+      operator() (const target_key& x, const target_key& y) const
+      {
+        return x.dir == y.dir && x.out == y.out && x == y;
+      }
+    };
+
+    using map_type = std::unordered_map<target_key,
+                                        unique_ptr<target>,
+                                        key_hash,
+                                        key_equal>;
 
     // Return existing target or NULL.
     //
@@ -1984,9 +2045,25 @@ namespace build2
           const dir_path& out,
           const string& name) const
     {
-      slock l (mutex_, defer_lock); if (ctx.phase != run_phase::load) l.lock ();
-      auto i (map_.find (target_key {&type, &dir, &out, &name, nullopt}));
-      return i != map_.end () ? i->second.get () : nullptr;
+      bool load (ctx.phase == run_phase::load);
+
+      const interned_dir* d (ctx.dirs.find (dir, load));
+      const interned_dir* o (d != nullptr
+                             ? ctx.dirs.find (out, load)
+                             : nullptr);
+
+      if (o == nullptr)
+        return nullptr;
+
+      target_key k {&type, d, o, &name, nullopt};
+      const shard& s (find_shard (k));
+
+      slock l (s.mutex, defer_lock);
+      if (!load)
+        l.lock ();
+
+      auto i (s.map.find (k));
+      return i != s.map.end () ? i->second.get () : nullptr;
     }
 
     template <typename T>
@@ -1996,11 +2073,11 @@ namespace build2
       return static_cast<const T*> (find (T::static_type, dir, out, name));
     }
 
-    // If the target was inserted, keep the map exclusive-locked and return
-    // the lock. In this case, the target is effectively still being created
-    // since nobody can see it until the lock is released. Note that there
-    // is normally quite a bit of contention around this map so make sure to
-    // not hold the lock longer than absolutely necessary.
+    // If the target was inserted, keep the map shard exclusive-locked and
+    // return the lock. In this case, the target is effectively still being
+    // created since nobody can see it until the lock is released. Note that
+    // there could still be quite a bit of contention around the shard so
+    // make sure to not hold the lock longer than absolutely necessary.
     //
     // If skip_find is true, then don't first try to find an existing target
     // with a shared lock, instead going directly for the unique lock and
@@ -2094,35 +2171,209 @@ namespace build2
       return insert_implied<T> (dir, out, name, nullopt, t, skip_find);
     }
 
-    // Note: not MT-safe so can only be used during serial execution.
+  private:
+    // The map is split into shards (with the shard selected by the target
+    // key hash), each protected by its own mutex, to reduce contention
+    // during parallel match (think header dependency extraction entering
+    // thousands of h{} targets).
     //
+    struct shard
+    {
+      mutable shared_mutex mutex;
+      map_type map;
+    };
+
   public:
-    using iterator = butl::map_iterator_adapter<map_type::iterator>;
-    using const_iterator = butl::map_iterator_adapter<map_type::const_iterator>;
+    template <typename S, typename I>
+    class iterator_impl
+    {
+    public:
+      using value_type        = unique_ptr<target>;
+      using reference         = decltype ((std::declval<I> ()->second));
+      using pointer           = decltype (&std::declval<I> ()->second);
+      using difference_type   = std::ptrdiff_t;
+      using iterator_category = std::forward_iterator_tag;
+
+      iterator_impl () = default;
+      iterator_impl (S* b, S* e)
+          : s_ (b), e_ (e)
+      {
+        if (s_ != e_)
+        {
+          i_ = s_->map.begin ();
+          skip ();
+        }
+      }
+
+      // Allow iterator to const_iterator conversion.
+      //
+      template <typename S1, typename I1>
+      iterator_impl (const iterator_impl<S1, I1>& x)
+          : s_ (x.s_), e_ (x.e_), i_ (x.i_) {}
+
+      reference operator* () const {return i_->second;}
+      pointer  operator-> () const {return &i_->second;}
+
+      iterator_impl& operator++ () {++i_; skip (); return *this;}
+      iterator_impl  operator++ (int) {auto r (*this); operator++ (); return r;}
+
+      friend bool
+      operator== (const iterator_impl& x, const iterator_impl& y)
+      {
+        return x.s_ == y.s_ && (x.s_ == x.e_ || x.i_ == y.i_);
+      }
 
-    iterator begin () {return map_.begin ();}
-    iterator end ()   {return map_.end ();}
+      friend bool
+      operator!= (const iterator_impl& x, const iterator_impl& y)
+      {
+        return !(x == y);
+      }
 
-    const_iterator begin () const {return map_.begin ();}
-    const_iterator end ()   const {return map_.end ();}
+    private:
+      template <typename, typename>
+      friend class iterator_impl;
+
+      // Skip over the exhausted shards.
+      //
+      void
+      skip ()
+      {
+        while (i_ == s_->map.end ())
+        {
+          if (++s_ == e_)
+            break;
+
+          i_ = s_->map.begin ();
+        }
+      }
+
+      S* s_ = nullptr;
+      S* e_ = nullptr;
+      I  i_;
+    };
+
+    // Note: not MT-safe so can only be used during serial execution.
+    //
+    // Iteration is over all the shards in turn with the order being
+    // unspecified.
+    //
+    using iterator = iterator_impl<shard, map_type::iterator>;
+    using const_iterator = iterator_impl<const shard,
+                                         map_type::const_iterator>;
+
+    iterator begin () {return iterator (shards_.get (), shards_end ());}
+    iterator end ()   {return iterator (shards_end (), shards_end ());}
+
+    const_iterator begin () const
+    {
+      return const_iterator (shards_.get (), shards_end ());
+    }
+
+    const_iterator end () const
+    {
+      return const_iterator (shards_end (), shards_end ());
+    }
 
     size_t
-    size () const {return map_.size ();}
+    size () const
+    {
+      size_t r (0);
+      for (size_t i (0); i != shard_count_; ++i)
+        r += shards_[i].map.size ();
+      return r;
+    }
 
+    // Destroy all the targets and release the target arenas.
+    //
+    // Note that a target can be allocated in an arena other than its shard's
+    // (see allocate()) so we have to destroy all the targets first.
+    //
     void
-    clear () {map_.clear ();}
+    clear ()
+    {
+      for (size_t i (0); i != shard_count_; ++i)
+        shards_[i].map.clear ();
+
+      for (size_t i (0); i != shard_count_; ++i)
+        arenas_[i].clear ();
+    }
+
+    // Number of bytes allocated for targets (see target::operator new()).
+    //
+    size_t
+    arena_capacity () const
+    {
+      size_t r (0);
+      for (size_t i (0); i != shard_count_; ++i)
+        r += arenas_[i].capacity ();
+      return r;
+    }
 
   private:
-    friend class target; // Access to mutex.
+    friend class target; // Access to allocate().
     friend class context;
 
-    explicit
-    target_set (context& c): ctx (c) {}
+    target_set (context& c, size_t shards)
+        : ctx (c),
+          arenas_ (new arena[shards]),
+          shards_ (new shard[shards]),
+          shard_count_ (shards) {}
+
+    // Allocate memory for a target from the arena corresponding to the
+    // specified slot.
+    //
+    // There is an arena for each shard so that allocation scales the same
+    // way as insertion. However, the target key (and thus the shard) is not
+    // yet known at the time of allocation so instead the arena is selected
+    // by the allocating thread (see target::operator new()). Besides
+    // reducing contention, this keeps the targets created by the same
+    // thread next to each other.
+    //
+    void*
+    allocate (size_t n, size_t slot)
+    {
+      return arenas_[slot % shard_count_].allocate (n);
+    }
+
+    // Note that the same hash is used by the shard's map so we mix in the
+    // high bits to avoid the keys in a shard clustering in its buckets.
+    //
+    // Note also that the key must be interned.
+    //
+    size_t
+    shard_index (const target_key& k) const
+    {
+      size_t h (key_hash () (k));
+      return (h ^ (h >> 17)) % shard_count_;
+    }
+
+    shard&
+    find_shard (const target_key& k) {return shards_[shard_index (k)];}
+
+    const shard&
+    find_shard (const target_key& k) const {return shards_[shard_index (k)];}
+
+    shard*
+    shards_end () const {return shards_.get () + shard_count_;}
+
+    // Reserve elements in each shard assuming uniform distribution.
+    //
+    void
+    reserve (size_t n)
+    {
+      n = n / shard_count_ + 1;
+      for (size_t i (0); i != shard_count_; ++i)
+        shards_[i].map.reserve (n);
+    }
 
     context& ctx;
 
-    mutable shared_mutex mutex_;
-    map_type map_;
+    // Note: must be destroyed after the shards (and thus the targets).
+    //
+    unique_ptr<arena[]> arenas_;
+
+    unique_ptr<shard[]> shards_;
+    size_t shard_count_;
 
 #if 0
     size_t buckets_ = 0;
@@ -2706,7 +2957,7 @@ namespace build2
   target_factory (context& c,
                   const target_type&, dir_path d, dir_path o, string n)
   {
-    return new T (c, move (d), move (o), move (n));
+    return new (c) T (c, move (d), move (o), move (n));
   }
 
   // Return fixed target extension unless one was specified.
@@ -162,7 +162,7 @@ namespace build2
   inline const string* target::
   ext () const
   {
-    slock l (ctx.targets.mutex_);
+    slock l (*ext_mutex_);
     return ext_locked ();
   }
 
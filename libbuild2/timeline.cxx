@@ -0,0 +1,290 @@
+// file      : libbuild2/timeline.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/timeline.hxx>
+
+#include <sstream>
+
+#include <libbuild2/target.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  timeline* timeline::instance = nullptr;
+
+  static inline uint64_t
+  steady_ns ()
+  {
+    return static_cast<uint64_t> (
+      chrono::duration_cast<chrono::nanoseconds> (
+        chrono::steady_clock::now ().time_since_epoch ()).count ());
+  }
+
+  // Current thread's buffer for the timeline instance with the specified id
+  // (see profile.cxx for background).
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  void* timeline_thread_data = nullptr;
+
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  uint64_t timeline_thread_id = 0;
+
+  static atomic<uint64_t> timeline_next_id (1);
+
+  timeline::
+  timeline ()
+      : id_ (timeline_next_id.fetch_add (1, memory_order_relaxed)),
+        start_ (steady_ns ())
+  {
+  }
+
+  timeline::
+  ~timeline ()
+  {
+  }
+
+  inline uint64_t timeline::
+  now () const
+  {
+    return steady_ns () - start_;
+  }
+
+  timeline::thread_data& timeline::
+  data ()
+  {
+    if (timeline_thread_id == id_)
+      return *static_cast<thread_data*> (timeline_thread_data);
+
+    mlock l (mutex_);
+
+    // Thread ids start from 1 with 0 reserved for the phase pseudo-thread.
+    //
+    threads_.push_back (unique_ptr<thread_data> (new thread_data));
+
+    thread_data& d (*threads_.back ());
+    d.tid = threads_.size ();
+    d.events.reserve (4096);
+
+    timeline_thread_data = &d;
+    timeline_thread_id = id_;
+
+    return d;
+  }
+
+  void timeline::
+  begin (span& s, const char* cat, const char* n)
+  {
+    s.timeline_ = this;
+    s.cat_ = cat;
+    s.name_ = n;
+    s.start_ = now ();
+  }
+
+  void timeline::
+  begin (span& s, const char* cat, const target& t)
+  {
+    ostringstream os;
+    os << t;
+
+    s.timeline_ = this;
+    s.cat_ = cat;
+    s.name_ = os.str ();
+    s.start_ = now ();
+  }
+
+  void timeline::
+  begin (span& s, const char* cat, const path_name& n)
+  {
+    ostringstream os;
+    os << n;
+
+    s.timeline_ = this;
+    s.cat_ = cat;
+    s.name_ = os.str ();
+    s.start_ = now ();
+  }
+
+  void timeline::
+  end (span& s)
+  {
+    uint64_t e (now ());
+    data ().events.push_back (
+      event {'X', s.cat_, move (s.name_), s.start_, e - s.start_});
+  }
+
+  void timeline::
+  process_start (uint64_t id, const char* n)
+  {
+    data ().events.push_back (event {'b', "process", n, now (), id});
+  }
+
+  void timeline::
+  process_finish (uint64_t id, const char* n)
+  {
+    data ().events.push_back (event {'e', "process", n, now (), id});
+  }
+
+  static const char*
+  phase_name (run_phase p)
+  {
+    switch (p)
+    {
+    case run_phase::load:    return "load";
+    case run_phase::match:   return "match";
+    case run_phase::execute: return "execute";
+    }
+
+    return "";
+  }
+
+  void timeline::
+  phase (run_phase p)
+  {
+    uint64_t t (now ());
+
+    mlock l (mutex_);
+
+    if (phase_)
+    {
+      if (*phase_ == p)
+        return;
+
+      phases_.push_back (
+        event {'X', "phase", phase_name (*phase_), phase_start_,
+               t - phase_start_});
+    }
+
+    phase_ = p;
+    phase_start_ = t;
+  }
+
+  // Write a JSON string literal.
+  //
+  static void
+  write_string (ostream& os, const string& s)
+  {
+    os << '"';
+
+    for (char c: s)
+    {
+      switch (c)
+      {
+      case '"':  os << "\\\""; break;
+      case '\\': os << "\\\\"; break;
+      case '\n': os << "\\n";  break;
+      case '\t': os << "\\t";  break;
+      default:
+        {
+          if (static_cast<unsigned char> (c) < 0x20)
+          {
+            const char* h ("0123456789abcdef");
+            os << "\\u00" << h[(c >> 4) & 0x0f] << h[c & 0x0f];
+          }
+          else
+            os << c;
+        }
+      }
+    }
+
+    os << '"';
+  }
+
+  // Write nanoseconds as fractional microseconds (the trace format unit).
+  //
+  static void
+  write_us (ostream& os, uint64_t ns)
+  {
+    uint64_t f (ns % 1000);
+
+    os << ns / 1000 << '.'
+       << static_cast<char> ('0' + f / 100)
+       << static_cast<char> ('0' + f / 10 % 10)
+       << static_cast<char> ('0' + f % 10);
+  }
+
+  static void
+  write_event (ostream& os, bool& first, uint64_t tid,
+               char ph, const char* cat, const string& n,
+               uint64_t ts, uint64_t dur)
+  {
+    os << (first ? "\n" : ",\n");
+    first = false;
+
+    os << "{\"ph\":\"" << ph << "\",\"pid\":1,\"tid\":" << tid
+       << ",\"cat\":\"" << cat << "\",\"name\":";
+    write_string (os, n);
+
+    os << ",\"ts\":";
+    write_us (os, ts);
+
+    if (ph == 'X')
+    {
+      os << ",\"dur\":";
+      write_us (os, dur);
+    }
+    else
+      os << ",\"id\":" << dur;
+
+    os << '}';
+  }
+
+  static void
+  write_thread_name (ostream& os, bool& first, uint64_t tid, const string& n)
+  {
+    os << (first ? "\n" : ",\n");
+    first = false;
+
+    os << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+       << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    write_string (os, n);
+    os << "}}";
+  }
+
+  void timeline::
+  write (const path& f) const
+  {
+    uint64_t t (now ());
+
+    mlock l (mutex_);
+
+    ofdstream os (f);
+
+    os << "{\"traceEvents\":[";
+
+    bool first (true);
+
+    write_thread_name (os, first, 0, "phase");
+
+    for (const event& e: phases_)
+      write_event (os, first, 0, e.ph, e.cat, e.name, e.ts, e.dur);
+
+    if (phase_)
+      write_event (os, first, 0, 'X', "phase", phase_name (*phase_),
+                   phase_start_, t - phase_start_);
+
+    for (const unique_ptr<thread_data>& d: threads_)
+    {
+      write_thread_name (
+        os, first, d->tid, "thread " + std::to_string (d->tid));
+
+      for (const event& e: d->events)
+        write_event (os, first, d->tid, e.ph, e.cat, e.name, e.ts, e.dur);
+    }
+
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    os.close ();
+  }
+}
@@ -0,0 +1,165 @@
+// file      : libbuild2/timeline.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_TIMELINE_HXX
+#define LIBBUILD2_TIMELINE_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Build timeline recording in the Chrome trace event format (see
+  // --trace-file).
+  //
+  // The following events are recorded:
+  //
+  // load     -- buildfile loading (one per sourced buildfile)
+  // match    -- target match (rule match and apply)
+  // execute  -- target execution
+  // suspend  -- scheduler thread suspended waiting for a task count
+  // process  -- external process from run_start() to run_finish() (async)
+  // phase    -- run phase (on a separate pseudo-thread)
+  //
+  // The events are recorded into per-thread buffers without any
+  // synchronization and are only written out at the end (see write()) when
+  // the build is quiescent, normally after the scheduler shutdown.
+  //
+  // Because some of the places that record events don't have access to the
+  // build context (for example, run_start() or the scheduler), the timeline
+  // is process-wide with the instance pointer being set by the driver before
+  // starting up the scheduler and cleared after shutting it down.
+  //
+  class LIBBUILD2_SYMEXPORT timeline
+  {
+  public:
+    // The global instance or NULL if not recording.
+    //
+    static timeline* instance;
+
+    // Record a complete event for the lifetime of this object. If not
+    // recording, then this is a noop.
+    //
+    class span
+    {
+    public:
+      span (const char* cat, const char* name)
+      {
+        if (timeline* t = instance)
+          t->begin (*this, cat, name);
+      }
+
+      span (const char* cat, const target& t)
+      {
+        if (timeline* tl = instance)
+          tl->begin (*this, cat, t);
+      }
+
+      span (const char* cat, const path_name& n)
+      {
+        if (timeline* t = instance)
+          t->begin (*this, cat, n);
+      }
+
+      ~span ()
+      {
+        if (timeline_ != nullptr)
+          timeline_->end (*this);
+      }
+
+      span (const span&) = delete;
+      span& operator= (const span&) = delete;
+
+    private:
+      friend class timeline;
+
+      timeline*   timeline_ = nullptr;
+      const char* cat_;
+      string      name_;
+      uint64_t    start_;
+    };
+
+    // Record the start and finish of an external process. The id should be
+    // unique among the concurrently running processes (for example, the
+    // process id).
+    //
+    void
+    process_start (uint64_t id, const char* name);
+
+    void
+    process_finish (uint64_t id, const char* name);
+
+    // Record a switch to the specified run phase.
+    //
+    void
+    phase (run_phase);
+
+    // Write the recorded events to the specified file. Throw io_error on
+    // failure.
+    //
+    void
+    write (const path&) const;
+
+  public:
+    timeline ();
+    ~timeline ();
+
+    timeline (const timeline&) = delete;
+    timeline& operator= (const timeline&) = delete;
+
+  private:
+    void
+    begin (span&, const char*, const char*);
+
+    void
+    begin (span&, const char*, const target&);
+
+    void
+    begin (span&, const char*, const path_name&);
+
+    void
+    end (span&);
+
+    uint64_t
+    now () const; // Nanoseconds since start.
+
+    struct event
+    {
+      char        ph;   // Event type ('X', 'b', or 'e').
+      const char* cat;
+      string      name;
+      uint64_t    ts;   // Start time (ns).
+      uint64_t    dur;  // Duration (ns) or id for async events.
+    };
+
+    struct thread_data
+    {
+      uint64_t      tid;
+      vector<event> events;
+    };
+
+    thread_data&
+    data ();
+
+  private:
+    uint64_t id_;    // Unique instance id (see data()).
+    uint64_t start_; // Steady clock time (ns) of the instance creation.
+
+    mutable mutex mutex_;
+
+    // Per-thread event buffers (the vector is protected by mutex_).
+    //
+    vector<unique_ptr<thread_data>> threads_;
+
+    // Phase events (protected by mutex_).
+    //
+    vector<event> phases_;
+    optional<run_phase> phase_;
+    uint64_t phase_start_;
+  };
+}
+
+#endif // LIBBUILD2_TIMELINE_HXX
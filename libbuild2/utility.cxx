@@ -23,6 +23,8 @@
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/snapshot.hxx>
+#include <libbuild2/timeline.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbuild2/script/regex.hxx> // script::regex::init()
@@ -167,6 +169,10 @@ namespace build2
   optional<path> config_sub;
   optional<path> config_guess;
 
+  optional<dir_path> guess_cache;
+
+  size_t mtime_prefetch_threads;
+
   void
   check_build_version (const standard_version_constraint& c, const location& l)
   {
@@ -234,11 +240,29 @@ namespace build2
     return p.representation ();
   }
 
+  // Record the program in the build snapshot, if any (see build_snapshot
+  // for details).
+  //
+  static inline process_path
+  snapshot_program (process_path&& pp)
+  {
+    if (build_snapshot* s = build_snapshot::instance)
+    {
+      const char* p (pp.effect_string ());
+
+      if (p != nullptr && *p != '\0')
+        s->record (p, strlen (p));
+    }
+
+    return move (pp);
+  }
+
   process_path
   run_search (const char*& args0, bool path_only, const location& l)
   try
   {
-    return process::path_search (args0, dir_path () /* fallback */, path_only);
+    return snapshot_program (
+      process::path_search (args0, dir_path () /* fallback */, path_only));
   }
   catch (const process_error& e)
   {
@@ -253,7 +277,8 @@ namespace build2
               const location& l)
   try
   {
-    return process::path_search (f, init, fallback, path_only);
+    return snapshot_program (
+      process::path_search (f, init, fallback, path_only));
   }
   catch (const process_error& e)
   {
@@ -267,7 +292,8 @@ namespace build2
                   bool path_only,
                   const char* paths)
   {
-    return process::try_path_search (f, init, fallback, path_only, paths);
+    return snapshot_program (
+      process::try_path_search (f, init, fallback, path_only, paths));
   }
 
   [[noreturn]] void
@@ -277,6 +303,18 @@ namespace build2
              << endf;
   }
 
+  // Process id for the timeline async events (see --trace-file).
+  //
+  static inline uint64_t
+  timeline_id (const process& pr)
+  {
+#ifndef _WIN32
+    return static_cast<uint64_t> (pr.handle);
+#else
+    return reinterpret_cast<uintptr_t> (pr.handle);
+#endif
+  }
+
   process
   run_start (uint16_t verbosity,
              const process_env& pe,
@@ -292,7 +330,7 @@ namespace build2
     if (verb >= verbosity)
       print_process (pe, args, 0);
 
-    return process (
+    process pr (
       *pe.path,
       args,
       in,
@@ -300,6 +338,11 @@ namespace build2
       err,
       pe.cwd != nullptr ? pe.cwd->string ().c_str () : nullptr,
       pe.vars);
+
+    if (timeline* t = timeline::instance)
+      t->process_start (timeline_id (pr), args[0]);
+
+    return pr;
   }
   catch (const process_error& e)
   {
@@ -341,6 +384,15 @@ namespace build2
   {
     tracer trace ("run_finish");
 
+    // Note: the process handle may be reset by wait().
+    //
+    auto tg (make_guard (
+      [args, t = timeline::instance, id = timeline_id (pr)] ()
+      {
+        if (t != nullptr)
+          t->process_finish (id, args[0]);
+      }));
+
     try
     {
       if (pr.wait ())
@@ -409,6 +461,15 @@ namespace build2
                    bool on,
                    const location& loc)
   {
+    // Note: see run_finish_impl() above.
+    //
+    auto tg (make_guard (
+      [args, t = timeline::instance, id = timeline_id (pr)] ()
+      {
+        if (t != nullptr)
+          t->process_finish (id, args[0]);
+      }));
+
     try
     {
       pr.wait ();
@@ -986,7 +1047,9 @@ namespace build2
         optional<size_t> ms,
         optional<bool> mc,
         optional<path> cs,
-        optional<path> cg)
+        optional<path> cg,
+        optional<dir_path> gc,
+        size_t mp)
   {
     terminate = t;
 
@@ -1041,6 +1104,9 @@ namespace build2
 
     config_sub = move (cs);
     config_guess = move (cg);
+    guess_cache = move (gc);
+
+    mtime_prefetch_threads = mp;
 
     // Figure out work and home directories.
     //
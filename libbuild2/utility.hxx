@@ -186,7 +186,9 @@ namespace build2
         optional<size_t> max_stack = nullopt,
         optional<bool> mtime_check = nullopt,
         optional<path> config_sub = nullopt,
-        optional<path> config_guess = nullopt);
+        optional<path> config_guess = nullopt,
+        optional<dir_path> guess_cache = nullopt,
+        size_t mtime_prefetch = 0);
 
   // Terminate function. If trace is false, then printing of the stack trace,
   // if any, should be omitted.
@@ -236,6 +238,14 @@ namespace build2
   LIBBUILD2_SYMEXPORT extern optional<path> config_sub;   // --config-sub
   LIBBUILD2_SYMEXPORT extern optional<path> config_guess; // --config-guess
 
+  // --guess-cache (see <libbuild2/guess-cache.hxx>)
+  //
+  LIBBUILD2_SYMEXPORT extern optional<dir_path> guess_cache;
+
+  // --mtime-prefetch (see <libbuild2/mtime-prefetch.hxx>)
+  //
+  LIBBUILD2_SYMEXPORT extern size_t mtime_prefetch_threads;
+
   LIBBUILD2_SYMEXPORT void
   check_build_version (const standard_version_constraint&, const location&);
 
@@ -2665,6 +2665,20 @@ namespace build2
     nullptr                            // Iterate.
   };
 
+  // variable
+  //
+  size_t
+  variable_id (const string& n)
+  {
+    // Note: function-local to sidestep the static initialization order.
+    //
+    static mutex m;
+    static unordered_map<string, size_t> ids;
+
+    mlock l (m);
+    return ids.emplace (n, ids.size () + 1).first->second;
+  }
+
   // variable_pool
   //
   void variable_pool::
@@ -2734,6 +2748,11 @@ namespace build2
     {
       assert (*v > var.visibility);
       var.visibility = *v;
+
+      // Invalidate the scope variable lookup cache.
+      //
+      if (shared_ != nullptr)
+        shared_->var_generation++;
     }
   }
 
@@ -3063,7 +3082,8 @@ namespace build2
       : shared_ (shared),
         owner_ (owner::scope), prereq_ (&p),
         ctx (&p.scope.ctx),
-        m_ (move (v.m_))
+        m_ (move (v.m_)),
+        index_ (move (v.index_))
   {
   }
 
@@ -3074,6 +3094,40 @@ namespace build2
         ctx (&p.scope.ctx),
         m_ (v.m_)
   {
+    reindex ();
+  }
+
+  auto variable_map::
+  find_value (const variable& var) const -> const value_data*
+  {
+    // Fallback to the map for a variable without an id (which is not
+    // something that we expect to be stored in the map but let's handle
+    // gracefully).
+    //
+    if (var.id == 0)
+    {
+      auto i (m_.find (var));
+      return i != m_.end () ? &i->second : nullptr;
+    }
+
+    auto i (lower_bound (index_.begin (), index_.end (), var.id, index_less));
+    return i != index_.end () && i->id == var.id ? i->value : nullptr;
+  }
+
+  void variable_map::
+  reindex ()
+  {
+    index_.clear ();
+    index_.reserve (m_.size ());
+
+    for (auto& p: m_)
+      index_.push_back (index_entry {p.first.get ().id, &p.second});
+
+    sort (index_.begin (), index_.end (),
+          [] (const index_entry& x, const index_entry& y)
+          {
+            return x.id < y.id;
+          });
   }
 
   lookup variable_map::
@@ -3107,12 +3161,8 @@ namespace build2
       //    This can happen if the values were entered before the variables
       //    were aliased. Possible but probably highly unlikely.
       //
-      auto i (m_.find (*v));
-      if (i != m_.end ())
-      {
-        r = &i->second;
+      if ((r = find_value (*v)) != nullptr)
         break;
-      }
 
       if (aliased)
         v = v->aliases;
@@ -3165,7 +3215,28 @@ namespace build2
     auto p (m_.emplace (var, value_data (typed ? var.type : nullptr)));
     value_data& r (p.first->second);
 
-    if (!p.second)
+    if (p.second)
+    {
+      size_t id (p.first->first.get ().id);
+
+      try
+      {
+        index_.insert (
+          lower_bound (index_.begin (), index_.end (), id, index_less),
+          index_entry {id, &r});
+      }
+      catch (...)
+      {
+        m_.erase (p.first);
+        throw;
+      }
+
+      // Invalidate the scope variable lookup cache.
+      //
+      if (owner_ == owner::scope)
+        ctx->var_generation++;
+    }
+    else
     {
       if (reset_extra)
         r.extra = 0;
@@ -3203,7 +3274,12 @@ namespace build2
   {
     assert (!shared_ || ctx->phase == run_phase::load);
 
-    return m_.erase (var) != 0;
+    auto i (m_.find (var));
+    if (i == m_.end ())
+      return false;
+
+    erase (const_iterator (i, *this));
+    return true;
   }
 
   variable_map::const_iterator variable_map::
@@ -3211,6 +3287,17 @@ namespace build2
   {
     assert (!shared_ || ctx->phase == run_phase::load);
 
+    const value_data* v (&i.untyped ().second);
+    size_t id (i.untyped ().first.get ().id);
+
+    auto j (lower_bound (index_.begin (), index_.end (), id, index_less));
+
+    assert (j != index_.end () && j->value == v);
+    index_.erase (j);
+
+    if (owner_ == owner::scope)
+      ctx->var_generation++;
+
     return const_iterator (m_.erase (i), *this);
   }
 
@@ -3222,7 +3309,7 @@ namespace build2
     // Note that this variable map is special and we use context as its owner
     // (see variable_map for details).
     //
-    auto r (map_.emplace (pattern {type, false, move (text), {}},
+    auto r (map_.emplace (pattern {type, false, move (text), {}, {}},
                           variable_map (ctx, shared_)));
 
     // Compile the regex.
@@ -3254,14 +3341,59 @@ namespace build2
         }
       }
 
-      // Skip leading delimiter as well as trailing delimiter and flags.
+      // Skip leading delimiter as well as trailing delimiter and flags. Fall
+      // back to std::regex if the pattern is not supported by linear_regex
+      // (which will also diagnose it if invalid).
       //
-      r.first->first.regex = regex (t.c_str () + 1, p - 1, f);
+      r.first->first.lregex = linear_regex::compile (
+        string (t, 1, p - 1), (f & regex::icase) != 0);
+
+      if (!r.first->first.lregex)
+        r.first->first.regex = regex (t.c_str () + 1, p - 1, f);
+    }
+    // Determine the literal prefix and suffix. To keep things simple we
+    // don't bother with patterns that contain directory separators.
+    //
+    else if (r.second)
+    {
+      const pattern& pat (r.first->first);
+      const string& t (pat.text);
+
+      if (t.find_first_of (path::traits_type::directory_separators) ==
+          string::npos)
+      {
+        size_t p (t.find_first_of ("*?["));
+
+        if (p == string::npos)
+          pat.prefix = t.size ();
+        else
+        {
+          pat.prefix = p;
+          pat.suffix = t.size () - t.find_last_of ("*?[]") - 1;
+        }
+      }
     }
 
     return r.first->second;
   }
 
+  // Return false if the name cannot match the path pattern based on its
+  // literal prefix and suffix.
+  //
+  static inline bool
+  literal_match (const string& n, const variable_pattern_map::pattern& pat)
+  {
+    using traits = path::traits_type;
+
+    const string& t (pat.text);
+    size_t nn (n.size ()), tn (t.size ()), p (pat.prefix), s (pat.suffix);
+
+    return nn >= p + s                                                 &&
+           traits::compare (n.c_str (), p, t.c_str (), p) == 0         &&
+           traits::compare (n.c_str () + nn - s, s,
+                            t.c_str () + tn - s, s) == 0;
+  }
+
   // variable_type_map
   //
   lookup variable_type_map::
@@ -3271,18 +3403,87 @@ namespace build2
   {
     // Compute and cache "effective" name that we will be matching.
     //
-    // See also the additional match_ext logic below.
+    if (!oname)
+    {
+      oname = string ();
+      tk.effective_name (*oname);
+    }
+
+    bool named (oname->empty ());
+    const string& n (named ? *tk.name : *oname);
+
+    // Find or calculate the matching pattern blocks.
+    //
+    shared_mutex& m (
+      ctx.mutexes->variable_cache[
+        hash<const variable_type_map*> () (this) %
+        ctx.mutexes->variable_cache_size]);
+
+    const memo_blocks* bs (nullptr);
+    {
+      slock l (m);
+
+      auto i (memo_.find (memo_query {tk.type, n, tk.ext, named}));
+      if (i != memo_.end ())
+        bs = &i->second;
+    }
+
+    if (bs == nullptr)
+    {
+      memo_blocks r (match (tk, n, named));
+
+      // Note that it is possible that someone else has inserted the entry
+      // while we were matching, in which case we just use theirs. Note also
+      // that the memo entries are only removed during the load phase so we
+      // can use the reference after unlocking.
+      //
+      ulock l (m);
+      bs = &memo_.emplace (memo_key {tk.type, n, tk.ext, named},
+                           move (r)).first->second;
+    }
+
+    // Ok, these patterns match. But is there a variable?
+    //
+    // Since we store append/prepend values untyped, instruct find() not to
+    // automatically type it. And if it is assignment, then typify it
+    // ourselves.
     //
-    auto name = [&tk, &oname] () -> const string&
+    for (const memo_block& b: *bs)
     {
-      if (!oname)
+      const variable_map& vm (*b.vars);
+      auto p (vm.lookup (var, false));
+      if (const variable_map::value_data* v = p.first)
       {
-        oname = string ();
-        tk.effective_name (*oname);
+        // Check if this is the first access after being assigned a type.
+        //
+        if (v->extra == 0 && var.type != nullptr)
+          vm.typify (*v, var);
+
+        // Return the name that was used for the match (it is used as a
+        // cache key for append/prepend).
+        //
+        if (b.ext)
+        {
+          *oname = *tk.name;
+          *oname += '.';
+          *oname += *tk.ext;
+        }
+
+        return lookup (*v, p.second, vm);
       }
+    }
 
-      return oname->empty () ? *tk.name : *oname;
-    };
+    return lookup ();
+  }
+
+  variable_type_map::memo_blocks variable_type_map::
+  match (const target_key& tk, const string& n, bool named) const
+  {
+    memo_blocks bs;
+
+    // Name with the extension for the match_ext patterns.
+    //
+    optional<string> en;
 
     // Search across target type hierarchy.
     //
@@ -3306,62 +3507,32 @@ namespace build2
         bool r, e (false);
         if (pat.type == pattern_type::path)
         {
-          r = pat.text == "*" || butl::path_match (name (), pat.text);
+          r = pat.text == "*" ||
+              (literal_match (n, pat) && butl::path_match (n, pat.text));
         }
         else
         {
-          const string& n (name ());
-
           // Deal with match_ext: first see if the extension would be added by
-          // default. If not, then temporarily add it in oname and then clean
-          // it up if there is no match (to prevent another pattern from using
-          // it). While we may keep adding it if there are multiple patterns
-          // with such a flag, we will at least reuse the buffer in oname.
+          // default. If not, then match the name with the extension added.
           //
-          e = pat.match_ext && tk.ext && !tk.ext->empty () && oname->empty ();
-          if (e)
+          e = pat.match_ext && tk.ext && !tk.ext->empty () && named;
+          if (e && !en)
           {
-            *oname = *tk.name;
-            *oname += '.';
-            *oname += *tk.ext;
+            en = *tk.name;
+            *en += '.';
+            *en += *tk.ext;
           }
 
-          r = regex_match (e ? *oname : n, *pat.regex);
+          const string& s (e ? *en : n);
+          r = pat.lregex ? pat.lregex->match (s) : regex_match (s, *pat.regex);
         }
 
-        // Ok, this pattern matches. But is there a variable?
-        //
-        // Since we store append/prepend values untyped, instruct find() not
-        // to automatically type it. And if it is assignment, then typify it
-        // ourselves.
-        //
         if (r)
-        {
-          const variable_map& vm (j->second);
-          auto p (vm.lookup (var, false));
-          if (const variable_map::value_data* v = p.first)
-          {
-            // Check if this is the first access after being assigned a type.
-            //
-            if (v->extra == 0 && var.type != nullptr)
-              vm.typify (*v, var);
-
-            // Make sure the effective name is computed if this is
-            // append/prepend (it is used as a cache key).
-            //
-            if (v->extra != 0 && !oname)
-              name ();
-
-            return lookup (*v, p.second, vm);
-          }
-        }
-
-        if (e)
-          oname->clear ();
+          bs.push_back (memo_block {&j->second, e});
       }
     }
 
-    return lookup ();
+    return bs;
   }
 
   template struct LIBBUILD2_DEFEXPORT value_traits<strings>;
@@ -20,6 +20,7 @@
 #include <libbuild2/context.hxx>
 #include <libbuild2/target-type.hxx>
 #include <libbuild2/diagnostics.hxx>
+#include <libbuild2/linear-regex.hxx>
 
 #include <libbuild2/export.hxx>
 
@@ -256,6 +257,10 @@ namespace build2
   // Untyped (NULL type) and project visibility are the defaults but can be
   // overridden by "tighter" values.
   //
+  // The id is a dense integer assigned to the variable name (see
+  // variable_id() below) when the variable is entered into the pool. It is
+  // used as a key in variable_map to avoid comparing names.
+  //
   struct variable
   {
     string name;
@@ -264,6 +269,7 @@ namespace build2
     const value_type* type;                // If NULL, then not (yet) typed.
     unique_ptr<const variable> overrides;
     variable_visibility visibility;
+    size_t id = 0;                         // 0 if not assigned.
 
     // Return true if this variable is an alias of the specified variable.
     //
@@ -315,6 +321,16 @@ namespace build2
   inline bool
   operator== (const variable& x, const variable& y) {return x.name == y.name;}
 
+  // Return the id for the variable name, assigning a new one if necessary.
+  //
+  // Note that variables are compared by name (see above) and variables with
+  // the same name can be found in different pools (for example, project-
+  // private or in different contexts). So the ids are assigned per name and
+  // are process-wide. This function is MT-safe.
+  //
+  LIBBUILD2_SYMEXPORT size_t
+  variable_id (const string& name);
+
   inline ostream&
   operator<< (ostream& os, const variable& v) {return os << v.name;}
 
@@ -1665,6 +1681,7 @@ namespace build2
         }
 #endif
         r.first->first.p = &r.first->second.name;
+        r.first->second.id = variable_id (r.first->second.name);
       }
 
       return r;
@@ -1926,6 +1943,8 @@ namespace build2
     pair<value_data*, const variable&>
     lookup_to_modify (const variable&, bool typed = true);
 
+    // Note: uses the variable name rather than id.
+    //
     pair<const_iterator, const_iterator>
     lookup_namespace (const variable& ns) const
     {
@@ -2031,10 +2050,20 @@ namespace build2
     variable_map (const variable_map&, const prerequisite&, bool shared = false);
 
     variable_map&
-    operator= (variable_map&& v) noexcept {m_ = move (v.m_); return *this;}
+    operator= (variable_map&& v) noexcept
+    {
+      m_ = move (v.m_);
+      index_ = move (v.index_);
+      return *this;
+    }
 
     variable_map&
-    operator= (const variable_map& v) {m_ = v.m_; return *this;}
+    operator= (const variable_map& v)
+    {
+      m_ = v.m_;
+      reindex ();
+      return *this;
+    }
 
     // The context owner is for special "managed" variable maps. Note that
     // such maps cannot lookup/insert variable names specified as strings.
@@ -2045,7 +2074,8 @@ namespace build2
     // Note: std::map's move constructor can throw.
     //
     variable_map (variable_map&& v)
-      : shared_ (v.shared_), owner_ (v.owner_), ctx (v.ctx), m_ (move (v.m_))
+      : shared_ (v.shared_), owner_ (v.owner_), ctx (v.ctx),
+        m_ (move (v.m_)), index_ (move (v.index_))
     {
       assert (owner_ == owner::context);
     }
@@ -2054,10 +2084,11 @@ namespace build2
       : shared_ (v.shared_), owner_ (v.owner_), ctx (v.ctx), m_ (v.m_)
     {
       assert (v.owner_ == owner::context);
+      reindex ();
     }
 
     void
-    clear () {m_.clear ();}
+    clear () {m_.clear (); index_.clear ();}
 
     // Implementation details.
     //
@@ -2074,6 +2105,16 @@ namespace build2
     void
     typify (const value_data&, const variable&) const;
 
+    // Return the value for the variable (but not its aliases) or NULL.
+    //
+    const value_data*
+    find_value (const variable&) const;
+
+    // Rebuild the index from the map.
+    //
+    void
+    reindex ();
+
   private:
     friend class target_set;
 
@@ -2087,6 +2128,22 @@ namespace build2
     };
     context* ctx;
     map_type m_;
+
+    // Index of the values in the map sorted by the variable id. Lookups are
+    // the hot path (for example, in scope::lookup_original()) and searching
+    // the contiguous index is a lot cheaper than searching the map by
+    // comparing names. Note that we rely on the std::map node stability.
+    //
+    struct index_entry
+    {
+      size_t      id;
+      value_data* value;
+    };
+
+    static bool
+    index_less (const index_entry& e, size_t id) {return e.id < id;}
+
+    vector<index_entry> index_;
   };
 
   LIBBUILD2_SYMEXPORT extern const variable_map empty_variable_map;
@@ -2195,12 +2252,22 @@ namespace build2
     // size of std::regex object ranges between 32 and 64 bytes, depending on
     // the implementation.
     //
+    // If the regex is supported by linear_regex, then it is compiled to that
+    // instead, which is faster to match (and regex is absent).
+    //
+    // For path patterns we also keep the lengths of the literal prefix and
+    // suffix (the parts before the first and after the last wildcard) which
+    // allows us to quickly reject most names without calling path_match().
+    //
     struct pattern
     {
       pattern_type                    type;
       mutable bool                    match_ext; // Match extension flag.
       string                          text;
       mutable optional<build2::regex> regex;
+      mutable optional<linear_regex>  lregex;
+      mutable size_t                  prefix = 0;
+      mutable size_t                  suffix = 0;
     };
 
     struct pattern_compare
@@ -2235,8 +2302,7 @@ namespace build2
     variable_map&
     operator[] (string text)
     {
-      return map_.emplace (pattern {pattern_type::path, false, move (text), {}},
-                           variable_map (ctx, shared_)).first->second;
+      return insert (pattern_type::path, move (text));
     }
 
     const_iterator         begin ()  const {return map_.begin ();}
@@ -2260,9 +2326,15 @@ namespace build2
 
     variable_type_map (context& c, bool shared): ctx (c), shared_ (shared) {}
 
+    // Note that this function resets the match memo (see below) and so
+    // should be used (only during the load phase) to add patterns and not
+    // merely to access them.
+    //
     variable_pattern_map&
     operator[] (const target_type& t)
     {
+      memo_.clear ();
+
       return map_.emplace (
         t, variable_pattern_map (ctx, shared_)).first->second;
     }
@@ -2295,6 +2367,60 @@ namespace build2
     context& ctx;
     map_type map_;
     bool shared_;
+
+    // Match memo.
+    //
+    // The pattern blocks that match a target only depend on its type,
+    // effective name, and extension and yet matching is repeated for every
+    // variable looked up for this target. So we memoize the matching blocks
+    // (in the lookup order). Similar to the cache, the memo is protected by
+    // the variable cache mutex shard.
+    //
+    struct memo_block
+    {
+      const variable_map* vars;
+      bool                ext;  // Matched with extension (match_ext).
+    };
+
+    using memo_blocks = vector<memo_block>;
+
+    template <typename S, typename E>
+    struct memo_key_type
+    {
+      const target_type* type;
+      S                  name;  // Effective name.
+      E                  ext;
+      bool               named; // Effective name is the target name.
+    };
+
+    using memo_key = memo_key_type<string, optional<string>>;
+    using memo_query = memo_key_type<const string&, const optional<string>&>;
+
+    struct memo_compare
+    {
+      using is_transparent = void;
+
+      template <typename X, typename Y>
+      bool
+      operator() (const X& x, const Y& y) const
+      {
+        if (x.type != y.type)
+          return less<const target_type*> () (x.type, y.type);
+
+        if (x.named != y.named)
+          return x.named < y.named;
+
+        if (int r = x.name.compare (y.name))
+          return r < 0;
+
+        return x.ext && y.ext ? *x.ext < *y.ext : !x.ext && y.ext;
+      }
+    };
+
+    memo_blocks
+    match (const target_key&, const string& name, bool named) const;
+
+    mutable map<memo_key, memo_blocks, memo_compare> memo_;
   };
 }
 
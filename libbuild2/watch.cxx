@@ -0,0 +1,462 @@
+// file      : libbuild2/watch.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/watch.hxx>
+
+#ifdef __linux__
+#  include <poll.h>
+#  include <unistd.h>      // read()
+#  include <sys/inotify.h>
+#endif
+
+#include <map>
+#include <cerrno>
+#include <unordered_set>
+#include <unordered_map>
+
+#include <libbutl/filesystem.hxx> // dir_iterator
+
+#include <libbuild2/rule.hxx>
+#include <libbuild2/scope.hxx>
+#include <libbuild2/target.hxx>
+#include <libbuild2/context.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+#ifdef __linux__
+  // Watched directories with the value indicating whether the directory is
+  // in a project source root (and thus added/removed entries are relevant).
+  //
+  using watch_dirs = map<dir_path, bool>;
+
+  // Add the directory and all its non-hidden subdirectories.
+  //
+  static void
+  walk (const dir_path& d, watch_dirs& ds)
+  {
+    ds[d] = true;
+
+    try
+    {
+      for (const dir_entry& de: dir_iterator (d, dir_iterator::no_follow))
+      {
+        if (de.ltype () != entry_type::directory)
+          continue;
+
+        const path& n (de.path ());
+
+        if (n.string ().front () == '.')
+          continue;
+
+        walk (d / path_cast<dir_path> (n), ds);
+      }
+    }
+    catch (const system_error& e)
+    {
+      fail << "unable to iterate over " << d << ": " << e;
+    }
+  }
+
+  // Wait for the file descriptor to become readable for up to the specified
+  // number of milliseconds (-1 means indefinitely). Return false on timeout.
+  //
+  static bool
+  wait_readable (int fd, int timeout)
+  {
+    for (;;)
+    {
+      pollfd p {fd, POLLIN, 0};
+      int r (poll (&p, 1, timeout));
+
+      if (r == -1)
+      {
+        if (errno == EINTR)
+          continue;
+
+        fail << "unable to poll inotify: "
+             << system_error (errno, generic_category ()); // Sanitize.
+      }
+
+      return r != 0;
+    }
+  }
+
+  // Return the file or directory modification time or timestamp_unknown if
+  // unable to obtain it.
+  //
+  static timestamp
+  entry_mtime (const path& p, bool dir = false)
+  {
+    try
+    {
+      return dir ? dir_mtime (path_cast<dir_path> (p)) : file_mtime (p);
+    }
+    catch (const system_error&)
+    {
+      return timestamp_unknown;
+    }
+  }
+
+  bool
+  wait_for_changes (context& ctx, timestamp start, bool reload)
+  {
+    tracer trace ("wait_for_changes");
+
+    action a (perform_id, update_id);
+
+    unordered_set<string> srcs; // Source files.
+    unordered_set<string> bfs;  // Buildfiles.
+    unordered_set<string> tgs;  // Path target files.
+    watch_dirs ds;
+
+    for (const auto& p: ctx.targets)
+    {
+      const target& t (*p);
+
+      if (const buildfile* bt = t.is_a<buildfile> ())
+      {
+        path f (bt->dir / path (bt->name));
+
+        if (const string* e = bt->ext ())
+        {
+          if (!e->empty ())
+            f += '.' + *e;
+        }
+
+        ds.emplace (f.directory (), false);
+        bfs.insert (move (f).string ());
+      }
+      else if (t.is_a<fsdir> ())
+      {
+        tgs.insert (t.dir.string ());
+      }
+      else if (const path_target* pt = t.is_a<path_target> ())
+      {
+        const path& f (pt->path ());
+
+        if (f.empty ())
+          continue;
+
+        tgs.insert (f.string ());
+
+        // Note that the rule is only valid if the target has been matched
+        // in the current operation.
+        //
+        const target::opstate& s (t[a]);
+        size_t c (s.task_count.load (memory_order_relaxed));
+
+        if ((c == ctx.count_applied () || c == ctx.count_executed ()) &&
+            s.rule == &file_rule::rule_match)
+        {
+          ds.emplace (f.directory (), false);
+          srcs.insert (f.string ());
+        }
+      }
+    }
+
+    for (const auto& p: ctx.scopes)
+    {
+      const scope* s (p.second.front ());
+
+      if (s != nullptr && s->root ())
+        walk (s->src_path (), ds);
+    }
+
+    auto_fd fd (inotify_init1 (IN_CLOEXEC));
+
+    if (fd.get () == -1)
+      fail << "unable to initialize inotify: "
+           << system_error (errno, generic_category ()); // Sanitize.
+
+    const uint32_t mask (IN_MODIFY      | IN_CLOSE_WRITE | IN_ATTRIB     |
+                         IN_CREATE      | IN_DELETE      | IN_MOVED_FROM |
+                         IN_MOVED_TO    | IN_DELETE_SELF | IN_MOVE_SELF  |
+                         IN_ONLYDIR);
+
+    unordered_map<int, const watch_dirs::value_type*> wds;
+
+    for (const watch_dirs::value_type& d: ds)
+    {
+      int w (inotify_add_watch (fd.get (), d.first.string ().c_str (), mask));
+
+      if (w == -1)
+      {
+        int e (errno);
+
+        // The directory has disappeared since the build, which is a change
+        // in and of itself.
+        //
+        if (e == ENOENT || e == ENOTDIR)
+        {
+          l4 ([&]{trace << "directory " << d.first << " has disappeared";});
+          return true;
+        }
+
+        diag_record dr (fail);
+        dr << "unable to watch " << d.first << ": "
+           << system_error (e, generic_category ()); // Sanitize.
+
+        if (e == ENOSPC)
+          dr << info << "consider increasing the fs.inotify.max_user_watches "
+                     << "system limit";
+      }
+
+      wds.emplace (w, &d);
+    }
+
+    l5 ([&]{trace << "watching " << srcs.size () << " source files, "
+                  << bfs.size () << " buildfiles in " << ds.size ()
+                  << " directories";});
+
+    unordered_set<string> changed; // Changed source files.
+
+    // Net number of entries added (positive) or removed (negative) per path
+    // in the source directories.
+    //
+    unordered_map<string, int> entries;
+
+    bool other (false); // Buildfile change, queue overflow, etc.
+
+    // Now that we are watching, detect the changes that were made during
+    // the build, before the watches were added. Any change from now on will
+    // be reported as an event.
+    //
+    // For source files we compare the modification time that the build has
+    // used (cached in the target) to the current one. For buildfiles and
+    // directories we compare the current modification time to the start of
+    // the build. Note that the file modification times come from a coarser
+    // clock which may lag behind system_clock by a few milliseconds so we
+    // allow some slack (the changes that triggered this build were made at
+    // least as long before its start, see the event coalescing below).
+    //
+    start -= chrono::milliseconds (50);
+
+    for (const auto& p: ctx.targets)
+    {
+      const path_target* pt (p->is_a<path_target> ());
+      if (pt == nullptr)
+        continue;
+
+      const path& f (pt->path ());
+      if (f.empty () || srcs.find (f.string ()) == srcs.end ())
+        continue;
+
+      timestamp mt (pt->mtime ());
+      timestamp cmt (entry_mtime (f));
+
+      if (cmt == timestamp_unknown || cmt == timestamp_nonexistent)
+      {
+        l4 ([&]{trace << "source " << f << " removed during build";});
+        other = true;
+      }
+      else if (mt != timestamp_unknown ? cmt != mt : cmt > start)
+      {
+        l4 ([&]{trace << "source " << f << " changed during build";});
+        changed.insert (f.string ());
+      }
+    }
+
+    for (const string& f: bfs)
+    {
+      timestamp mt (entry_mtime (path (f)));
+
+      if (mt == timestamp_unknown || mt == timestamp_nonexistent || mt > start)
+      {
+        l4 ([&]{trace << "buildfile " << f << " changed during build";});
+        other = true;
+      }
+    }
+
+    // For a directory that has changed we also have to check whether the
+    // entries were added by the build itself (an in source build), which
+    // we don't care about, or by someone else. We recognize the former as
+    // path target files and their auxiliary dependency databases. This
+    // cannot detect the removal of entries other than source files (see
+    // above), but those don't normally change the build.
+    //
+    for (const watch_dirs::value_type& d: ds)
+    {
+      if (other || !d.second)
+        continue;
+
+      timestamp mt (entry_mtime (d.first, true /* dir */));
+
+      if (mt != timestamp_unknown && mt <= start)
+        continue;
+
+      try
+      {
+        for (const dir_entry& de: dir_iterator (d.first,
+                                                dir_iterator::no_follow))
+        {
+          const string& n (de.path ().string ());
+
+          if (n.front () == '.')
+            continue;
+
+          path f (d.first / de.path ());
+
+          if (tgs.find (f.string ()) != tgs.end ())
+            continue;
+
+          if (f.extension () == "d" &&
+              tgs.find (f.base ().string ()) != tgs.end ())
+            continue;
+
+          if (entry_mtime (f, de.ltype () == entry_type::directory) > start)
+          {
+            l4 ([&]{trace << "entry " << f << " added during build";});
+            other = true;
+            break;
+          }
+        }
+      }
+      catch (const system_error&)
+      {
+        l4 ([&]{trace << "directory " << d.first << " changed during build";});
+        other = true;
+      }
+    }
+
+    bool pending (other || !changed.empty ());
+
+    if (!pending && verb != 0)
+      info << "waiting for changes";
+
+    alignas (inotify_event) char buf[64 * 1024];
+
+    // Unless we already have changes, wait for the first event and then
+    // keep reading until there are no more events for a short while to give
+    // an editor, version control system, etc., a chance to finish.
+    //
+    for (int timeout (pending ? 0 : -1);; )
+    {
+      if (!wait_readable (fd.get (), timeout))
+      {
+        bool added (false);
+        for (const auto& p: entries)
+        {
+          if (p.second != 0)
+          {
+            l4 ([&]{trace << "entry " << p.first << " added or removed";});
+            added = true;
+            break;
+          }
+        }
+
+        if (other || added)
+          return true;
+
+        if (!changed.empty ())
+          break;
+
+        // Nothing relevant, continue waiting.
+        //
+        entries.clear ();
+        timeout = -1;
+        continue;
+      }
+
+      ssize_t n (read (fd.get (), buf, sizeof (buf)));
+
+      if (n == -1)
+      {
+        if (errno == EINTR || errno == EAGAIN)
+          continue;
+
+        fail << "unable to read inotify events: "
+             << system_error (errno, generic_category ()); // Sanitize.
+      }
+
+      for (const char* b (buf); b < buf + n; )
+      {
+        const inotify_event& e (*reinterpret_cast<const inotify_event*> (b));
+        b += sizeof (inotify_event) + e.len;
+
+        if ((e.mask & IN_Q_OVERFLOW) != 0)
+        {
+          l4 ([&]{trace << "event queue overflow";});
+          other = true;
+          continue;
+        }
+
+        auto i (wds.find (e.wd));
+        if (i == wds.end () || (e.mask & IN_IGNORED) != 0)
+          continue;
+
+        const dir_path& d (i->second->first);
+        bool sd (i->second->second);
+
+        if ((e.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) != 0)
+        {
+          l4 ([&]{trace << "directory " << d << " removed or moved";});
+          other = true;
+          continue;
+        }
+
+        // Skip events on the directory itself as well as hidden entries.
+        //
+        if (e.len == 0 || e.name[0] == '\0' || e.name[0] == '.')
+          continue;
+
+        string f ((d / path (e.name)).string ());
+
+        if (bfs.find (f) != bfs.end ())
+        {
+          l4 ([&]{trace << "buildfile " << f << " changed";});
+          other = true;
+          continue;
+        }
+
+        bool src (srcs.find (f) != srcs.end ());
+
+        if (src)
+          changed.insert (f);
+
+        if (sd)
+        {
+          if ((e.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+            ++entries[f];
+          else if ((e.mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+            --entries[f];
+        }
+      }
+
+      timeout = 100;
+    }
+
+    if (reload)
+      return true;
+
+    // Invalidate the cached modification times of the changed source files.
+    //
+    for (const auto& p: ctx.targets)
+    {
+      if (const path_target* pt = p->is_a<path_target> ())
+      {
+        const path& f (pt->path ());
+
+        if (!f.empty () && changed.find (f.string ()) != changed.end ())
+        {
+          l5 ([&]{trace << "source " << f << " changed";});
+
+          pt->mtime (timestamp_unknown);
+          ctx.mtime_prefetch->invalidate (f);
+        }
+      }
+    }
+
+    return false;
+  }
+#else
+  bool
+  wait_for_changes (context&, timestamp, bool)
+  {
+    fail << "watch mode is not supported on this platform" << endf;
+  }
+#endif
+}
@@ -0,0 +1,54 @@
+// file      : libbuild2/watch.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_WATCH_HXX
+#define LIBBUILD2_WATCH_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Wait for changes to the inputs of the build performed in the specified
+  // context (see --watch).
+  //
+  // The inputs are determined from the build context and include:
+  //
+  // source     -- path targets matched by the fallback file rule (source
+  //               files, headers, etc) in the perform(update) action
+  //
+  // buildfile  -- buildfiles loaded into the context (buildfile, root.build,
+  //               config.build, etc)
+  //
+  // directory  -- non-hidden directories in project source roots (entries
+  //               added or removed, think globs)
+  //
+  // If only source files have changed, then the build state can be reused
+  // in which case this function invalidates the cached modification times
+  // of the corresponding targets (and in the mtime prefetcher) so that the
+  // next build picks up the changes and returns false. Otherwise (buildfiles
+  // changed, entries added or removed, etc) it returns true and the caller
+  // is expected to reload the build state from scratch. If reload is true,
+  // then the state is not invalidated and true is always returned.
+  //
+  // Note that entries that were created and then removed (or the other way
+  // around) while waiting (think editor backup files) as well as hidden
+  // entries are ignored.
+  //
+  // The watching only starts after the build has completed. To detect
+  // changes made during the build (which the build may or may not have
+  // seen), the modification times of the inputs are compared to those used
+  // by the build or, if unknown, to the specified build start time. If any
+  // such changes are detected, then this function returns without waiting.
+  //
+  // Fail if unable to watch (for example, because of the system limit on
+  // the number of watches). Currently only supported on Linux (inotify).
+  //
+  LIBBUILD2_SYMEXPORT bool
+  wait_for_changes (context&, timestamp start, bool reload);
+}
+
+#endif // LIBBUILD2_WATCH_HXX